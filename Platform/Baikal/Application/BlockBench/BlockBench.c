@@ -0,0 +1,716 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DevicePathLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/ShellLib.h>
+#include <Library/SortLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
+#include <Protocol/DevicePath.h>
+#include <Protocol/ShellParameters.h>
+
+#define BLOCK_BENCH_MAX_DEPTH       32
+#define BLOCK_BENCH_DEFAULT_COUNT   256
+#define BLOCK_BENCH_DEFAULT_SEQ     (64 * 1024)
+#define BLOCK_BENCH_DEFAULT_RANDOM  (4 * 1024)
+
+#define BLOCK_BENCH_TEST_SEQREAD    BIT0
+#define BLOCK_BENCH_TEST_SEQWRITE   BIT1
+#define BLOCK_BENCH_TEST_RANDREAD   BIT2
+#define BLOCK_BENCH_TEST_RANDWRITE  BIT3
+
+typedef struct {
+  EFI_HANDLE              Handle;
+  EFI_BLOCK_IO_PROTOCOL   *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL  *BlockIo2;
+  UINT32                  BlockSize;
+  UINT64                  Size;
+} BLOCK_BENCH_DEVICE;
+
+typedef struct {
+  UINT32   Tests;
+  UINTN    TransferSize;   // 0: default for the test
+  UINTN    Depth;
+  UINTN    Count;
+  UINT64   Offset;
+  UINT64   Span;           // 0: up to the end of the media
+  BOOLEAN  Destructive;
+} BLOCK_BENCH_CONFIG;
+
+typedef struct {
+  EFI_BLOCK_IO2_TOKEN  Token;
+  UINT64               Start;
+  UINTN                Index;
+  BOOLEAN              Busy;
+} BLOCK_BENCH_SLOT;
+
+STATIC UINT64  mRandomState;
+
+STATIC
+UINT64
+BlockBenchRandom (
+  VOID
+  )
+{
+  // xorshift64
+  mRandomState ^= LShiftU64 (mRandomState, 13);
+  mRandomState ^= RShiftU64 (mRandomState, 7);
+  mRandomState ^= LShiftU64 (mRandomState, 17);
+  return mRandomState;
+}
+
+STATIC
+UINT64
+BlockBenchNow (
+  VOID
+  )
+{
+  return GetTimeInNanoSecond (GetPerformanceCounter ());
+}
+
+STATIC
+INTN
+EFIAPI
+BlockBenchCompareUint64 (
+  IN CONST VOID  *Left,
+  IN CONST VOID  *Right
+  )
+{
+  UINT64  L = *(CONST UINT64 *)Left;
+  UINT64  R = *(CONST UINT64 *)Right;
+
+  return L < R ? -1 : L > R ? 1 : 0;
+}
+
+STATIC
+VOID
+BlockBenchUsage (
+  VOID
+  )
+{
+  Print (L"Measure Block I/O performance.\n");
+  Print (L"\n");
+  Print (L"BLOCKBENCH -l\n");
+  Print (L"BLOCKBENCH -d index [-t test] [-s size] [-q depth] [-n count] [-o offset] [-r span] [-D]\n");
+  Print (L"\n");
+  Print (L"  -l          - List Block I/O devices.\n");
+  Print (L"  -d index    - Device index as printed by -l.\n");
+  Print (L"  -t test     - seqread, seqwrite, randread, randwrite, read, write or all\n");
+  Print (L"                (default: read).\n");
+  Print (L"  -s size     - Transfer size in bytes (default: 64K sequential, 4K random).\n");
+  Print (L"  -q depth    - Queue depth, 1..%u; depth > 1 requires Block I/O 2 (default: 1).\n", BLOCK_BENCH_MAX_DEPTH);
+  Print (L"  -n count    - Number of transfers per test (default: %u).\n", BLOCK_BENCH_DEFAULT_COUNT);
+  Print (L"  -o offset   - Start of the test area in bytes (default: 0).\n");
+  Print (L"  -r span     - Size of the test area for random tests (default: to the end).\n");
+  Print (L"  -D          - Destructive mode: do not restore data overwritten by write tests.\n");
+  Print (L"\n");
+  Print (L"NOTES:\n");
+  Print (L"  1. Without -D, write tests save the test area first and restore it afterwards.\n");
+  Print (L"  2. Latency is measured from submission to completion of each transfer.\n");
+  Print (L"\n");
+  Print (L"EXAMPLES:\n");
+  Print (L"  * To measure 4K random reads with 8 requests in flight on device 2:\n");
+  Print (L"    fs0:\\> blockbench -d 2 -t randread -s 4096 -q 8\n");
+}
+
+STATIC
+EFI_STATUS
+BlockBenchGetDevices (
+  OUT BLOCK_BENCH_DEVICE  **Devices,
+  OUT UINTN               *DeviceCount
+  )
+{
+  EFI_HANDLE          *Handles;
+  UINTN               HandleCount;
+  UINTN               Index;
+  EFI_STATUS          Status;
+  BLOCK_BENCH_DEVICE  *Device;
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiBlockIoProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &Handles
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  *Devices = AllocateZeroPool (HandleCount * sizeof (BLOCK_BENCH_DEVICE));
+  if (*Devices == NULL) {
+    FreePool (Handles);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  *DeviceCount = 0;
+  for (Index = 0; Index < HandleCount; ++Index) {
+    Device = &(*Devices)[*DeviceCount];
+    Status = gBS->HandleProtocol (Handles[Index], &gEfiBlockIoProtocolGuid, (VOID **)&Device->BlockIo);
+    if (EFI_ERROR (Status) || !Device->BlockIo->Media->MediaPresent) {
+      continue;
+    }
+
+    if (EFI_ERROR (gBS->HandleProtocol (Handles[Index], &gEfiBlockIo2ProtocolGuid, (VOID **)&Device->BlockIo2))) {
+      Device->BlockIo2 = NULL;
+    }
+
+    Device->Handle    = Handles[Index];
+    Device->BlockSize = Device->BlockIo->Media->BlockSize;
+    Device->Size      = MultU64x32 (Device->BlockIo->Media->LastBlock + 1, Device->BlockSize);
+    ++*DeviceCount;
+  }
+
+  FreePool (Handles);
+  return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+BlockBenchList (
+  IN BLOCK_BENCH_DEVICE  *Devices,
+  IN UINTN               DeviceCount
+  )
+{
+  UINTN                     Index;
+  EFI_DEVICE_PATH_PROTOCOL  *DevicePath;
+  CHAR16                    *Text;
+  EFI_BLOCK_IO_MEDIA        *Media;
+
+  Print (L"Idx  Size(MiB)  Block  Flags  Device path\n");
+  for (Index = 0; Index < DeviceCount; ++Index) {
+    Media = Devices[Index].BlockIo->Media;
+    Text  = NULL;
+    DevicePath = DevicePathFromHandle (Devices[Index].Handle);
+    if (DevicePath != NULL) {
+      Text = ConvertDevicePathToText (DevicePath, TRUE, TRUE);
+    }
+
+    Print (
+      L"%3u  %9lu  %5u  %c%c%c%c   %s\n",
+      Index,
+      RShiftU64 (Devices[Index].Size, 20),
+      Devices[Index].BlockSize,
+      Devices[Index].BlockIo2 != NULL ? L'2' : L'-',
+      Media->ReadOnly                 ? L'R' : L'-',
+      Media->LogicalPartition         ? L'P' : L'-',
+      Media->WriteCaching             ? L'C' : L'-',
+      Text != NULL ? Text : L"?"
+      );
+
+    if (Text != NULL) {
+      FreePool (Text);
+    }
+  }
+
+  Print (L"Flags: 2 - Block I/O 2, R - read-only, P - partition, C - write caching\n");
+}
+
+/**
+  Run Count transfers of TransferSize bytes at Offsets[] keeping up to Depth
+  requests in flight and record the latency of each one.
+**/
+STATIC
+EFI_STATUS
+BlockBenchRun (
+  IN  BLOCK_BENCH_DEVICE  *Device,
+  IN  BOOLEAN             Write,
+  IN  UINT64              *Offsets,
+  IN  UINTN               Count,
+  IN  UINTN               TransferSize,
+  IN  UINTN               Depth,
+  IN  UINT8               *Buffer,
+  OUT UINT64              *Latencies,
+  OUT UINT64              *Elapsed
+  )
+{
+  BLOCK_BENCH_SLOT  Slots[BLOCK_BENCH_MAX_DEPTH];
+  UINT32            MediaId;
+  UINTN             Submitted;
+  UINTN             Completed;
+  UINTN             Index;
+  UINT64            TimeStart;
+  EFI_STATUS        Status;
+
+  MediaId   = Device->BlockIo->Media->MediaId;
+  TimeStart = BlockBenchNow ();
+
+  if (Depth == 1) {
+    for (Index = 0; Index < Count; ++Index) {
+      Latencies[Index] = BlockBenchNow ();
+      if (Write) {
+        Status = Device->BlockIo->WriteBlocks (
+                                    Device->BlockIo,
+                                    MediaId,
+                                    DivU64x32 (Offsets[Index], Device->BlockSize),
+                                    TransferSize,
+                                    Buffer
+                                    );
+      } else {
+        Status = Device->BlockIo->ReadBlocks (
+                                    Device->BlockIo,
+                                    MediaId,
+                                    DivU64x32 (Offsets[Index], Device->BlockSize),
+                                    TransferSize,
+                                    Buffer
+                                    );
+      }
+
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      Latencies[Index] = BlockBenchNow () - Latencies[Index];
+    }
+
+    if (Write) {
+      Status = Device->BlockIo->FlushBlocks (Device->BlockIo);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+    }
+
+    *Elapsed = BlockBenchNow () - TimeStart;
+    return EFI_SUCCESS;
+  }
+
+  ZeroMem (Slots, sizeof (Slots));
+  for (Index = 0; Index < Depth; ++Index) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Slots[Index].Token.Event);
+    if (EFI_ERROR (Status)) {
+      goto Exit;
+    }
+  }
+
+  Status    = EFI_SUCCESS;
+  Submitted = 0;
+  Completed = 0;
+  while (Completed < Submitted || (Submitted < Count && !EFI_ERROR (Status))) {
+    for (Index = 0; Index < Depth; ++Index) {
+      BLOCK_BENCH_SLOT  *Slot = &Slots[Index];
+
+      if (Slot->Busy) {
+        if (gBS->CheckEvent (Slot->Token.Event) == EFI_NOT_READY) {
+          continue;
+        }
+
+        Latencies[Slot->Index] = BlockBenchNow () - Slot->Start;
+        Slot->Busy = FALSE;
+        ++Completed;
+        if (EFI_ERROR (Slot->Token.TransactionStatus) && !EFI_ERROR (Status)) {
+          Status = Slot->Token.TransactionStatus;
+        }
+      }
+
+      if (Submitted == Count || EFI_ERROR (Status)) {
+        continue;
+      }
+
+      //
+      // Each slot uses its own part of the buffer
+      //
+      Slot->Token.TransactionStatus = EFI_NOT_READY;
+      Slot->Start = BlockBenchNow ();
+      Slot->Index = Submitted;
+      if (Write) {
+        Status = Device->BlockIo2->WriteBlocksEx (
+                                     Device->BlockIo2,
+                                     MediaId,
+                                     DivU64x32 (Offsets[Submitted], Device->BlockSize),
+                                     &Slot->Token,
+                                     TransferSize,
+                                     Buffer + Index * TransferSize
+                                     );
+      } else {
+        Status = Device->BlockIo2->ReadBlocksEx (
+                                     Device->BlockIo2,
+                                     MediaId,
+                                     DivU64x32 (Offsets[Submitted], Device->BlockSize),
+                                     &Slot->Token,
+                                     TransferSize,
+                                     Buffer + Index * TransferSize
+                                     );
+      }
+
+      if (!EFI_ERROR (Status)) {
+        Slot->Busy = TRUE;
+        ++Submitted;
+      }
+    }
+  }
+
+  if (!EFI_ERROR (Status) && Write) {
+    Status = Device->BlockIo->FlushBlocks (Device->BlockIo);
+  }
+
+  *Elapsed = BlockBenchNow () - TimeStart;
+
+Exit:
+  for (Index = 0; Index < Depth; ++Index) {
+    if (Slots[Index].Token.Event != NULL) {
+      gBS->CloseEvent (Slots[Index].Token.Event);
+    }
+  }
+
+  return Status;
+}
+
+STATIC
+VOID
+BlockBenchReport (
+  IN CONST CHAR16  *Name,
+  IN UINTN         Count,
+  IN UINTN         TransferSize,
+  IN UINT64        Elapsed,
+  IN UINT64        *Latencies
+  )
+{
+  UINT64  Bytes;
+  UINT64  Rate;
+  UINT64  Iops;
+
+  if (Elapsed == 0) {
+    Elapsed = 1;
+  }
+
+  PerformQuickSort (Latencies, Count, sizeof (UINT64), BlockBenchCompareUint64);
+
+  Bytes = MultU64x64 (Count, TransferSize);
+  // 1 byte/ns = 1000 MB/s, printed with two decimal places
+  Rate = DivU64x64Remainder (MultU64x32 (Bytes, 100000), Elapsed, NULL);
+  Iops = DivU64x64Remainder (MultU64x32 (Count, 1000000000), Elapsed, NULL);
+
+  Print (
+    L"%-9s %7u x %7u  %6lu.%02lu MB/s  %8lu IOPS  lat(us) p50 %lu p90 %lu p99 %lu max %lu\n",
+    Name,
+    Count,
+    TransferSize,
+    DivU64x32 (Rate, 100),
+    ModU64x32 (Rate, 100),
+    Iops,
+    DivU64x32 (Latencies[Count / 2], 1000),
+    DivU64x32 (Latencies[Count * 90 / 100], 1000),
+    DivU64x32 (Latencies[Count * 99 / 100], 1000),
+    DivU64x32 (Latencies[Count - 1], 1000)
+    );
+}
+
+STATIC
+EFI_STATUS
+BlockBenchTest (
+  IN BLOCK_BENCH_DEVICE        *Device,
+  IN CONST BLOCK_BENCH_CONFIG  *Config,
+  IN CONST CHAR16              *Name,
+  IN BOOLEAN                   Write,
+  IN BOOLEAN                   Random
+  )
+{
+  UINTN       TransferSize;
+  UINT64      Span;
+  UINT64      Slots;
+  UINT64      Slot;
+  UINT64      *Offsets = NULL;
+  UINT64      *Latencies = NULL;
+  UINT8       *Buffer = NULL;
+  UINT8       *Backup = NULL;
+  UINTN       BufferSize;
+  UINTN       Index;
+  UINT64      Elapsed;
+  EFI_STATUS  Status;
+  EFI_STATUS  RestoreStatus;
+
+  TransferSize = Config->TransferSize;
+  if (TransferSize == 0) {
+    TransferSize = Random ? BLOCK_BENCH_DEFAULT_RANDOM : BLOCK_BENCH_DEFAULT_SEQ;
+  }
+
+  TransferSize = ALIGN_VALUE (TransferSize, Device->BlockSize);
+  if (Config->Offset >= Device->Size) {
+    Print (L"BlockBench: offset is beyond the end of the device.\n");
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Span = Device->Size - Config->Offset;
+  if (Config->Span != 0) {
+    Span = MIN (Span, Config->Span);
+  }
+
+  Slots = DivU64x64Remainder (Span, TransferSize, NULL);
+  if (Slots == 0 || (!Random && Slots < Config->Count)) {
+    Print (L"BlockBench: %s: test area is too small.\n", Name);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (Write && Device->BlockIo->Media->ReadOnly) {
+    Print (L"BlockBench: %s: device is read-only, skipped.\n", Name);
+    return EFI_SUCCESS;
+  }
+
+  if (Config->Depth > 1 && Device->BlockIo2 == NULL) {
+    Print (L"BlockBench: %s: queue depth > 1 requires Block I/O 2.\n", Name);
+    return EFI_UNSUPPORTED;
+  }
+
+  BufferSize = TransferSize * Config->Depth;
+  Offsets    = AllocatePool (Config->Count * sizeof (UINT64));
+  Latencies  = AllocatePool (Config->Count * sizeof (UINT64));
+  Buffer     = AllocatePages (EFI_SIZE_TO_PAGES (BufferSize));
+  if (Offsets == NULL || Latencies == NULL || Buffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+
+  for (Index = 0; Index < Config->Count; ++Index) {
+    if (Random) {
+      DivU64x64Remainder (BlockBenchRandom (), Slots, &Slot);
+      Offsets[Index] = Config->Offset + MultU64x64 (Slot, TransferSize);
+    } else {
+      Offsets[Index] = Config->Offset + MultU64x64 (Index, TransferSize);
+    }
+  }
+
+  for (Index = 0; Index < BufferSize; ++Index) {
+    Buffer[Index] = (UINT8)(Index * 7 + 0x5A);
+  }
+
+  if (Write && !Config->Destructive) {
+    //
+    // Save everything the test is going to overwrite. Overlapping random
+    // offsets hold the same data, so the restore order does not matter.
+    //
+    Backup = AllocatePages (EFI_SIZE_TO_PAGES (Config->Count * TransferSize));
+    if (Backup == NULL) {
+      Print (L"BlockBench: %s: not enough memory to save the test area, use -D or a smaller -n.\n", Name);
+      Status = EFI_OUT_OF_RESOURCES;
+      goto Exit;
+    }
+
+    for (Index = 0; Index < Config->Count; ++Index) {
+      Status = Device->BlockIo->ReadBlocks (
+                                  Device->BlockIo,
+                                  Device->BlockIo->Media->MediaId,
+                                  DivU64x32 (Offsets[Index], Device->BlockSize),
+                                  TransferSize,
+                                  Backup + Index * TransferSize
+                                  );
+      if (EFI_ERROR (Status)) {
+        Print (L"BlockBench: %s: failed to save the test area, %r.\n", Name, Status);
+        goto Exit;
+      }
+    }
+  }
+
+  Status = BlockBenchRun (
+             Device,
+             Write,
+             Offsets,
+             Config->Count,
+             TransferSize,
+             Config->Depth,
+             Buffer,
+             Latencies,
+             &Elapsed
+             );
+  if (EFI_ERROR (Status)) {
+    Print (L"BlockBench: %s: %r\n", Name, Status);
+  } else {
+    BlockBenchReport (Name, Config->Count, TransferSize, Elapsed, Latencies);
+  }
+
+  if (Backup != NULL) {
+    for (Index = 0; Index < Config->Count; ++Index) {
+      RestoreStatus = Device->BlockIo->WriteBlocks (
+                                         Device->BlockIo,
+                                         Device->BlockIo->Media->MediaId,
+                                         DivU64x32 (Offsets[Index], Device->BlockSize),
+                                         TransferSize,
+                                         Backup + Index * TransferSize
+                                         );
+      if (EFI_ERROR (RestoreStatus)) {
+        Print (L"BlockBench: %s: failed to restore offset 0x%lx, %r!\n", Name, Offsets[Index], RestoreStatus);
+        Status = RestoreStatus;
+      }
+    }
+
+    Device->BlockIo->FlushBlocks (Device->BlockIo);
+  }
+
+Exit:
+  if (Backup != NULL) {
+    FreePages (Backup, EFI_SIZE_TO_PAGES (Config->Count * TransferSize));
+  }
+
+  if (Buffer != NULL) {
+    FreePages (Buffer, EFI_SIZE_TO_PAGES (BufferSize));
+  }
+
+  if (Latencies != NULL) {
+    FreePool (Latencies);
+  }
+
+  if (Offsets != NULL) {
+    FreePool (Offsets);
+  }
+
+  return Status;
+}
+
+STATIC
+BOOLEAN
+BlockBenchParseTests (
+  IN  CONST CHAR16  *Arg,
+  OUT UINT32        *Tests
+  )
+{
+  if (!StrCmp (Arg, L"seqread")) {
+    *Tests = BLOCK_BENCH_TEST_SEQREAD;
+  } else if (!StrCmp (Arg, L"seqwrite")) {
+    *Tests = BLOCK_BENCH_TEST_SEQWRITE;
+  } else if (!StrCmp (Arg, L"randread")) {
+    *Tests = BLOCK_BENCH_TEST_RANDREAD;
+  } else if (!StrCmp (Arg, L"randwrite")) {
+    *Tests = BLOCK_BENCH_TEST_RANDWRITE;
+  } else if (!StrCmp (Arg, L"read")) {
+    *Tests = BLOCK_BENCH_TEST_SEQREAD | BLOCK_BENCH_TEST_RANDREAD;
+  } else if (!StrCmp (Arg, L"write")) {
+    *Tests = BLOCK_BENCH_TEST_SEQWRITE | BLOCK_BENCH_TEST_RANDWRITE;
+  } else if (!StrCmp (Arg, L"all")) {
+    *Tests = BLOCK_BENCH_TEST_SEQREAD | BLOCK_BENCH_TEST_SEQWRITE |
+             BLOCK_BENCH_TEST_RANDREAD | BLOCK_BENCH_TEST_RANDWRITE;
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+EFI_STATUS
+EFIAPI
+BlockBenchMain (
+  IN  EFI_HANDLE         ImageHandle,
+  IN  EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  BLOCK_BENCH_CONFIG             Config;
+  BLOCK_BENCH_DEVICE             *Devices;
+  BLOCK_BENCH_DEVICE             *Device;
+  UINTN                          DeviceCount;
+  UINTN                          DeviceIndex = MAX_UINTN;
+  BOOLEAN                        List = FALSE;
+  UINTN                          Index;
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  CHAR16                         **Argv;
+  UINTN                          Argc;
+
+  Status = gBS->HandleProtocol (
+                  gImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **) &ShellParameters
+                  );
+  if (EFI_ERROR (Status)) {
+    Print (L"Please use UEFI Shell to run this application.\n");
+    return Status;
+  }
+
+  Argc = ShellParameters->Argc;
+  Argv = ShellParameters->Argv;
+
+  ZeroMem (&Config, sizeof (Config));
+  Config.Tests = BLOCK_BENCH_TEST_SEQREAD | BLOCK_BENCH_TEST_RANDREAD;
+  Config.Depth = 1;
+  Config.Count = BLOCK_BENCH_DEFAULT_COUNT;
+
+  for (Index = 1; Index < Argc; ++Index) {
+    if (!StrCmp (Argv[Index], L"-l")) {
+      List = TRUE;
+    } else if (!StrCmp (Argv[Index], L"-D")) {
+      Config.Destructive = TRUE;
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-d")) {
+      DeviceIndex = ShellStrToUintn (Argv[++Index]);
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-t")) {
+      if (!BlockBenchParseTests (Argv[++Index], &Config.Tests)) {
+        BlockBenchUsage ();
+        return EFI_INVALID_PARAMETER;
+      }
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-s")) {
+      Config.TransferSize = ShellStrToUintn (Argv[++Index]);
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-q")) {
+      Config.Depth = ShellStrToUintn (Argv[++Index]);
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-n")) {
+      Config.Count = ShellStrToUintn (Argv[++Index]);
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-o")) {
+      Config.Offset = ShellStrToUintn (Argv[++Index]);
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-r")) {
+      Config.Span = ShellStrToUintn (Argv[++Index]);
+    } else {
+      BlockBenchUsage ();
+      return EFI_SUCCESS;
+    }
+  }
+
+  if ((!List && DeviceIndex == MAX_UINTN) ||
+      Config.Depth == 0 || Config.Depth > BLOCK_BENCH_MAX_DEPTH ||
+      Config.Count == 0) {
+    BlockBenchUsage ();
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Status = BlockBenchGetDevices (&Devices, &DeviceCount);
+  if (EFI_ERROR (Status)) {
+    Print (L"BlockBench: no Block I/O devices found.\n");
+    return Status;
+  }
+
+  if (List) {
+    BlockBenchList (Devices, DeviceCount);
+    if (DeviceIndex == MAX_UINTN) {
+      FreePool (Devices);
+      return EFI_SUCCESS;
+    }
+  }
+
+  if (DeviceIndex >= DeviceCount) {
+    Print (L"BlockBench: incorrect device index.\n");
+    FreePool (Devices);
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Device = &Devices[DeviceIndex];
+  mRandomState = GetPerformanceCounter () | 1;
+
+  Print (
+    L"BlockBench: device %u, %lu MiB, depth %u%s\n",
+    DeviceIndex,
+    RShiftU64 (Device->Size, 20),
+    Config.Depth,
+    Config.Destructive ? L", destructive" : L""
+    );
+
+  if (Config.Tests & BLOCK_BENCH_TEST_SEQREAD) {
+    Status = BlockBenchTest (Device, &Config, L"seqread", FALSE, FALSE);
+  }
+
+  if (!EFI_ERROR (Status) && (Config.Tests & BLOCK_BENCH_TEST_SEQWRITE)) {
+    Status = BlockBenchTest (Device, &Config, L"seqwrite", TRUE, FALSE);
+  }
+
+  if (!EFI_ERROR (Status) && (Config.Tests & BLOCK_BENCH_TEST_RANDREAD)) {
+    Status = BlockBenchTest (Device, &Config, L"randread", FALSE, TRUE);
+  }
+
+  if (!EFI_ERROR (Status) && (Config.Tests & BLOCK_BENCH_TEST_RANDWRITE)) {
+    Status = BlockBenchTest (Device, &Config, L"randwrite", TRUE, TRUE);
+  }
+
+  FreePool (Devices);
+  return Status;
+}
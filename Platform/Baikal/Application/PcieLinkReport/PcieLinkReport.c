@@ -0,0 +1,375 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Guid/PcieTopology.h>
+#include <IndustryStandard/Pci.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/IoLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PrintLib.h>
+#include <Library/ShellLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Protocol/ShellParameters.h>
+
+#define PCIE_LINK_REPORT_LINE_MAX  512
+
+#define PCIE_LINK_CAP_OFF          0x0C
+#define PCIE_LINK_STS_OFF          0x12
+
+typedef enum {
+  PcieLinkReportJson,
+  PcieLinkReportCsv
+} PCIE_LINK_REPORT_FORMAT;
+
+typedef struct {
+  UINT8  Speed;
+  UINT8  Width;
+  UINT8  MaxSpeed;
+  UINT8  MaxWidth;
+} PCIE_LINK_REPORT_NOW;
+
+STATIC
+VOID
+PcieLinkReportUsage (
+  VOID
+  )
+{
+  Print (L"Report PCIe link training statistics of the current boot.\n");
+  Print (L"\n");
+  Print (L"PCIELINKREPORT [-j file] [-c file]\n");
+  Print (L"\n");
+  Print (L"  -j file     - Also save the report to a file in JSON format.\n");
+  Print (L"  -c file     - Also save the report to a file in CSV format.\n");
+  Print (L"\n");
+  Print (L"NOTES:\n");
+  Print (L"  1. Detect, L0 and Cfg are the times from the LTSSM start to the link partner\n");
+  Print (L"     detection, from the LTSSM start to L0 and from L0 to the first config\n");
+  Print (L"     access to the downstream device, in microseconds.\n");
+  Print (L"  2. Boot is the link state recorded by firmware right after training, Now is\n");
+  Print (L"     read from the root port and Cap is what the root port supports.\n");
+  Print (L"  3. A link is reported as degraded when its current speed or width is below\n");
+  Print (L"     the root port capability.\n");
+  Print (L"\n");
+  Print (L"EXAMPLES:\n");
+  Print (L"  * To print the report and save it for further processing:\n");
+  Print (L"    fs0:\\> pcielinkreport -c links.csv\n");
+}
+
+STATIC
+VOID
+PcieLinkReportReadNow (
+  IN   UINT64                DbiBase,
+  OUT  PCIE_LINK_REPORT_NOW  *Now
+  )
+{
+  UINT8   CapPtr;
+  UINT8   CapId;
+  UINTN   Guard;
+  UINT32  LinkCap;
+  UINT16  LinkSts;
+
+  ZeroMem (Now, sizeof (*Now));
+
+  CapPtr = MmioRead8 (DbiBase + PCI_CAPBILITY_POINTER_OFFSET) & ~0x3;
+  for (Guard = 0; CapPtr != 0 && Guard < 48; ++Guard) {
+    CapId = MmioRead8 (DbiBase + CapPtr);
+    if (CapId == EFI_PCI_CAPABILITY_ID_PCIEXP) {
+      LinkCap = MmioRead32 (DbiBase + CapPtr + PCIE_LINK_CAP_OFF);
+      LinkSts = MmioRead16 (DbiBase + CapPtr + PCIE_LINK_STS_OFF);
+      Now->MaxSpeed = LinkCap & 0xF;
+      Now->MaxWidth = (LinkCap >> 4) & 0x3F;
+      Now->Speed    = LinkSts & 0xF;
+      Now->Width    = (LinkSts >> 4) & 0x3F;
+      return;
+    }
+
+    CapPtr = MmioRead8 (DbiBase + CapPtr + 1) & ~0x3;
+  }
+}
+
+STATIC
+BOOLEAN
+PcieLinkReportIsDegraded (
+  IN  CONST PCIE_LINK_STATS_PORT  *Port,
+  IN  CONST PCIE_LINK_REPORT_NOW  *Now
+  )
+{
+  return (Port->Flags & PCIE_TOPOLOGY_PORT_LINK_UP) &&
+         (Now->Speed < Now->MaxSpeed || Now->Width < Now->MaxWidth);
+}
+
+STATIC
+EFI_STATUS
+PcieLinkReportSave (
+  IN  CONST CHAR16                *FileName,
+  IN  PCIE_LINK_REPORT_FORMAT     Format,
+  IN  CONST PCIE_LINK_STATS       *Stats,
+  IN  CONST PCIE_LINK_REPORT_NOW  *Now
+  )
+{
+  SHELL_FILE_HANDLE           File;
+  CHAR8                       *Line;
+  UINTN                       Size;
+  UINTN                       PortIdx;
+  UINTN                       Written = 0;
+  CONST PCIE_LINK_STATS_PORT  *Port;
+  EFI_STATUS                  Status;
+
+  //
+  // Open with create only appends to an existing file, start from scratch
+  //
+  Status = ShellOpenFileByName (FileName, &File, EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+  if (!EFI_ERROR (Status)) {
+    ShellDeleteFile (&File);
+  }
+
+  Status = ShellOpenFileByName (
+             FileName,
+             &File,
+             EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE,
+             0
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Line = AllocatePool (PCIE_LINK_REPORT_LINE_MAX);
+  if (Line == NULL) {
+    ShellCloseFile (&File);
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (Format == PcieLinkReportJson) {
+    Size = AsciiSPrint (
+             Line,
+             PCIE_LINK_REPORT_LINE_MAX,
+             "{\n  \"training_us\": %lu,\n  \"ports\": [",
+             Stats->TrainingUs
+             );
+  } else {
+    Size = AsciiSPrint (
+             Line,
+             PCIE_LINK_REPORT_LINE_MAX,
+             "segment,dbi,present,link_up,detect_us,link_up_us,cfg_wait_us,retrains,"
+             "boot_speed,boot_width,speed,width,max_speed,max_width\n"
+             );
+  }
+
+  Status = ShellWriteFile (File, &Size, Line);
+
+  for (PortIdx = 0; !EFI_ERROR (Status) && PortIdx < Stats->PortCount; ++PortIdx) {
+    Port = &Stats->Ports[PortIdx];
+    if (Port->DbiBase == 0) {
+      continue;
+    }
+
+    if (Format == PcieLinkReportJson) {
+      Size = AsciiSPrint (
+               Line,
+               PCIE_LINK_REPORT_LINE_MAX,
+               "%a\n    {\"segment\": %u, \"dbi\": \"0x%lx\", \"present\": %a, \"link_up\": %a, "
+               "\"detect_us\": %u, \"link_up_us\": %u, \"cfg_wait_us\": %u, \"retrains\": %u, "
+               "\"boot_speed\": %u, \"boot_width\": %u, \"speed\": %u, \"width\": %u, "
+               "\"max_speed\": %u, \"max_width\": %u}",
+               Written ? "," : "",
+               PortIdx,
+               Port->DbiBase,
+               (Port->Flags & PCIE_TOPOLOGY_PORT_PRESENT) ? "true" : "false",
+               (Port->Flags & PCIE_TOPOLOGY_PORT_LINK_UP) ? "true" : "false",
+               Port->DetectUs,
+               Port->LinkUpUs,
+               Port->CfgWaitUs,
+               Port->Retrains,
+               Port->Speed,
+               Port->Width,
+               Now[PortIdx].Speed,
+               Now[PortIdx].Width,
+               Now[PortIdx].MaxSpeed,
+               Now[PortIdx].MaxWidth
+               );
+    } else {
+      Size = AsciiSPrint (
+               Line,
+               PCIE_LINK_REPORT_LINE_MAX,
+               "%u,0x%lx,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+               PortIdx,
+               Port->DbiBase,
+               (Port->Flags & PCIE_TOPOLOGY_PORT_PRESENT) ? 1 : 0,
+               (Port->Flags & PCIE_TOPOLOGY_PORT_LINK_UP) ? 1 : 0,
+               Port->DetectUs,
+               Port->LinkUpUs,
+               Port->CfgWaitUs,
+               Port->Retrains,
+               Port->Speed,
+               Port->Width,
+               Now[PortIdx].Speed,
+               Now[PortIdx].Width,
+               Now[PortIdx].MaxSpeed,
+               Now[PortIdx].MaxWidth
+               );
+    }
+
+    Status = ShellWriteFile (File, &Size, Line);
+    ++Written;
+  }
+
+  if (!EFI_ERROR (Status) && Format == PcieLinkReportJson) {
+    Size = AsciiSPrint (Line, PCIE_LINK_REPORT_LINE_MAX, "\n  ]\n}\n");
+    Status = ShellWriteFile (File, &Size, Line);
+  }
+
+  FreePool (Line);
+  ShellCloseFile (&File);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+PcieLinkReportMain (
+  IN  EFI_HANDLE         ImageHandle,
+  IN  EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  PCIE_LINK_STATS                Stats;
+  PCIE_LINK_REPORT_NOW           Now[PCIE_TOPOLOGY_MAX_PORTS];
+  CONST PCIE_LINK_STATS_PORT     *Port;
+  CONST CHAR16                   *JsonFile = NULL;
+  CONST CHAR16                   *CsvFile  = NULL;
+  UINTN                          Size;
+  UINTN                          PortIdx;
+  UINTN                          Present  = 0;
+  UINTN                          Up       = 0;
+  UINTN                          Degraded = 0;
+  UINT32                         MaxLinkUpUs = 0;
+  UINT64                         CfgWaitUs   = 0;
+  UINTN                          Index;
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  CHAR16                         **Argv;
+  UINTN                          Argc;
+
+  Status = gBS->HandleProtocol (
+                  gImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **) &ShellParameters
+                  );
+  if (EFI_ERROR (Status)) {
+    Print (L"Please use UEFI Shell to run this application.\n");
+    return Status;
+  }
+
+  Argc = ShellParameters->Argc;
+  Argv = ShellParameters->Argv;
+
+  for (Index = 1; Index < Argc; ++Index) {
+    if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-j")) {
+      JsonFile = Argv[++Index];
+    } else if (Index + 1 < Argc && !StrCmp (Argv[Index], L"-c")) {
+      CsvFile = Argv[++Index];
+    } else {
+      PcieLinkReportUsage ();
+      return EFI_SUCCESS;
+    }
+  }
+
+  Size   = sizeof (Stats);
+  Status = gRT->GetVariable (
+                  PCIE_LINK_STATS_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  NULL,
+                  &Size,
+                  &Stats
+                  );
+  if (EFI_ERROR (Status) || Size != sizeof (Stats) ||
+      Stats.Revision != PCIE_LINK_STATS_REVISION ||
+      Stats.PortCount > PCIE_TOPOLOGY_MAX_PORTS) {
+    Print (L"No PCIe link statistics have been recorded during this boot.\n");
+    return EFI_NOT_FOUND;
+  }
+
+  Print (L"Seg  DBI                Detect      L0     Cfg  Retr  Boot       Now        Cap\n");
+  for (PortIdx = 0; PortIdx < Stats.PortCount; ++PortIdx) {
+    Port = &Stats.Ports[PortIdx];
+    ZeroMem (&Now[PortIdx], sizeof (Now[PortIdx]));
+    if (Port->DbiBase == 0) {
+      continue;
+    }
+
+    PcieLinkReportReadNow (Port->DbiBase, &Now[PortIdx]);
+
+    if (Port->Flags & PCIE_TOPOLOGY_PORT_PRESENT) {
+      ++Present;
+    }
+
+    if (Port->Flags & PCIE_TOPOLOGY_PORT_LINK_UP) {
+      ++Up;
+      MaxLinkUpUs = MAX (MaxLinkUpUs, Port->LinkUpUs);
+      CfgWaitUs  += Port->CfgWaitUs;
+      Print (
+        L"%3u  0x%016lx %7u %7u %7u  %4u  Gen%u x%-2u   Gen%u x%-2u   Gen%u x%-2u%s\n",
+        PortIdx,
+        Port->DbiBase,
+        Port->DetectUs,
+        Port->LinkUpUs,
+        Port->CfgWaitUs,
+        Port->Retrains,
+        Port->Speed,
+        Port->Width,
+        Now[PortIdx].Speed,
+        Now[PortIdx].Width,
+        Now[PortIdx].MaxSpeed,
+        Now[PortIdx].MaxWidth,
+        PcieLinkReportIsDegraded (Port, &Now[PortIdx]) ? L" degraded" : L""
+        );
+      if (PcieLinkReportIsDegraded (Port, &Now[PortIdx])) {
+        ++Degraded;
+      }
+    } else {
+      Print (
+        L"%3u  0x%016lx %7a %7a %7a  %4u  %-9a  %-9a  Gen%u x%-2u\n",
+        PortIdx,
+        Port->DbiBase,
+        (Port->Flags & PCIE_TOPOLOGY_PORT_PRESENT) ? "-" : "empty",
+        "-",
+        "-",
+        Port->Retrains,
+        "down",
+        "down",
+        Now[PortIdx].MaxSpeed,
+        Now[PortIdx].MaxWidth
+        );
+    }
+  }
+
+  Print (L"\n");
+  Print (L"Ports: %u, present: %u, up: %u, degraded: %u\n", PortIdx, Present, Up, Degraded);
+  Print (
+    L"Link training: %lu us, slowest link up: %u us, config wait total: %lu us\n",
+    Stats.TrainingUs,
+    MaxLinkUpUs,
+    CfgWaitUs
+    );
+
+  if (JsonFile != NULL) {
+    Status = PcieLinkReportSave (JsonFile, PcieLinkReportJson, &Stats, Now);
+    if (EFI_ERROR (Status)) {
+      Print (L"Unable to save %s: %r\n", JsonFile, Status);
+      return Status;
+    }
+  }
+
+  if (CsvFile != NULL) {
+    Status = PcieLinkReportSave (CsvFile, PcieLinkReportCsv, &Stats, Now);
+    if (EFI_ERROR (Status)) {
+      Print (L"Unable to save %s: %r\n", CsvFile, Status);
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
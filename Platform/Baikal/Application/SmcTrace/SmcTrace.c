@@ -0,0 +1,266 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/ShellLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/ShellParameters.h>
+#include <Protocol/SmcTrace.h>
+
+typedef struct {
+  UINT32        FunctionId;
+  CONST CHAR16  *Name;
+} SMC_TRACE_NAME;
+
+STATIC CONST SMC_TRACE_NAME  mSmcTraceNames[] = {
+  { 0xC2000000, L"CMU" },
+  { 0xC2000002, L"FLASH_WRITE" },
+  { 0xC2000003, L"FLASH_READ" },
+  { 0xC2000004, L"FLASH_ERASE" },
+  { 0xC2000005, L"FLASH_PUSH" },
+  { 0xC2000006, L"FLASH_PULL" },
+  { 0xC2000007, L"FLASH_POSITION" },
+  { 0xC2000008, L"FLASH_INFO" },
+  { 0xC2000009, L"FLASH_LOCK" },
+  { 0xC2000202, L"EFUSE_GET_LOT" },
+  { 0xC2000203, L"EFUSE_GET_SERIAL" },
+  { 0xC2000204, L"EFUSE_GET_MAC" },
+  { 0xC2000401, L"CLK_SET" },
+  { 0xC2000402, L"CLK_GET" },
+  { 0xC2000500, L"GMAC_DIV2_ENABLE" },
+  { 0xC2000501, L"GMAC_DIV2_DISABLE" }
+};
+
+STATIC
+CONST CHAR16 *
+SmcTraceName (
+  IN UINT32  FunctionId
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mSmcTraceNames); ++Index) {
+    if (mSmcTraceNames[Index].FunctionId == FunctionId) {
+      return mSmcTraceNames[Index].Name;
+    }
+  }
+
+  return L"";
+}
+
+STATIC
+VOID
+SmcTracePrintStat (
+  IN CONST CHAR8           *ModuleName,
+  IN CONST SMC_TRACE_STAT  *Stat
+  )
+{
+  Print (
+    L"%-20a 0x%08x %-18s %8lu %10lu %8lu %8lu\n",
+    ModuleName,
+    Stat->FunctionId,
+    SmcTraceName (Stat->FunctionId),
+    Stat->Count,
+    GetTimeInNanoSecond (Stat->TotalTicks) / 1000,
+    Stat->Count ? GetTimeInNanoSecond (Stat->TotalTicks) / Stat->Count / 1000 : 0,
+    GetTimeInNanoSecond (Stat->MaxTicks) / 1000
+    );
+}
+
+STATIC
+VOID
+SmcTraceSummary (
+  IN SMC_TRACE_MODULE  **Modules,
+  IN UINTN             ModuleCount,
+  IN BOOLEAN           PerModule
+  )
+{
+  SMC_TRACE_STAT  Totals[SMC_TRACE_MAX_FUNCTIONS];
+  UINTN           TotalCount = 0;
+  UINTN           Index;
+  UINTN           StatIndex;
+  UINTN           TotalIndex;
+  UINT64          Ticks = 0;
+  UINT64          Dropped = 0;
+  SMC_TRACE_STAT  *Stat;
+
+  Print (L"%-20s %-10s %-18s %8s %10s %8s %8s\n", L"Module", L"Function", L"", L"Calls", L"Total(us)", L"Avg(us)", L"Max(us)");
+
+  ZeroMem (Totals, sizeof (Totals));
+  for (Index = 0; Index < ModuleCount; ++Index) {
+    Dropped += Modules[Index]->Dropped;
+    for (StatIndex = 0; StatIndex < Modules[Index]->StatCount; ++StatIndex) {
+      Stat = &Modules[Index]->Stats[StatIndex];
+      if (PerModule) {
+        SmcTracePrintStat (Modules[Index]->ModuleName, Stat);
+      }
+
+      for (TotalIndex = 0; TotalIndex < TotalCount; ++TotalIndex) {
+        if (Totals[TotalIndex].FunctionId == Stat->FunctionId) {
+          break;
+        }
+      }
+
+      if (TotalIndex == TotalCount) {
+        if (TotalCount == SMC_TRACE_MAX_FUNCTIONS) {
+          Dropped += Stat->Count;
+          continue;
+        }
+
+        Totals[TotalCount++].FunctionId = Stat->FunctionId;
+      }
+
+      Totals[TotalIndex].Count      += Stat->Count;
+      Totals[TotalIndex].TotalTicks += Stat->TotalTicks;
+      Totals[TotalIndex].MaxTicks    = MAX (Totals[TotalIndex].MaxTicks, Stat->MaxTicks);
+      Ticks += Stat->TotalTicks;
+    }
+  }
+
+  for (TotalIndex = 0; TotalIndex < TotalCount; ++TotalIndex) {
+    SmcTracePrintStat ("(all)", &Totals[TotalIndex]);
+  }
+
+  Print (
+    L"%u modules, %lu us in the secure monitor, %lu calls not accounted\n",
+    ModuleCount,
+    GetTimeInNanoSecond (Ticks) / 1000,
+    Dropped
+    );
+}
+
+STATIC
+VOID
+SmcTraceDump (
+  IN SMC_TRACE_MODULE  **Modules,
+  IN UINTN             ModuleCount,
+  IN UINTN             Count
+  )
+{
+  UINTN            *Taken;
+  UINTN            Index;
+  UINTN            Best;
+  SMC_TRACE_MODULE *Module;
+  SMC_TRACE_ENTRY  *Entry;
+  SMC_TRACE_ENTRY  *BestEntry;
+
+  //
+  // Merge the per module rings by timestamp, newest entries first
+  //
+  Taken = AllocateZeroPool (ModuleCount * sizeof (UINTN));
+  if (Taken == NULL) {
+    return;
+  }
+
+  Print (L"%14s %10s %-20s %-10s %-18s %s\n", L"Time(us)", L"Lat(us)", L"Module", L"Function", L"", L"Arg1");
+  while (Count--) {
+    BestEntry = NULL;
+    Best      = 0;
+    for (Index = 0; Index < ModuleCount; ++Index) {
+      Module = Modules[Index];
+      if (Module->Trace == NULL || Taken[Index] >= MIN (Module->TraceHead, Module->TraceSize)) {
+        continue;
+      }
+
+      Entry = &Module->Trace[(Module->TraceHead - 1 - Taken[Index]) % Module->TraceSize];
+      if (BestEntry == NULL || Entry->Timestamp > BestEntry->Timestamp) {
+        BestEntry = Entry;
+        Best      = Index;
+      }
+    }
+
+    if (BestEntry == NULL) {
+      break;
+    }
+
+    ++Taken[Best];
+    Print (
+      L"%14lu %10lu %-20a 0x%08x %-18s 0x%x\n",
+      GetTimeInNanoSecond (BestEntry->Timestamp) / 1000,
+      GetTimeInNanoSecond (BestEntry->Ticks) / 1000,
+      Modules[Best]->ModuleName,
+      BestEntry->FunctionId,
+      SmcTraceName (BestEntry->FunctionId),
+      BestEntry->Arg1
+      );
+  }
+
+  FreePool (Taken);
+}
+
+EFI_STATUS
+EFIAPI
+SmcTraceMain (
+  IN  EFI_HANDLE         ImageHandle,
+  IN  EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS                     Status;
+  EFI_SHELL_PARAMETERS_PROTOCOL  *ShellParameters;
+  SMC_TRACE_PROTOCOL             *SmcTrace;
+  SMC_TRACE_MODULE               **Modules;
+  UINTN                          ModuleCount;
+  CHAR16                         **Argv;
+  UINTN                          Argc;
+
+  Status = gBS->HandleProtocol (
+                  gImageHandle,
+                  &gEfiShellParametersProtocolGuid,
+                  (VOID **) &ShellParameters
+                  );
+  if (EFI_ERROR (Status)) {
+    Print (L"Please use UEFI Shell to run this application.\n");
+    return Status;
+  }
+
+  Argc = ShellParameters->Argc;
+  Argv = ShellParameters->Argv;
+
+  if (Argc > 3 ||
+      (Argc > 1 &&
+       StrCmp (Argv[1], L"-m") &&
+       StrCmp (Argv[1], L"-r") &&
+       (StrCmp (Argv[1], L"-t") || Argc != 3))) {
+    Print (L"Show the time spent in Baikal secure monitor services.\n");
+    Print (L"\n");
+    Print (L"SMCTRACE [-m | -r | -t count]\n");
+    Print (L"\n");
+    Print (L"  -m          - Show statistics per module.\n");
+    Print (L"  -r          - Reset statistics and trace.\n");
+    Print (L"  -t count    - Show the last 'count' calls recorded in the trace buffers.\n");
+    Print (L"\n");
+    Print (L"NOTES:\n");
+    Print (L"  1. Only modules built with the SmcTraceLib instance of SmcLib are accounted.\n");
+    Print (L"  2. The trace buffers are enabled with PcdSmcTraceRingSize.\n");
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->LocateProtocol (&gSmcTraceProtocolGuid, NULL, (VOID **)&SmcTrace);
+  if (EFI_ERROR (Status)) {
+    Print (L"SmcTrace: SMC tracing is not enabled in this firmware.\n");
+    return EFI_NOT_FOUND;
+  }
+
+  Status = SmcTrace->GetModules (SmcTrace, &Modules, &ModuleCount);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  if (Argc == 1) {
+    SmcTraceSummary (Modules, ModuleCount, FALSE);
+  } else if (!StrCmp (Argv[1], L"-m")) {
+    SmcTraceSummary (Modules, ModuleCount, TRUE);
+  } else if (!StrCmp (Argv[1], L"-r")) {
+    SmcTrace->Reset (SmcTrace);
+  } else {
+    SmcTraceDump (Modules, ModuleCount, ShellStrToUintn (Argv[2]));
+  }
+
+  return EFI_SUCCESS;
+}
@@ -5,13 +5,16 @@
 
 #include <IndustryStandard/Acpi.h>
 #include <IndustryStandard/Pci22.h>
+#include <Library/AmlPatchLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PrintLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
 #include <Platform/ConfigVars.h>
 #include <Protocol/AcpiTable.h>
+#include <Protocol/PciEnumerationComplete.h>
 #include <Protocol/PciIo.h>
 
 #include <BM1000.h>
@@ -20,12 +23,6 @@
 // DeviceOp PkgLength NameString
 #define MAX_DEV_MATCH_LEN   (2 + 4 + 4)
 
-#define NAMEOP_PATTERN_LEN  5
-#define AML_NAMEOP_8        0x0A
-#define AML_NAMEOP_16       0x0B
-#define AML_NAMEOP_32       0x0C
-#define AML_NAMEOP_64       0x0E
-
 #define PPB_IO_RANGE        2
 #define PPB_MEM32_RANGE     3
 #define PPB_PMEM32_RANGE    4
@@ -36,6 +33,8 @@ extern unsigned char  ssdtpciecustom_aml_code[];
 extern unsigned char  ssdtpcieecam_aml_code[];
 
 STATIC EFI_ACPI_TABLE_PROTOCOL  *mAcpiTableProtocol;
+STATIC VOID                     *mPcieRegistration;
+STATIC BOOLEAN                   mPcieTablesInstalled;
 STATIC VOID                     *mPioRegistration;
 
 STATIC
@@ -56,6 +55,10 @@ SsdtPcieInit (
 {
   if (PcdGet32 (PcdAcpiPcieMode) == ACPI_PCIE_CUSTOM) {
      *Table = (EFI_ACPI_DESCRIPTION_HEADER *) ssdtpciecustom_aml_code;
+     //
+     // Hide the controllers that have come up without a link
+     //
+     AmlPatchName (*Table, "LNKM", PcdGet32 (PcdPcieLinkMask));
      return EFI_SUCCESS;
   }
 
@@ -91,67 +94,113 @@ STATIC BAIKAL_ACPI_INIT_FUNCTION  AcpiTableInit[] = {
   &GtdtInit,
   &IortInit,
   &MadtInit,
-  &McfgInit,
   &PmttInit,
   &PpttInit,
-  &SpcrInit,
+  &SpcrInit
+};
+
+//
+// These only describe the controllers with a link, so they are built once
+// PCI enumeration is complete and PcdPcieLinkMask also has the links that
+// have come up after PciHostBridgeLib trained them, or at ReadyToBoot if
+// PCI is not enumerated at all
+//
+STATIC BAIKAL_ACPI_INIT_FUNCTION  AcpiPcieTableInit[] = {
+  &McfgInit,
   &SsdtPcieInit
 };
 
 STATIC
-EFI_STATUS
-FindAndPatchNameOp (
-  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
-  IN  CHAR8                        *Name,
-  IN  UINT64                        Value
+VOID
+AcpiInstallTables (
+  IN  BAIKAL_ACPI_INIT_FUNCTION  *TableInit,
+  IN  UINTN                       TableCount
   )
 {
-  CHAR8  *Data = (VOID *) (Table + 1);
-  CHAR8  *DataEnd = Data + Table->Length -
-                    sizeof (EFI_ACPI_DESCRIPTION_HEADER) - NAMEOP_PATTERN_LEN;
-  CHAR8   Pattern[NAMEOP_PATTERN_LEN];
-
-  Pattern[0] = 0x08;
-  Pattern[1] = Name[0];
-  Pattern[2] = Name[1];
-  Pattern[3] = Name[2];
-  Pattern[4] = Name[3];
+  EFI_ACPI_DESCRIPTION_HEADER  *AcpiTable;
+  UINTN                         Idx;
+  EFI_STATUS                    Status;
+  UINTN                         TableHandle;
 
-  while (Data < DataEnd) {
-    if (CompareMem (Data, Pattern, NAMEOP_PATTERN_LEN) == 0) {
-      switch (Data[NAMEOP_PATTERN_LEN]) {
-      case AML_NAMEOP_64:
-        Data[NAMEOP_PATTERN_LEN + 8] = (Value >> 56) & 0xFF;
-        Data[NAMEOP_PATTERN_LEN + 7] = (Value >> 48) & 0xFF;
-        Data[NAMEOP_PATTERN_LEN + 6] = (Value >> 40) & 0xFF;
-        Data[NAMEOP_PATTERN_LEN + 5] = (Value >> 32) & 0xFF;
-      case AML_NAMEOP_32:
-        Data[NAMEOP_PATTERN_LEN + 4] = (Value >> 24) & 0xFF;
-        Data[NAMEOP_PATTERN_LEN + 3] = (Value >> 16) & 0xFF;
-      case AML_NAMEOP_16:
-        Data[NAMEOP_PATTERN_LEN + 2] = (Value >> 8) & 0xFF;
-      case AML_NAMEOP_8:
-        Data[NAMEOP_PATTERN_LEN + 1] = Value & 0xFF;
-        break;
-      default:
-        DEBUG ((
-          EFI_D_ERROR,
-          "Couldn't patch %a of kind 0x%x\n",
-          Name,
-          Data[NAMEOP_PATTERN_LEN]
-          ));
-        return EFI_UNSUPPORTED;
-      }
+  for (Idx = 0; Idx < TableCount; ++Idx) {
+    Status = (*TableInit[Idx]) (&AcpiTable);
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
 
-      DEBUG ((EFI_D_ERROR, "Patched %a with 0x%lx\n", Name, Value));
-      return EFI_SUCCESS;
+    Status = mAcpiTableProtocol->InstallAcpiTable (
+                                   mAcpiTableProtocol,
+                                   AcpiTable,
+                                   AcpiTable->Length,
+                                   &TableHandle
+                                   );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((
+        DEBUG_ERROR,
+        "ERROR: Failed to Install ACPI Table. Status = %r\n",
+        Status
+        ));
+        continue;
     }
 
-    Data++;
-  };
+    DEBUG ((
+      DEBUG_INFO,
+      "INFO: ACPI Table installed. Status = %r\n",
+      Status
+      ));
+  }
+}
 
-  DEBUG ((EFI_D_ERROR, "Couldn't find %a\n", Name));
-  return EFI_NOT_FOUND;
+STATIC
+VOID
+AcpiInstallPcieTables (
+  VOID
+  )
+{
+  if (!mPcieTablesInstalled) {
+    mPcieTablesInstalled = TRUE;
+    AcpiInstallTables (AcpiPcieTableInit, ARRAY_SIZE (AcpiPcieTableInit));
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+OnPciEnumerationComplete (
+  IN  EFI_EVENT   Event,
+  IN  VOID       *Context
+  )
+{
+  VOID        *Interface;
+  EFI_STATUS   Status;
+
+  Status = gBS->LocateProtocol (&gEfiPciEnumerationCompleteProtocolGuid, NULL, &Interface);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+  AcpiInstallPcieTables ();
+}
+
+STATIC
+VOID
+EFIAPI
+AcpiPcieReadyToBoot (
+  IN  EFI_EVENT   Event,
+  IN  VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+
+  //
+  // Nothing has enumerated PCI, e.g. no PCI driver is dispatched on this
+  // boot path: describe the links that PciHostBridgeLib has trained
+  //
+  if (!mPcieTablesInstalled) {
+    DEBUG ((DEBUG_WARN, "WARN: No PCI enumeration, installing PCIe tables at ReadyToBoot\n"));
+    AcpiInstallPcieTables ();
+  }
 }
 
 STATIC
@@ -223,43 +272,43 @@ GeneratePcieSsdt (
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "_UID", Segment))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "_UID", Segment))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "_SEG", Segment))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "_SEG", Segment))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "RUID", Index))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "RUID", Index))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "CFGB", CfgBases[Index] + (RidBus << 20)))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "CFGB", CfgBases[Index] + (RidBus << 20)))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "MB32", Mem32Desc != NULL ? Mem32Desc->AddrRangeMin : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "MB32", Mem32Desc != NULL ? Mem32Desc->AddrRangeMin : 0))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "MS32", Mem32Desc != NULL ? Mem32Desc->AddrLen : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "MS32", Mem32Desc != NULL ? Mem32Desc->AddrLen : 0))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "MBPF", PMemDesc != NULL ? PMemDesc->AddrRangeMin : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "MBPF", PMemDesc != NULL ? PMemDesc->AddrRangeMin : 0))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "MSPF", PMemDesc != NULL ? PMemDesc->AddrLen : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "MSPF", PMemDesc != NULL ? PMemDesc->AddrLen : 0))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "IOCA", IoDesc != NULL ? IoDesc->AddrRangeMin : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "IOCA", IoDesc != NULL ? IoDesc->AddrRangeMin : 0))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "IOBA", IoDesc != NULL ? IoDesc->AddrRangeMin + IoDesc->AddrTranslationOffset : 0))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "IOBA", IoDesc != NULL ? IoDesc->AddrRangeMin + IoDesc->AddrTranslationOffset : 0))) {
     goto error;
   }
 
@@ -276,11 +325,11 @@ GeneratePcieSsdt (
     Iosi = IoDesc->AddrLen - EFI_PAGE_SIZE;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "IOSI", Iosi))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "IOSI", Iosi))) {
     goto error;
   }
 
-  if (EFI_ERROR (FindAndPatchNameOp (NewTb, "BUSC", 1))) {
+  if (EFI_ERROR (AmlPatchName (NewTb, "BUSC", 1))) {
     goto error;
   }
 
@@ -509,11 +558,8 @@ AcpiPlatformDxeInitialize (
   IN EFI_SYSTEM_TABLE  *SystemTable
   )
 {
-  EFI_ACPI_DESCRIPTION_HEADER  *AcpiTable;
   EFI_EVENT                     Event;
-  UINTN                         Idx;
   EFI_STATUS                    Status;
-  UINTN                         TableHandle;
 
   Status = gBS->LocateProtocol (
                   &gEfiAcpiTableProtocolGuid,
@@ -530,33 +576,24 @@ AcpiPlatformDxeInitialize (
     return Status;
   }
 
-  for (Idx = 0; Idx < ARRAY_SIZE (AcpiTableInit); ++Idx) {
-    Status = (*AcpiTableInit[Idx]) (&AcpiTable);
-    if (EFI_ERROR (Status)) {
-      continue;
-    }
+  AcpiInstallTables (AcpiTableInit, ARRAY_SIZE (AcpiTableInit));
 
-    Status = mAcpiTableProtocol->InstallAcpiTable (
-                                   mAcpiTableProtocol,
-                                   AcpiTable,
-                                   AcpiTable->Length,
-                                   &TableHandle
-                                   );
-    if (EFI_ERROR (Status)) {
-      DEBUG ((
-        DEBUG_ERROR,
-        "ERROR: Failed to Install ACPI Table. Status = %r\n",
-        Status
-        ));
-        continue;
-    }
+  Event = EfiCreateProtocolNotifyEvent (
+            &gEfiPciEnumerationCompleteProtocolGuid,
+            TPL_CALLBACK,
+            OnPciEnumerationComplete,
+            NULL,
+            &mPcieRegistration
+            );
+  ASSERT (Event != NULL);
 
-    DEBUG ((
-      DEBUG_INFO,
-      "INFO: ACPI Table installed. Status = %r\n",
-      Status
-      ));
-  }
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             AcpiPcieReadyToBoot,
+             NULL,
+             &Event
+             );
+  ASSERT_EFI_ERROR (Status);
 
   if (PcdGet32 (PcdAcpiPcieMode) == ACPI_PCIE_ECAM) {
     Status = gBS->CreateEvent (
@@ -6,6 +6,7 @@
 
 #include <IndustryStandard/Acpi.h>
 #include <IndustryStandard/MemoryMappedConfigurationSpaceAccessTable.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/PcdLib.h>
 
 #include <BM1000.h>
@@ -74,6 +75,52 @@ STATIC BAIKAL_ACPI_MCFG  Mcfg = {
 };
 #pragma pack()
 
+//
+// Controller index of each real segment
+//
+STATIC CONST UINTN  McfgPcieIdxs[BAIKAL_ACPI_PCIE_COUNT] = {
+  BM1000_PCIE0_IDX,
+#ifdef BAIKAL_ACPI_PCIE1_SEGMENT
+  BM1000_PCIE1_IDX,
+#endif
+#ifdef BAIKAL_ACPI_PCIE2_SEGMENT
+  BM1000_PCIE2_IDX
+#endif
+};
+
+//
+// Drop the entries of the controllers that have come up without a link
+// and shrink the table accordingly
+//
+STATIC
+VOID
+McfgDropDeadSegments (
+  VOID
+  )
+{
+  UINTN   Idx;
+  UINTN   Num;
+  UINTN   Count;
+  UINT16  Segment;
+  UINT32  PcieLinkMask = PcdGet32 (PcdPcieLinkMask);
+
+  Count = (Mcfg.Header.Header.Length - sizeof (Mcfg.Header)) / sizeof (Mcfg.Table[0]);
+  for (Idx = 0, Num = 0; Idx < Count; ++Idx) {
+    Segment = Mcfg.Table[Idx].PciSegmentGroupNumber;
+#ifndef ELPITECH
+    if (Segment >= BAIKAL_ACPI_PCIE_COUNT) {
+      Segment = Segment / 10 - 1;
+    }
+#endif
+
+    if (PcieLinkMask & (1 << McfgPcieIdxs[Segment])) {
+      CopyMem (&Mcfg.Table[Num++], &Mcfg.Table[Idx], sizeof (Mcfg.Table[0]));
+    }
+  }
+
+  Mcfg.Header.Header.Length = sizeof (Mcfg.Header) + Num * sizeof (Mcfg.Table[0]);
+}
+
 EFI_STATUS
 McfgInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
@@ -97,6 +144,7 @@ McfgInit (
     }
 #endif
 
+    McfgDropDeadSegments ();
     *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Mcfg;
     return EFI_SUCCESS;
 
@@ -129,6 +177,7 @@ McfgInit (
     Mcfg.Table[BAIKAL_ACPI_PCIE2_SEGMENT].EndBusNumber = 0;
 #endif
 
+    McfgDropDeadSegments ();
     *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Mcfg;
     return EFI_SUCCESS;
   }
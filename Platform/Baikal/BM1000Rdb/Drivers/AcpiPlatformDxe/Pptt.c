@@ -5,9 +5,12 @@
 
 #include <IndustryStandard/Acpi.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/CacheInfoLib.h>
 
 #include "AcpiPlatform.h"
 
+#include <BM1000.h>
+
 #define BAIKAL_PPTT_CLUSTER_NODE_COUNT  4
 #define BAIKAL_PPTT_CORE_NODE_COUNT     8
 
@@ -18,6 +21,10 @@
   - core L1 instruction cache
 */
 #define BAIKAL_PPTT_CACHE_COUNT          21
+#define BAIKAL_PPTT_L3_CACHE(Id)         (Id)
+#define BAIKAL_PPTT_L2_CACHE(Id)         (1 + (Id))
+#define BAIKAL_PPTT_L1D_CACHE(Id)        (5 + (Id))
+#define BAIKAL_PPTT_L1I_CACHE(Id)        (13 + (Id))
 #define BAIKAL_PPTT_PACKAGE_CACHE_COUNT  1
 #define BAIKAL_PPTT_CLUSTER_CACHE_COUNT  1
 #define BAIKAL_PPTT_CORE_CACHE_COUNT     2
@@ -37,17 +44,6 @@
   (IdenticalImplementation << 4)     \
 )
 
-#define BAIKAL_PPTT_CACHE_ATTRIBUTES( \
-  AllocationType,                     \
-  CacheType,                          \
-  WritePolicy                         \
-  )                                   \
-(                                     \
-  AllocationType |                    \
-  (CacheType << 2) |                  \
-  (WritePolicy << 4)                  \
-)
-
 #define BAIKAL_PPTT_CLUSTER_NODE(Id)  {                                         \
   {                                                                             \
     /* UINT8                                        Type                     */ \
@@ -66,7 +62,7 @@
     BAIKAL_PPTT_CLUSTER_CACHE_COUNT                                             \
   },                                                                            \
   /* UINT32  Resource */                                                        \
-  OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[Id - 7])                                   \
+  OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[BAIKAL_PPTT_L2_CACHE (Id - 8)])            \
 }
 
 #define BAIKAL_PPTT_CORE_NODE(Id, ClusterId)  {                                 \
@@ -88,45 +84,11 @@
   },                                                                            \
   /* UINT32  Resource[2] */                                                     \
   {                                                                             \
-    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[Id + 5]),                                \
-    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[Id + 13])                                \
+    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[BAIKAL_PPTT_L1D_CACHE (Id)]),            \
+    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[BAIKAL_PPTT_L1I_CACHE (Id)])             \
   }                                                                             \
 }
 
-#define BAIKAL_PPTT_CACHE_NODE(Size, Associativity, Id)  {             \
-  /* UINT8                                         Type             */ \
-  EFI_ACPI_6_4_PPTT_TYPE_CACHE,                                        \
-  /* UINT8                                         Length           */ \
-  sizeof (EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE),                          \
-  /* UINT8                                         Reserved[2]      */ \
-  { EFI_ACPI_RESERVED_BYTE, EFI_ACPI_RESERVED_BYTE },                  \
-  /* EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE_FLAGS       Flags            */ \
-  {                                                                    \
-    EFI_ACPI_6_4_PPTT_CACHE_SIZE_VALID,                                \
-    EFI_ACPI_6_4_PPTT_NUMBER_OF_SETS_VALID,                            \
-    EFI_ACPI_6_4_PPTT_ASSOCIATIVITY_VALID,                             \
-    EFI_ACPI_6_4_PPTT_ALLOCATION_TYPE_VALID,                           \
-    EFI_ACPI_6_4_PPTT_CACHE_TYPE_VALID,                                \
-    EFI_ACPI_6_4_PPTT_WRITE_POLICY_VALID,                              \
-    EFI_ACPI_6_4_PPTT_LINE_SIZE_VALID,                                 \
-    EFI_ACPI_6_4_PPTT_CACHE_ID_VALID                                   \
-  },                                                                   \
-  /* UINT32                                        NextLevelOfCache */ \
-  0,                                                                   \
-  /* UINT32                                        Size             */ \
-  Size,                                                                \
-  /* UINT32                                        NumberOfSets     */ \
-  Size / (Associativity * 64),                                         \
-  /* UINT8                                         Associativity    */ \
-  Associativity,                                                       \
-  /* EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE_ATTRIBUTES  Attributes       */ \
-  {},                                                                  \
-  /* UINT16                                        LineSize         */ \
-  64,                                                                  \
-  /* UINT32                                        CacheId          */ \
-  Id                                                                   \
-}
-
 #pragma pack(1)
 typedef struct {
   EFI_ACPI_6_4_PPTT_STRUCTURE_PROCESSOR  Node;
@@ -173,7 +135,7 @@ STATIC BAIKAL_ACPI_PPTT  Pptt = {
       BAIKAL_PPTT_PACKAGE_CACHE_COUNT
     },
     /* UINT32  Resource */
-    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[0])
+    OFFSET_OF (BAIKAL_ACPI_PPTT, Cache[BAIKAL_PPTT_L3_CACHE (0)])
   },
   {
     BAIKAL_PPTT_CLUSTER_NODE (8),
@@ -190,29 +152,6 @@ STATIC BAIKAL_ACPI_PPTT  Pptt = {
     BAIKAL_PPTT_CORE_NODE (5, 2),
     BAIKAL_PPTT_CORE_NODE (6, 3),
     BAIKAL_PPTT_CORE_NODE (7, 3)
-  },
-  {
-    BAIKAL_PPTT_CACHE_NODE (0x800000, 16, 1),
-    BAIKAL_PPTT_CACHE_NODE (0x100000, 16, 2),
-    BAIKAL_PPTT_CACHE_NODE (0x100000, 16, 3),
-    BAIKAL_PPTT_CACHE_NODE (0x100000, 16, 4),
-    BAIKAL_PPTT_CACHE_NODE (0x100000, 16, 5),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 6),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 7),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 8),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 9),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 10),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 11),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 12),
-    BAIKAL_PPTT_CACHE_NODE (0x8000, 2, 13),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 14),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 15),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 16),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 17),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 18),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 19),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 20),
-    BAIKAL_PPTT_CACHE_NODE (0xC000, 3, 21)
   }
 };
 #pragma pack()
@@ -222,9 +161,11 @@ PpttInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
-  UINT8   CacheAttributes;
-  UINT8   Idx;
-  UINT32  ProcNodeFlags;
+  CACHE_INFO  Caches[BM1000_CACHE_COUNT] = BM1000_CACHE_INFO;
+  UINTN       Idx;
+  UINT32      ProcNodeFlags;
+
+  CacheInfoProbe (Caches, ARRAY_SIZE (Caches));
 
   ProcNodeFlags = BAIKAL_PPTT_PROC_NODE_FLAGS (
     EFI_ACPI_6_4_PPTT_PACKAGE_PHYSICAL,
@@ -257,31 +198,35 @@ PpttInit (
     CopyMem (&Pptt.Core[Idx].Node.Flags, &ProcNodeFlags, sizeof (ProcNodeFlags));
   }
 
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ_WRITE,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_UNIFIED,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
+  CacheInfoToPpttCache (
+    &Pptt.Cache[BAIKAL_PPTT_L3_CACHE (0)],
+    &Caches[BM1000_CACHE_L3],
+    0,
+    CACHE_INFO_ID (0, BM1000_CACHE_L3, 0)
     );
-  for (Idx = 0; Idx < 5; ++Idx) {
-    CopyMem (&Pptt.Cache[Idx].Attributes, &CacheAttributes, sizeof (CacheAttributes));
-  }
 
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ_WRITE,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_DATA,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
-    );
-  for (Idx = 5; Idx < 13; ++Idx) {
-    CopyMem (&Pptt.Cache[Idx].Attributes, &CacheAttributes, sizeof (CacheAttributes));
+  for (Idx = 0; Idx < BAIKAL_PPTT_CLUSTER_NODE_COUNT; ++Idx) {
+    CacheInfoToPpttCache (
+      &Pptt.Cache[BAIKAL_PPTT_L2_CACHE (Idx)],
+      &Caches[BM1000_CACHE_L2],
+      0,
+      CACHE_INFO_ID (0, BM1000_CACHE_L2, Idx)
+      );
   }
 
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_INSTRUCTION,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
-    );
-  for (Idx = 13; Idx < BAIKAL_PPTT_CACHE_COUNT; ++Idx) {
-    CopyMem (&Pptt.Cache[Idx].Attributes, &CacheAttributes, sizeof (CacheAttributes));
+  for (Idx = 0; Idx < BAIKAL_PPTT_CORE_NODE_COUNT; ++Idx) {
+    CacheInfoToPpttCache (
+      &Pptt.Cache[BAIKAL_PPTT_L1D_CACHE (Idx)],
+      &Caches[BM1000_CACHE_L1D],
+      0,
+      CACHE_INFO_ID (0, BM1000_CACHE_L1D, Idx)
+      );
+    CacheInfoToPpttCache (
+      &Pptt.Cache[BAIKAL_PPTT_L1I_CACHE (Idx)],
+      &Caches[BM1000_CACHE_L1I],
+      0,
+      CACHE_INFO_ID (0, BM1000_CACHE_L1I, Idx)
+      );
   }
 
   *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Pptt;
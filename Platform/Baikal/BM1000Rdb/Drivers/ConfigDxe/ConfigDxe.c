@@ -294,6 +294,8 @@ FixupFdt (
     return;
   }
 
+  FdtClient->BeginUpdate (FdtClient);
+
 #if defined(ELP_2) || defined(ELP_5) || defined(ELP_7) || defined(ELP_8)
   if (PcdGet32(PcdVduLvdsMode) == 0) {
     Status = FdtClient->FindNodeByAlias (FdtClient, "vdu-lvds", &Node);
@@ -377,6 +379,11 @@ FixupFdt (
       DEBUG((EFI_D_ERROR, "Can't delete dma-coherent property - %r\n", Status));
     }
   }
+
+  Status = FdtClient->CommitUpdate (FdtClient);
+  if (EFI_ERROR(Status)) {
+    DEBUG((EFI_D_ERROR, "Can't apply FDT fixups - %r\n", Status));
+  }
 }
 
 STATIC
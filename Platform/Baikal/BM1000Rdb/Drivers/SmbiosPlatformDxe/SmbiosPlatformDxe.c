@@ -10,16 +10,20 @@
 #include <Library/BaikalSpdLib.h>
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/CacheInfoLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PrintLib.h>
 #include <Library/SmcEfuseLib.h>
+#include <Library/SmcLib.h>
 #include <Library/TimeBaseLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Protocol/FdtClient.h>
 #include <Protocol/FruClient.h>
 #include <Protocol/Smbios.h>
 
+#include <BM1000.h>
+
 STATIC CHAR8  BaikalModel[10];
 
 STATIC
@@ -479,8 +483,8 @@ SmbiosTable3Init (
 #define BAIKAL_PROCESSOR_SOCKET_DESIGNATION  "CPU0"
 #define BAIKAL_PROCESSOR_MANUFACTURER        "Baikal Electronics"
 #define BAIKAL_PROCESSOR_VERSION             "BE-M1000"
-#define BAIKAL_PROCESSOR_CORE_COUNT          8
-#define BAIKAL_PROCESSOR_CLUSTER_COUNT       4
+#define BAIKAL_PROCESSOR_CORE_COUNT          BM1000_CORE_COUNT
+#define BAIKAL_PROCESSOR_CLUSTER_COUNT       BM1000_CLUSTER_COUNT
 #define BAIKAL_PROCESSOR_SERIAL_STR_SIZE     9
 #define BAIKAL_PROCESSOR_PART_STR_SIZE       7
 
@@ -503,9 +507,9 @@ STATIC SMBIOS_TABLE_TYPE4 SmbiosTable4 = {
   1500,
   BIT6 | 1,
   ProcessorUpgradeNone,
-  BAIKAL_SMBIOS_TABLE_HANDLE (7, 1),
-  BAIKAL_SMBIOS_TABLE_HANDLE (7, 2),
-  BAIKAL_SMBIOS_TABLE_HANDLE (7, 3),
+  BAIKAL_SMBIOS_TABLE_HANDLE (7, BM1000_CACHE_L1D),
+  BAIKAL_SMBIOS_TABLE_HANDLE (7, BM1000_CACHE_L2),
+  BAIKAL_SMBIOS_TABLE_HANDLE (7, BM1000_CACHE_L3),
   0,
   0,
   0,
@@ -547,7 +551,7 @@ SmbiosTable4Init (
   ArmSmcArgs.Arg1 = BM1000_CA57_0_BASE;
   ArmSmcArgs.Arg2 = BAIKAL_SMC_CMU_PLL_GET_RATE;
   ArmSmcArgs.Arg4 = 0;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   SmbiosTable4.CurrentSpeed = ArmSmcArgs.Arg0 / 1000000;
 
   ArmSmcParam = SMCCC_ARCH_SOC_ID;
@@ -605,102 +609,100 @@ SmbiosTable4Init (
 
 // Cache Information tables, type 7
 
-#pragma pack(1)
-STATIC VOID  *SmbiosTable7[] = {
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L1 Instruction"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 0)
-      },
-      1,
-      0x180,
-      48 * BAIKAL_PROCESSOR_CORE_COUNT,
-      48 * BAIKAL_PROCESSOR_CORE_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorParity,
-      CacheTypeInstruction,
-      CacheAssociativityOther,
-      48 * BAIKAL_PROCESSOR_CORE_COUNT,
-      48 * BAIKAL_PROCESSOR_CORE_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L1 Data"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 1)
-      },
-      1,
-      0x180,
-      32 * BAIKAL_PROCESSOR_CORE_COUNT,
-      32 * BAIKAL_PROCESSOR_CORE_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorSingleBit,
-      CacheTypeData,
-      CacheAssociativity2Way,
-      32 * BAIKAL_PROCESSOR_CORE_COUNT,
-      32 * BAIKAL_PROCESSOR_CORE_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L2"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 2)
-      },
-      1,
-      0x281,
-      1024 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      1024 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorSingleBit,
-      CacheTypeUnified,
-      CacheAssociativity16Way,
-      1024 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      1024 * BAIKAL_PROCESSOR_CLUSTER_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L3"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 3)
-      },
-      1,
-      0x2A2,
-      8192,
-      8192,
-      {},
-      {},
-      0,
-      CacheErrorSingleBit,
-      CacheTypeUnified,
-      CacheAssociativityFully,
-      8192,
-      8192
-    }
-  )
+#define BAIKAL_CACHE_DESIGNATION_SIZE  16
+
+// Indexed like the BM1000_CACHE_INFO table
+STATIC CONST UINT8  SmbiosTable7ErrorCorrection[BM1000_CACHE_COUNT] = {
+  CacheErrorParity,     // L1I
+  CacheErrorSingleBit,  // L1D
+  CacheErrorSingleBit,  // L2
+  CacheErrorSingleBit   // L3
 };
-#pragma pack()
+
+STATIC
+UINT16
+SmbiosTable7Configuration (
+  IN  CONST CACHE_INFO  *Cache
+  )
+{
+  UINT16  Mode;
+
+  if ((Cache->Policy & CACHE_INFO_WRITE_BACK) &&
+      (Cache->Policy & CACHE_INFO_WRITE_THROUGH)) {
+    Mode = 2;   // Varies with memory address
+  } else if (Cache->Policy & CACHE_INFO_WRITE_BACK) {
+    Mode = 1;
+  } else if (Cache->Policy & CACHE_INFO_WRITE_THROUGH) {
+    Mode = 0;
+  } else {
+    Mode = 3;   // Unknown
+  }
+
+  // Level, enabled, operational mode and location (external if outside the cluster)
+  return (Cache->Level - 1) | BIT7 | (Mode << 8) |
+         (Cache->Scope == CACHE_INFO_SCOPE_PACKAGE ? BIT5 : 0);
+}
+
+STATIC
+UINT8
+SmbiosTable7Associativity (
+  IN  UINT32  Ways
+  )
+{
+  switch (Ways) {
+  case 1:
+    return CacheAssociativityDirectMapped;
+  case 2:
+    return CacheAssociativity2Way;
+  case 4:
+    return CacheAssociativity4Way;
+  case 8:
+    return CacheAssociativity8Way;
+  case 12:
+    return CacheAssociativity12Way;
+  case 16:
+    return CacheAssociativity16Way;
+  case 20:
+    return CacheAssociativity20Way;
+  case 24:
+    return CacheAssociativity24Way;
+  case 32:
+    return CacheAssociativity32Way;
+  case 48:
+    return CacheAssociativity48Way;
+  case 64:
+    return CacheAssociativity64Way;
+  default:
+    return CacheAssociativityOther;
+  }
+}
+
+// Size in KiB to the 1K/64K granularity encoding of the 16-bit size fields
+STATIC
+UINT16
+SmbiosTable7Size (
+  IN  UINT32  Size
+  )
+{
+  if (Size <= 0x7FFF) {
+    return Size;
+  }
+
+  return Size / 64 > 0x7FFF ? 0xFFFF : BIT15 | (Size / 64);
+}
+
+STATIC
+UINT32
+SmbiosTable7Size2 (
+  IN  UINT32  Size
+  )
+{
+  if (Size <= 0x7FFFFFFF) {
+    return Size;
+  }
+
+  return BIT31 | (Size / 64);
+}
 
 STATIC
 EFI_STATUS
@@ -708,13 +710,57 @@ SmbiosTable7Init (
   VOID
   )
 {
-  UINTN       Idx;
-  EFI_STATUS  Status;
+  CACHE_INFO          Caches[BM1000_CACHE_COUNT] = BM1000_CACHE_INFO;
+  CHAR8               Designation[BAIKAL_CACHE_DESIGNATION_SIZE];
+  UINTN               Idx;
+  UINTN               Instances;
+  UINT32              Size;
+  EFI_STATUS          Status;
+  CHAR8              *StringPack[1];
+  SMBIOS_TABLE_TYPE7  Table7;
+
+  CacheInfoProbe (Caches, ARRAY_SIZE (Caches));
+
+  for (Idx = 0; Idx < ARRAY_SIZE (Caches); ++Idx) {
+    if (Caches[Idx].Scope == CACHE_INFO_SCOPE_CORE) {
+      Instances = BAIKAL_PROCESSOR_CORE_COUNT;
+    } else if (Caches[Idx].Scope == CACHE_INFO_SCOPE_CLUSTER) {
+      Instances = BAIKAL_PROCESSOR_CLUSTER_COUNT;
+    } else {
+      Instances = 1;
+    }
+
+    // Total size of all instances on the chip in KiB
+    Size = (UINT32) (((UINT64) Caches[Idx].Size * Instances) / SIZE_1KB);
+
+    ZeroMem (&Table7, sizeof (Table7));
+    Table7.Hdr.Type = SMBIOS_TYPE_CACHE_INFORMATION;
+    Table7.Hdr.Length = sizeof (SMBIOS_TABLE_TYPE7);
+    Table7.Hdr.Handle = BAIKAL_SMBIOS_TABLE_HANDLE (7, Idx);
+    Table7.SocketDesignation = 1;
+    Table7.CacheConfiguration = SmbiosTable7Configuration (&Caches[Idx]);
+    *(UINT16 *) &Table7.MaximumCacheSize = SmbiosTable7Size (Size);
+    *(UINT16 *) &Table7.InstalledSize = SmbiosTable7Size (Size);
+    *(UINT16 *) &Table7.SupportedSRAMType = BIT1;
+    *(UINT16 *) &Table7.CurrentSRAMType = BIT1;
+    Table7.ErrorCorrectionType = SmbiosTable7ErrorCorrection[Idx];
+    Table7.SystemCacheType = Caches[Idx].Type == CACHE_INFO_TYPE_INSTRUCTION ? CacheTypeInstruction :
+                             Caches[Idx].Type == CACHE_INFO_TYPE_DATA ? CacheTypeData : CacheTypeUnified;
+    Table7.Associativity = SmbiosTable7Associativity (Caches[Idx].Associativity);
+    *(UINT32 *) &Table7.MaximumCacheSize2 = SmbiosTable7Size2 (Size);
+    *(UINT32 *) &Table7.InstalledSize2 = SmbiosTable7Size2 (Size);
+
+    AsciiSPrint (
+      Designation,
+      sizeof (Designation),
+      "L%u%a",
+      Caches[Idx].Level,
+      Caches[Idx].Type == CACHE_INFO_TYPE_INSTRUCTION ? " Instruction" :
+        Caches[Idx].Type == CACHE_INFO_TYPE_DATA ? " Data" : ""
+      );
 
-  for (Idx = 0; Idx < ARRAY_SIZE (SmbiosTable7); ++Idx) {
-    *(UINT16 *) &((SMBIOS_TABLE_TYPE7 *) SmbiosTable7[Idx])->SupportedSRAMType = BIT1;
-    *(UINT16 *) &((SMBIOS_TABLE_TYPE7 *) SmbiosTable7[Idx])->CurrentSRAMType = BIT1;
-    Status = CreateSmbiosTable ((EFI_SMBIOS_TABLE_HEADER *) SmbiosTable7[Idx], NULL, 0);
+    StringPack[0] = Designation;
+    Status = CreateSmbiosTable ((EFI_SMBIOS_TABLE_HEADER *) &Table7, StringPack, ARRAY_SIZE (StringPack));
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -4,7 +4,7 @@
 **/
 
 #include <Uefi.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/CmuLib.h>
 
 #define BAIKAL_SMC_CMU_CMD             0xC2000000
@@ -23,7 +23,7 @@ CmuClkChGetRate (
   ArmSmcArgs.Arg1 = ((ClkChCtlAddr & 0xFFFF) - 0x20) / 0x10; // Clock channel num
   ArmSmcArgs.Arg2 = BAIKAL_SMC_CMU_CLKCH_GET_RATE;
   ArmSmcArgs.Arg4 = ClkChCtlAddr & 0xFFFF0000; // CMU base
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -41,5 +41,5 @@ CmuClkChSetRate (
   ArmSmcArgs.Arg2 = BAIKAL_SMC_CMU_CLKCH_SET_RATE;
   ArmSmcArgs.Arg3 = ClkChRate;
   ArmSmcArgs.Arg4 = ClkChCtlAddr & 0xFFFF0000; // CMU base
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
 }
@@ -4,7 +4,7 @@
 **/
 
 #include <PiDxe.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 
 #define BAIKAL_SMC_EFUSE_GET_LOT     0xC2000202
 #define BAIKAL_SMC_EFUSE_GET_SERIAL  0xC2000203
@@ -18,7 +18,7 @@ SmcEfuseGetLot (
   ARM_SMC_ARGS  ArmSmcArgs;
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_EFUSE_GET_LOT;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -30,7 +30,7 @@ SmcEfuseGetMac (
   ARM_SMC_ARGS  ArmSmcArgs;
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_EFUSE_GET_MAC;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -42,6 +42,6 @@ SmcEfuseGetSerial (
   ARM_SMC_ARGS  ArmSmcArgs;
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_EFUSE_GET_SERIAL;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
@@ -29,6 +29,25 @@
 
 #define BAIKAL_ACPI_CLUSTER_ID(Id)  (((Id) + 1) << 8)
 
+//
+// Core idle states below WFI (see CLPI in Dsdt.asl). The DSDT is built with
+// these placeholders, LpiInit replaces them with the device tree idle-states
+// and disables the states that the device tree does not describe.
+//
+#define BAIKAL_ACPI_LPI_STATE_COUNT  2
+
+#define BAIKAL_ACPI_LPI1_RESIDENCY   0xABCDEF11
+#define BAIKAL_ACPI_LPI1_LATENCY     0xABCDEF12
+#define BAIKAL_ACPI_LPI1_FLAGS       0xABCDEF13
+#define BAIKAL_ACPI_LPI1_PARAM       0xABCDEF14
+#define BAIKAL_ACPI_LPI1_CONTEXT     0xABCDEF15
+
+#define BAIKAL_ACPI_LPI2_RESIDENCY   0xABCDEF21
+#define BAIKAL_ACPI_LPI2_LATENCY     0xABCDEF22
+#define BAIKAL_ACPI_LPI2_FLAGS       0xABCDEF23
+#define BAIKAL_ACPI_LPI2_PARAM       0xABCDEF24
+#define BAIKAL_ACPI_LPI2_CONTEXT     0xABCDEF25
+
 #ifdef BAIKAL_MBS_2S
 #define BAIKAL_SPI_OFFSET_S1  320
 #endif
@@ -191,6 +210,37 @@
 #define BAIKAL_ACPI_PCIE_MEM_MAX     0x7FFFFFFF
 #define BAIKAL_ACPI_PCIE_MEM_SIZE    0x40000000
 
+// Root bridges PC00-PC13 of each chip
+#define BAIKAL_ACPI_PCIE_ROOTS_PER_CHIP  14
+
+//
+// Base, length and translation of the 64-bit prefetchable window of root
+// bridge PC<Id>, patched by SsdtPcieInit from PcdPciePMem64Windows
+//
+#define PCIE_PMEM64_WINDOW(Id)          \
+  Name (PB##Id, 0xABCDEF0123456789)     \
+  Name (PL##Id, 0xABCDEF0123456789)     \
+  Name (PT##Id, 0xABCDEF0123456789)
+
+//
+// Append the 64-bit prefetchable window of root bridge PC<Id> to its _CRS
+// buffer if PciHostBridgeLib has set the window up
+//
+#define PCIE_PMEM64_CRS(Buffer, Id)                                            \
+  If (LNotEqual (PL##Id, Zero)) {                                              \
+    ConcatenateResTemplate (Buffer, PF64 (PB##Id, PL##Id, PT##Id), Buffer)     \
+  }
+
+//
+// Report a root bridge as present only if PciHostBridgeLib has brought its
+// link up (see LNKM in SsdtPcie.asl)
+//
+#define PCIE_LINK_STA                                                          \
+  If (And (LNKM, ShiftLeft (One, _SEG))) {                                     \
+    Return (0xF)                                                               \
+  }                                                                            \
+  Return (Zero)
+
 #define BAIKAL_ACPI_PCIE_LTSSM_STATE_MASK  0x3F
 #define BAIKAL_ACPI_PCIE_LTSSM_STATE_L0    0x11
 
@@ -3,23 +3,39 @@
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
+#include <Guid/PcieTopology.h>
 #include <IndustryStandard/Acpi.h>
+#include <Library/AmlPatchLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PrintLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
 #include <Protocol/AcpiTable.h>
+#include <Protocol/PciEnumerationComplete.h>
 
+#include <BS1000.h>
 #include "AcpiPlatform.h"
 
 extern unsigned char  dsdt_aml_code[];
 extern unsigned char  ssdtpcie_aml_code[];
 
+extern VOID LpiInit (EFI_ACPI_DESCRIPTION_HEADER  *Dsdt);
+
 STATIC
 EFI_STATUS
 DsdtInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
-  *Table = (EFI_ACPI_DESCRIPTION_HEADER *) dsdt_aml_code;
+  EFI_ACPI_DESCRIPTION_HEADER  *Dsdt = (EFI_ACPI_DESCRIPTION_HEADER *) dsdt_aml_code;
+
+  LpiInit (Dsdt);
+
+  *Table = Dsdt;
   return EFI_SUCCESS;
 }
 
@@ -29,7 +45,35 @@ SsdtPcieInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
-  *Table = (EFI_ACPI_DESCRIPTION_HEADER *) ssdtpcie_aml_code;
+  EFI_ACPI_DESCRIPTION_HEADER  *Ssdt = (EFI_ACPI_DESCRIPTION_HEADER *) ssdtpcie_aml_code;
+  CONST PCIE_PMEM64_WINDOW     *Windows;
+  UINTN                         WindowsNum;
+  UINTN                         Idx;
+  CHAR8                         Name[5];
+
+  //
+  // Give the root bridge _CRS methods the 64-bit prefetchable windows
+  // PciHostBridgeLib has set up, from the device tree or by default. The
+  // root bridges without a window are patched with zeroes.
+  //
+  Windows    = PcdGetPtr (PcdPciePMem64Windows);
+  WindowsNum = PcdGetSize (PcdPciePMem64Windows) / sizeof (PCIE_PMEM64_WINDOW);
+  for (Idx = 0; Idx < PLATFORM_CHIP_COUNT * BAIKAL_ACPI_PCIE_ROOTS_PER_CHIP; ++Idx) {
+    AsciiSPrint (Name, sizeof (Name), "PB%02u", Idx);
+    AmlPatchName (Ssdt, Name, Idx < WindowsNum ? Windows[Idx].Base : 0);
+    AsciiSPrint (Name, sizeof (Name), "PL%02u", Idx);
+    AmlPatchName (Ssdt, Name, Idx < WindowsNum ? Windows[Idx].Size : 0);
+    AsciiSPrint (Name, sizeof (Name), "PT%02u", Idx);
+    AmlPatchName (Ssdt, Name, Idx < WindowsNum ? Windows[Idx].Translation : 0);
+  }
+
+  //
+  // Tell the root bridge _STA methods which segments have a link now that
+  // enumeration is complete
+  //
+  AmlPatchName (Ssdt, "LNKM", PcdGet32 (PcdPcieLinkMask));
+
+  *Table = Ssdt;
   return EFI_SUCCESS;
 }
 
@@ -42,6 +86,7 @@ EFI_STATUS
 extern EFI_STATUS Dbg2Init (EFI_ACPI_DESCRIPTION_HEADER  **Table);
 extern EFI_STATUS FadtInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
 extern EFI_STATUS GtdtInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
+extern EFI_STATUS HmatInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
 extern EFI_STATUS IortInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
 extern EFI_STATUS MadtInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
 extern EFI_STATUS McfgInit (EFI_ACPI_DESCRIPTION_HEADER  **Table);
@@ -59,26 +104,163 @@ VOID
 
 extern VOID SratDestroy (EFI_ACPI_DESCRIPTION_HEADER  *Table);
 
-STATIC struct {
+typedef struct {
   CONST CHAR16                 *Name;
   BAIKAL_ACPI_INIT_FUNCTION     Init;
   BAIKAL_ACPI_DESTROY_FUNCTION  Destroy;
-} AcpiTableInit[] = {
+} BAIKAL_ACPI_TABLE;
+
+STATIC CONST BAIKAL_ACPI_TABLE  AcpiTableInit[] = {
   {L"DBG2", &Dbg2Init,     NULL},
   {L"DSDT", &DsdtInit,     NULL},
   {L"FADT", &FadtInit,     NULL},
   {L"GTDT", &GtdtInit,     NULL},
+  {L"HMAT", &HmatInit,     NULL},
   {L"IORT", &IortInit,     NULL},
   {L"MADT", &MadtInit,     NULL},
-  {L"MCFG", &McfgInit,     NULL},
   {L"PMTT", &PmttInit,     NULL},
   {L"PPTT", &PpttInit,     NULL},
   {L"SLIT", &SlitInit,     NULL},
   {L"SPCR", &SpcrInit,     NULL},
-  {L"SRAT", &SratInit,     &SratDestroy},
+  {L"SRAT", &SratInit,     &SratDestroy}
+};
+
+//
+// Tables that only describe the PCIe segments with a link. They are built
+// once PCI enumeration is complete, so that the links PciSegmentLib has
+// seen come up after PciHostBridgeLib trained them are included, or at
+// ReadyToBoot if PCI is not enumerated at all.
+//
+STATIC CONST BAIKAL_ACPI_TABLE  AcpiPcieTableInit[] = {
+  {L"MCFG", &McfgInit,     NULL},
   {L"SSDT", &SsdtPcieInit, NULL}
 };
 
+STATIC EFI_ACPI_TABLE_PROTOCOL  *mAcpiTableProtocol;
+STATIC VOID                     *mPcieRegistration;
+STATIC BOOLEAN                   mPcieTablesInstalled;
+
+STATIC
+UINT64
+AcpiElapsedUs (
+  IN  UINT64  Start
+  )
+{
+  return DivU64x32 (GetTimeInNanoSecond (GetPerformanceCounter () - Start), 1000);
+}
+
+//
+// InstallAcpiTable copies each table into ACPI reclaim memory and sets
+// its checksum there, so the tables are not checksummed here
+//
+STATIC
+VOID
+AcpiInstallTable (
+  IN  CONST BAIKAL_ACPI_TABLE     *Entry,
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table
+  )
+{
+  UINT64      Start;
+  EFI_STATUS  Status;
+  UINTN       TableHandle;
+
+  Start  = GetPerformanceCounter ();
+  Status = mAcpiTableProtocol->InstallAcpiTable (
+                                 mAcpiTableProtocol,
+                                 Table,
+                                 Table->Length,
+                                 &TableHandle
+                                 );
+
+  if (Entry->Destroy != NULL) {
+    (*Entry->Destroy) (Table);
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((
+      DEBUG_ERROR,
+      "ERROR: Failed to Install %s ACPI Table. Status = %r\n",
+      Entry->Name,
+      Status
+      ));
+    return;
+  }
+
+  DEBUG ((
+    DEBUG_INFO,
+    "INFO: %s ACPI Table installed in %lu us. Status = %r\n",
+    Entry->Name,
+    AcpiElapsedUs (Start),
+    Status
+    ));
+}
+
+STATIC
+VOID
+AcpiInstallPcieTables (
+  VOID
+  )
+{
+  EFI_ACPI_DESCRIPTION_HEADER  *AcpiTable;
+  UINTN                         Idx;
+  EFI_STATUS                    Status;
+
+  if (mPcieTablesInstalled) {
+    return;
+  }
+
+  mPcieTablesInstalled = TRUE;
+
+  DEBUG ((DEBUG_INFO, "INFO: PCIe link mask 0x%x\n", PcdGet32 (PcdPcieLinkMask)));
+
+  for (Idx = 0; Idx < ARRAY_SIZE (AcpiPcieTableInit); ++Idx) {
+    Status = (*AcpiPcieTableInit[Idx].Init) (&AcpiTable);
+    if (!EFI_ERROR (Status)) {
+      AcpiInstallTable (&AcpiPcieTableInit[Idx], AcpiTable);
+    }
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+AcpiPcieEnumerationComplete (
+  IN  EFI_EVENT   Event,
+  IN  VOID       *Context
+  )
+{
+  VOID        *Interface;
+  EFI_STATUS   Status;
+
+  Status = gBS->LocateProtocol (&gEfiPciEnumerationCompleteProtocolGuid, NULL, &Interface);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+  AcpiInstallPcieTables ();
+}
+
+STATIC
+VOID
+EFIAPI
+AcpiPcieReadyToBoot (
+  IN  EFI_EVENT   Event,
+  IN  VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+
+  //
+  // Nothing has enumerated PCI, e.g. no PCI driver is dispatched on this
+  // boot path: describe the links that PciHostBridgeLib has trained
+  //
+  if (!mPcieTablesInstalled) {
+    DEBUG ((DEBUG_WARN, "WARN: No PCI enumeration, installing PCIe tables at ReadyToBoot\n"));
+    AcpiInstallPcieTables ();
+  }
+}
+
 EFI_STATUS
 EFIAPI
 AcpiPlatformDxeInitialize (
@@ -87,15 +269,16 @@ AcpiPlatformDxeInitialize (
   )
 {
   EFI_ACPI_DESCRIPTION_HEADER  *AcpiTable;
-  EFI_ACPI_TABLE_PROTOCOL      *AcpiTableProtocol;
+  EFI_EVENT                     Event;
   UINTN                         Idx;
+  UINT64                        Start;
   EFI_STATUS                    Status;
-  UINTN                         TableHandle;
+  UINT64                        TotalStart;
 
   Status = gBS->LocateProtocol (
                   &gEfiAcpiTableProtocolGuid,
                   NULL,
-                  (VOID **) &AcpiTableProtocol
+                  (VOID **) &mAcpiTableProtocol
                   );
 
   if (EFI_ERROR (Status)) {
@@ -107,40 +290,46 @@ AcpiPlatformDxeInitialize (
     return Status;
   }
 
+  TotalStart = GetPerformanceCounter ();
+
   for (Idx = 0; Idx < ARRAY_SIZE (AcpiTableInit); ++Idx) {
+    Start  = GetPerformanceCounter ();
     Status = (*AcpiTableInit[Idx].Init) (&AcpiTable);
     if (EFI_ERROR (Status)) {
       continue;
     }
 
-    Status = AcpiTableProtocol->InstallAcpiTable (
-                                  AcpiTableProtocol,
-                                  AcpiTable,
-                                  AcpiTable->Length,
-                                  &TableHandle
-                                  );
-
-    if (AcpiTableInit[Idx].Destroy) {
-      (*AcpiTableInit[Idx].Destroy) (AcpiTable);
-    }
-
-    if (EFI_ERROR (Status)) {
-      DEBUG ((
-        DEBUG_ERROR,
-        "ERROR: Failed to Install %s ACPI Table. Status = %r\n",
-        AcpiTableInit[Idx].Name,
-        Status
-        ));
-        continue;
-    }
-
     DEBUG ((
       DEBUG_INFO,
-      "INFO: %s ACPI Table installed. Status = %r\n",
+      "INFO: %s ACPI Table built, %u bytes in %lu us\n",
       AcpiTableInit[Idx].Name,
-      Status
+      AcpiTable->Length,
+      AcpiElapsedUs (Start)
       ));
+
+    AcpiInstallTable (&AcpiTableInit[Idx], AcpiTable);
   }
 
+  DEBUG ((DEBUG_INFO, "INFO: ACPI tables done in %lu us\n", AcpiElapsedUs (TotalStart)));
+
+  Event = EfiCreateProtocolNotifyEvent (
+            &gEfiPciEnumerationCompleteProtocolGuid,
+            TPL_CALLBACK,
+            AcpiPcieEnumerationComplete,
+            NULL,
+            &mPcieRegistration
+            );
+  if (Event == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             AcpiPcieReadyToBoot,
+             NULL,
+             &Event
+             );
+  ASSERT_EFI_ERROR (Status);
+
   return EFI_SUCCESS;
 }
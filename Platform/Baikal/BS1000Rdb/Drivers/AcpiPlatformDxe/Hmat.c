@@ -0,0 +1,197 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <IndustryStandard/Acpi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/SpdClient.h>
+#include "AcpiPlatform.h"
+
+#include <BS1000.h>
+
+#if PLATFORM_CHIP_COUNT > 1
+
+#define HMAT_DDR_CHANNEL_COUNT      6
+// Slots N and N + 6 are the two DIMMs of channel N (see SpdClientDxe)
+#define HMAT_DDR_CHANNEL(DimmIdx)   ((DimmIdx) % HMAT_DDR_CHANNEL_COUNT)
+#define HMAT_LATENCY_BASE_UNIT      1000  // ps, entries are in ns
+#define HMAT_BANDWIDTH_BASE_UNIT    100   // MB/s
+
+#define HMAT_DATA_ACCESS_LATENCY    0
+#define HMAT_DATA_ACCESS_BANDWIDTH  3
+
+#define SPD_DRAM_TYPE_DDR4          0x0C
+#define SPD_DDR4_MTB_PS             125
+
+#pragma pack(1)
+typedef struct {
+  EFI_ACPI_6_4_HMAT_STRUCTURE_SYSTEM_LOCALITY_LATENCY_AND_BANDWIDTH_INFO  Header;
+  UINT32                                                                  InitiatorDomains[PLATFORM_CHIP_COUNT];
+  UINT32                                                                  TargetDomains[PLATFORM_CHIP_COUNT];
+  UINT16                                                                  Entries[PLATFORM_CHIP_COUNT * PLATFORM_CHIP_COUNT];
+} BAIKAL_ACPI_HMAT_LOCALITY;
+
+typedef struct {
+  EFI_ACPI_6_4_HETEROGENEOUS_MEMORY_ATTRIBUTE_TABLE_HEADER        Header;
+  EFI_ACPI_6_4_HMAT_STRUCTURE_MEMORY_PROXIMITY_DOMAIN_ATTRIBUTES  Domains[PLATFORM_CHIP_COUNT];
+  BAIKAL_ACPI_HMAT_LOCALITY                                       Latency;
+  BAIKAL_ACPI_HMAT_LOCALITY                                       Bandwidth;
+} BAIKAL_ACPI_HMAT;
+#pragma pack()
+
+STATIC BAIKAL_ACPI_HMAT  Hmat = {
+  {
+    BAIKAL_ACPI_HEADER (
+      EFI_ACPI_6_4_HETEROGENEOUS_MEMORY_ATTRIBUTE_TABLE_SIGNATURE,
+      BAIKAL_ACPI_HMAT,
+      EFI_ACPI_6_4_HETEROGENEOUS_MEMORY_ATTRIBUTE_TABLE_REVISION,
+      0x54414D48
+      ),
+    /* UINT8                          Reserved[4] */
+    { EFI_ACPI_RESERVED_BYTE, EFI_ACPI_RESERVED_BYTE, EFI_ACPI_RESERVED_BYTE, EFI_ACPI_RESERVED_BYTE }
+  },
+};
+
+//
+// Peak DRAM bandwidth of a chip in MB/s derived from the SPD of its DIMMs:
+// the slowest DIMM sets the transfer rate of all channels
+//
+STATIC
+UINT32
+HmatGetDramBandwidth (
+  IN  SPD_CLIENT_PROTOCOL  *SpdClient,
+  IN  UINTN                 ChipIdx
+  )
+{
+  CONST UINT8  *Spd;
+  UINT32       Channels = 0;
+  UINTN        DimmIdx;
+  UINT32       TckPs;
+  UINT32       MaxTckPs = 0;
+
+  for (DimmIdx = 0; DimmIdx < BS1000_DIMM_COUNT; ++DimmIdx) {
+    Spd = SpdClient->GetData (ChipIdx, DimmIdx);
+    if (Spd == NULL || Spd[2] != SPD_DRAM_TYPE_DDR4) {
+      continue;
+    }
+
+    //
+    // tCKAVGmin in medium timebase units plus a signed fine correction in ps
+    //
+    TckPs = Spd[18] * SPD_DDR4_MTB_PS + (INT8)Spd[125];
+    if (TckPs == 0) {
+      continue;
+    }
+
+    MaxTckPs = MAX (MaxTckPs, TckPs);
+    Channels |= 1U << HMAT_DDR_CHANNEL (DimmIdx);
+  }
+
+  if (Channels == 0) {
+    return 0;
+  }
+
+  //
+  // Two transfers per clock, 8 bytes per transfer on each populated channel.
+  // A second DIMM on a channel adds capacity, not bandwidth.
+  //
+  return (UINT32)(2000000ULL * 8 / MaxTckPs) * BitFieldCountOnes32 (Channels, 0, HMAT_DDR_CHANNEL_COUNT - 1);
+}
+
+EFI_STATUS
+HmatInit (
+  EFI_ACPI_DESCRIPTION_HEADER  **Table
+  )
+{
+  UINTN                Initiator;
+  UINTN                Target;
+  UINT32               Bandwidth[PLATFORM_CHIP_COUNT];
+  UINT32               Value;
+  SPD_CLIENT_PROTOCOL  *SpdClient;
+  EFI_STATUS           Status;
+
+  Status = gBS->LocateProtocol (&gSpdClientProtocolGuid, NULL, (VOID **) &SpdClient);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_WARN, "%a: no SPD, using PcdHmatLocalBandwidth. Status = %r\n", __func__, Status));
+    SpdClient = NULL;
+  }
+
+  for (Target = 0; Target < PLATFORM_CHIP_COUNT; ++Target) {
+    Bandwidth[Target] = FixedPcdGet32 (PcdHmatLocalBandwidth);
+    if (Bandwidth[Target] == 0 && SpdClient != NULL) {
+      Bandwidth[Target] = HmatGetDramBandwidth (SpdClient, Target);
+    }
+
+    DEBUG ((EFI_D_INFO, "%a: chip %u DRAM bandwidth %u MB/s\n", __func__, Target, Bandwidth[Target]));
+
+    Hmat.Domains[Target].Type   = EFI_ACPI_6_4_HMAT_TYPE_MEMORY_PROXIMITY_DOMAIN_ATTRIBUTES;
+    Hmat.Domains[Target].Length = sizeof (Hmat.Domains[Target]);
+    Hmat.Domains[Target].Flags.InitiatorProximityDomainValid = 1;
+    Hmat.Domains[Target].InitiatorProximityDomain = Target;
+    Hmat.Domains[Target].MemoryProximityDomain    = Target;
+
+    Hmat.Latency.InitiatorDomains[Target]   = Target;
+    Hmat.Latency.TargetDomains[Target]      = Target;
+    Hmat.Bandwidth.InitiatorDomains[Target] = Target;
+    Hmat.Bandwidth.TargetDomains[Target]    = Target;
+  }
+
+  Hmat.Latency.Header.Type   = EFI_ACPI_6_4_HMAT_TYPE_SYSTEM_LOCALITY_LATENCY_AND_BANDWIDTH_INFO;
+  Hmat.Latency.Header.Length = sizeof (Hmat.Latency);
+  Hmat.Latency.Header.Flags.MemoryHierarchy = 0;
+  Hmat.Latency.Header.DataType      = HMAT_DATA_ACCESS_LATENCY;
+  Hmat.Latency.Header.EntryBaseUnit = HMAT_LATENCY_BASE_UNIT;
+  Hmat.Latency.Header.NumberOfInitiatorProximityDomains = PLATFORM_CHIP_COUNT;
+  Hmat.Latency.Header.NumberOfTargetProximityDomains    = PLATFORM_CHIP_COUNT;
+
+  CopyMem (&Hmat.Bandwidth.Header, &Hmat.Latency.Header, sizeof (Hmat.Bandwidth.Header));
+  Hmat.Bandwidth.Header.DataType      = HMAT_DATA_ACCESS_BANDWIDTH;
+  Hmat.Bandwidth.Header.EntryBaseUnit = HMAT_BANDWIDTH_BASE_UNIT;
+
+  //
+  // An entry of 0xFFFF means that there is no path, so the latencies are
+  // capped below it like the bandwidths
+  //
+  for (Initiator = 0; Initiator < PLATFORM_CHIP_COUNT; ++Initiator) {
+    for (Target = 0; Target < PLATFORM_CHIP_COUNT; ++Target) {
+      if (Initiator == Target) {
+        Hmat.Latency.Entries[Initiator * PLATFORM_CHIP_COUNT + Target] =
+          (UINT16)MIN (FixedPcdGet32 (PcdHmatLocalLatency), MAX_UINT16 - 1);
+        Value = Bandwidth[Target];
+      } else {
+        //
+        // Remote accesses are limited by the inter-chip link as well
+        //
+        Hmat.Latency.Entries[Initiator * PLATFORM_CHIP_COUNT + Target] =
+          (UINT16)MIN (FixedPcdGet32 (PcdHmatRemoteLatency), MAX_UINT16 - 1);
+        Value = MIN (Bandwidth[Target], FixedPcdGet32 (PcdHmatRemoteBandwidth));
+      }
+
+      //
+      // 0 means that the bandwidth is not known
+      //
+      Hmat.Bandwidth.Entries[Initiator * PLATFORM_CHIP_COUNT + Target] =
+        (UINT16)MIN (Value / HMAT_BANDWIDTH_BASE_UNIT, MAX_UINT16 - 1);
+    }
+  }
+
+  *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Hmat;
+  return EFI_SUCCESS;
+}
+
+#else
+
+EFI_STATUS
+HmatInit (
+  EFI_ACPI_DESCRIPTION_HEADER  **Table
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+#endif
@@ -0,0 +1,156 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <IndustryStandard/Acpi.h>
+#include <Library/AmlPatchLib.h>
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Protocol/FdtClient.h>
+#include "AcpiPlatform.h"
+
+#define LPI_STATE_DISABLED  0
+#define LPI_STATE_ENABLED   1
+
+// Arch Context Lost Flags, 0 for a retention state
+#define LPI_CONTEXT_CORE_LOST  BIT0
+
+// StateType of a PSCI power_state, set for a powerdown state
+#define LPI_PSCI_STATE_TYPE_POWERDOWN  BIT16
+
+typedef struct {
+  UINT32  Residency;
+  UINT32  Latency;
+  UINT32  Flags;
+  UINT32  Context;
+  UINT32  Param;
+} LPI_STATE;
+
+STATIC CONST LPI_STATE  mLpiPlaceholders[BAIKAL_ACPI_LPI_STATE_COUNT] = {
+  {
+    BAIKAL_ACPI_LPI1_RESIDENCY,
+    BAIKAL_ACPI_LPI1_LATENCY,
+    BAIKAL_ACPI_LPI1_FLAGS,
+    BAIKAL_ACPI_LPI1_CONTEXT,
+    BAIKAL_ACPI_LPI1_PARAM
+  },
+  {
+    BAIKAL_ACPI_LPI2_RESIDENCY,
+    BAIKAL_ACPI_LPI2_LATENCY,
+    BAIKAL_ACPI_LPI2_FLAGS,
+    BAIKAL_ACPI_LPI2_CONTEXT,
+    BAIKAL_ACPI_LPI2_PARAM
+  }
+};
+
+STATIC
+UINT32
+LpiGetProperty32 (
+  IN  FDT_CLIENT_PROTOCOL  *FdtClient,
+  IN  INT32                 Node,
+  IN  CONST CHAR8          *Name,
+  IN  UINT32                Default
+  )
+{
+  CONST VOID  *Prop;
+  UINT32       PropSize;
+  EFI_STATUS   Status;
+
+  Status = FdtClient->GetNodeProperty (FdtClient, Node, Name, &Prop, &PropSize);
+  if (EFI_ERROR (Status) || PropSize != sizeof (UINT32)) {
+    return Default;
+  }
+
+  return SwapBytes32 (ReadUnaligned32 (Prop));
+}
+
+/**
+  Fill in the deeper core idle states of the DSDT from the arm,idle-state
+  nodes of the device tree: the PSCI suspend parameter becomes the FFixedHW
+  entry method and its StateType tells whether the core context is lost,
+  the entry and exit latencies add up to the wakeup latency.
+  States the device tree does not describe are left disabled, so without
+  idle-states the OS only gets WFI.
+**/
+VOID
+LpiInit (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Dsdt
+  )
+{
+  UINTN                 Count;
+  FDT_CLIENT_PROTOCOL  *FdtClient;
+  UINTN                 Idx;
+  INT32                 Node;
+  LPI_STATE             States[BAIKAL_ACPI_LPI_STATE_COUNT];
+  LPI_STATE             Tmp;
+  EFI_STATUS            Status;
+
+  Count = 0;
+
+  Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
+  if (!EFI_ERROR (Status)) {
+    for (Status = FdtClient->FindCompatibleNode (FdtClient, "arm,idle-state", &Node);
+         !EFI_ERROR (Status) && Count < BAIKAL_ACPI_LPI_STATE_COUNT;
+         Status = FdtClient->FindNextCompatibleNode (FdtClient, "arm,idle-state", Node, &Node)) {
+      if (!FdtClient->IsNodeEnabled (FdtClient, Node)) {
+        continue;
+      }
+
+      States[Count].Param = LpiGetProperty32 (FdtClient, Node, "arm,psci-suspend-param", 0);
+      if (States[Count].Param == 0) {
+        continue;
+      }
+
+      States[Count].Latency   = LpiGetProperty32 (FdtClient, Node, "entry-latency-us", 0) +
+                                LpiGetProperty32 (FdtClient, Node, "exit-latency-us", 0);
+      States[Count].Residency = LpiGetProperty32 (FdtClient, Node, "min-residency-us", States[Count].Latency);
+      States[Count].Flags     = LPI_STATE_ENABLED;
+      States[Count].Context   = (States[Count].Param & LPI_PSCI_STATE_TYPE_POWERDOWN) != 0 ?
+                                LPI_CONTEXT_CORE_LOST : 0;
+      ++Count;
+    }
+  }
+
+  // _LPI lists the states from the shallowest to the deepest one
+  for (Idx = 1; Idx < Count; ++Idx) {
+    if (States[Idx].Latency < States[Idx - 1].Latency) {
+      Tmp = States[Idx];
+      States[Idx] = States[Idx - 1];
+      States[Idx - 1] = Tmp;
+      Idx = 0;
+    }
+  }
+
+  for (Idx = 0; Idx < BAIKAL_ACPI_LPI_STATE_COUNT; ++Idx) {
+    if (Idx < Count) {
+      DEBUG ((
+        EFI_D_INFO,
+        "%a: state %u: PSCI 0x%08x (%a), latency %u us, residency %u us\n",
+        __func__,
+        Idx + 1,
+        States[Idx].Param,
+        States[Idx].Context != 0 ? "powerdown" : "retention",
+        States[Idx].Latency,
+        States[Idx].Residency
+        ));
+    } else {
+      States[Idx].Residency = 0;
+      States[Idx].Latency   = 0;
+      States[Idx].Flags     = LPI_STATE_DISABLED;
+      States[Idx].Context   = 0;
+      States[Idx].Param     = 0;
+    }
+
+    //
+    // The placeholders are unique DWORDs, either integer constants of the
+    // package or the addresses of the FFixedHW entry method registers
+    //
+    AmlPatchPlaceholder32 (Dsdt, mLpiPlaceholders[Idx].Residency, States[Idx].Residency);
+    AmlPatchPlaceholder32 (Dsdt, mLpiPlaceholders[Idx].Latency, States[Idx].Latency);
+    AmlPatchPlaceholder32 (Dsdt, mLpiPlaceholders[Idx].Flags, States[Idx].Flags);
+    AmlPatchPlaceholder32 (Dsdt, mLpiPlaceholders[Idx].Context, States[Idx].Context);
+    AmlPatchPlaceholder32 (Dsdt, mLpiPlaceholders[Idx].Param, States[Idx].Param);
+  }
+}
@@ -82,20 +82,32 @@ McfgInit (
   UINTN  ChipIdx;
   UINTN  Idx;
   UINTN  Num;
+  UINT16 Segment;
   UINT32 PcieCfg0Quirk = PcdGet32 (PcdPcieCfg0Quirk);
+  UINT32 PcieLinkMask = PcdGet32 (PcdPcieLinkMask);
 
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < BAIKAL_ACPI_PCIE_COUNT; ++Idx, ++Num) {
+    for (Idx = 0; Idx < BAIKAL_ACPI_PCIE_COUNT; ++Idx) {
+      Segment = ChipIdx * BAIKAL_ACPI_PCIE_COUNT + PcieCfg[Idx].Segment;
+      //
+      // Leave out the segments whose root bridges SsdtPcie hides
+      //
+      if (!(PcieLinkMask & (1 << Segment))) {
+        continue;
+      }
+
       CopyMem (&Mcfg.Table[Num], &BaseAddrStructTemplate, sizeof (BaseAddrStructTemplate));
       Mcfg.Table[Num].BaseAddress = PLATFORM_ADDR_OUT_CHIP (ChipIdx, PcieCfg[Idx].BaseAddr);
-      Mcfg.Table[Num].PciSegmentGroupNumber = ChipIdx * BAIKAL_ACPI_PCIE_COUNT +
-                                              PcieCfg[Idx].Segment;
-      if (PcieCfg0Quirk & (1 << Mcfg.Table[Num].PciSegmentGroupNumber)) {
+      Mcfg.Table[Num].PciSegmentGroupNumber = Segment;
+      if (PcieCfg0Quirk & (1 << Segment)) {
         Mcfg.Table[Num].BaseAddress += 0x8000;
       }
+
+      ++Num;
     }
   }
 
+  Mcfg.Header.Header.Length = sizeof (Mcfg.Header) + Num * sizeof (Mcfg.Table[0]);
   Mcfg.Header.Header.OemRevision = 2;
 
   *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Mcfg;
@@ -5,6 +5,7 @@
 
 #include <IndustryStandard/Acpi.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/CacheInfoLib.h>
 #include "AcpiPlatform.h"
 
 #include <BS1000.h>
@@ -24,17 +25,6 @@
   (IdenticalImplementation << 4)     \
 )
 
-#define BAIKAL_PPTT_CACHE_ATTRIBUTES( \
-  AllocationType,                     \
-  CacheType,                          \
-  WritePolicy                         \
-  )                                   \
-(                                     \
-  AllocationType |                    \
-  (CacheType << 2) |                  \
-  (WritePolicy << 4)                  \
-)
-
 STATIC EFI_ACPI_6_4_PPTT_STRUCTURE_PROCESSOR  ProcessorTemplate = {
   /* UINT8                                        Type                     */
   EFI_ACPI_6_4_PPTT_TYPE_PROCESSOR,
@@ -52,40 +42,6 @@ STATIC EFI_ACPI_6_4_PPTT_STRUCTURE_PROCESSOR  ProcessorTemplate = {
   0
 };
 
-STATIC EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  CacheTemplate = {
-  /* UINT8                                         Type             */
-  EFI_ACPI_6_4_PPTT_TYPE_CACHE,
-  /* UINT8                                         Length           */
-  sizeof (EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE),
-  /* UINT8                                         Reserved[2]      */
-  { EFI_ACPI_RESERVED_BYTE, EFI_ACPI_RESERVED_BYTE },
-  /* EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE_FLAGS       Flags            */
-  {
-    EFI_ACPI_6_4_PPTT_CACHE_SIZE_VALID,
-    EFI_ACPI_6_4_PPTT_NUMBER_OF_SETS_VALID,
-    EFI_ACPI_6_4_PPTT_ASSOCIATIVITY_VALID,
-    EFI_ACPI_6_4_PPTT_ALLOCATION_TYPE_VALID,
-    EFI_ACPI_6_4_PPTT_CACHE_TYPE_VALID,
-    EFI_ACPI_6_4_PPTT_WRITE_POLICY_VALID,
-    EFI_ACPI_6_4_PPTT_LINE_SIZE_VALID,
-    EFI_ACPI_6_4_PPTT_CACHE_ID_VALID
-  },
-  /* UINT32                                        NextLevelOfCache */
-  0,
-  /* UINT32                                        Size             */
-  0,
-  /* UINT32                                        NumberOfSets     */
-  0,
-  /* UINT8                                         Associativity    */
-  0,
-  /* EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE_ATTRIBUTES  Attributes       */
-  {0},
-  /* UINT16                                        LineSize         */
-  64,
-  /* UINT32                                        CacheId          */
-  0
-};
-
 #pragma pack(1)
 
 typedef struct {
@@ -133,14 +89,15 @@ PpttInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
-  UINT8   CacheAttributes;
-  UINTN   ChipIdx;
-  UINTN   ClusterNum;
-  UINTN   Idx;
-  UINTN   Idx1;
-  UINTN   Num;
-  UINTN   CacheNum = 1;
-  UINT32  ProcNodeFlags;
+  CACHE_INFO  Caches[BS1000_CACHE_COUNT] = BS1000_CACHE_INFO;
+  UINTN       ChipIdx;
+  UINTN       ClusterNum;
+  UINTN       Idx;
+  UINTN       Idx1;
+  UINTN       Num;
+  UINT32      ProcNodeFlags;
+
+  CacheInfoProbe (Caches, ARRAY_SIZE (Caches));
 
   /* Sockets */
   ProcNodeFlags = BAIKAL_PPTT_PROC_NODE_FLAGS (
@@ -208,91 +165,48 @@ PpttInit (
   }
 
   /* L4 Caches */
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ_WRITE,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_UNIFIED,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
-    );
-  for (ChipIdx = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx, ++CacheNum) {
-    EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *NodePointer = &Pptt.CacheL4[ChipIdx];
-
-    CopyMem (NodePointer, &CacheTemplate, sizeof (CacheTemplate));
-    NodePointer->Size = 0x2000000;
-    NodePointer->Associativity = 16;
-    NodePointer->NumberOfSets = NodePointer->Size / (NodePointer->Associativity * 64);
-    CopyMem (&NodePointer->Attributes, &CacheAttributes, sizeof (CacheAttributes));
-    NodePointer->CacheId = CacheNum;
+  for (ChipIdx = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
+    CacheInfoToPpttCache (
+      &Pptt.CacheL4[ChipIdx],
+      &Caches[BS1000_CACHE_L4],
+      0,
+      CACHE_INFO_ID (ChipIdx, BS1000_CACHE_L4, 0)
+      );
   }
 
   /* L3 Caches */
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < BS1000_CLUSTER_COUNT; ++Idx, ++Num, ++CacheNum) {
-      EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *NodePointer = &Pptt.CacheL3[Num];
-
-      CopyMem (NodePointer, &CacheTemplate, sizeof (CacheTemplate));
-      NodePointer->Size = 0x200000;
-      NodePointer->Associativity = 16;
-      NodePointer->NumberOfSets = NodePointer->Size / (NodePointer->Associativity * 64);
-      CopyMem (&NodePointer->Attributes, &CacheAttributes, sizeof (CacheAttributes));
-      NodePointer->CacheId = CacheNum;
+    for (Idx = 0; Idx < BS1000_CLUSTER_COUNT; ++Idx, ++Num) {
+      CacheInfoToPpttCache (
+        &Pptt.CacheL3[Num],
+        &Caches[BS1000_CACHE_L3],
+        0,
+        CACHE_INFO_ID (ChipIdx, BS1000_CACHE_L3, Idx)
+        );
     }
   }
 
-  /* L2 Caches */
+  /* L2, L1D and L1I Caches */
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < BS1000_CORE_COUNT; ++Idx, ++Num, ++CacheNum) {
-      EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *NodePointer = &Pptt.CacheL2[Num];
-
-      CopyMem (NodePointer, &CacheTemplate, sizeof (CacheTemplate));
-      NodePointer->Size = 0x80000;
-      NodePointer->Associativity = 8;
-      NodePointer->NumberOfSets = NodePointer->Size / (NodePointer->Associativity * 64);
-      CopyMem (&NodePointer->Attributes, &CacheAttributes, sizeof (CacheAttributes));
-      NodePointer->CacheId = CacheNum;
-    }
-  }
-
-  /* L1D Caches */
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ_WRITE,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_DATA,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
-    );
-  for (ChipIdx = 0, Num = 0, ClusterNum = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < BS1000_CLUSTER_COUNT; ++Idx, ++ClusterNum) {
-      for (Idx1 = 0; Idx1 < BS1000_CORE_COUNT_PER_CLUSTER; ++Idx1, ++Num, ++CacheNum) {
-        EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *NodePointer = &Pptt.CacheL1D[Num];
-
-        CopyMem (NodePointer, &CacheTemplate, sizeof (CacheTemplate));
-        NodePointer->NextLevelOfCache = OFFSET_OF (BAIKAL_ACPI_PPTT, CacheL2[ClusterNum]);
-        NodePointer->Size = 0x10000;
-        NodePointer->Associativity = 16;
-        NodePointer->NumberOfSets = NodePointer->Size / (NodePointer->Associativity * 64);
-        CopyMem (&NodePointer->Attributes, &CacheAttributes, sizeof (CacheAttributes));
-        NodePointer->CacheId = CacheNum;
-      }
-    }
-  }
-
-  /* L1I Caches */
-  CacheAttributes = BAIKAL_PPTT_CACHE_ATTRIBUTES (
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_INSTRUCTION,
-    EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK
-    );
-  for (ChipIdx = 0, Num = 0, ClusterNum = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < BS1000_CLUSTER_COUNT; ++Idx, ++ClusterNum) {
-      for (Idx1 = 0; Idx1 < BS1000_CORE_COUNT_PER_CLUSTER; ++Idx1, ++Num, ++CacheNum) {
-        EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *NodePointer = &Pptt.CacheL1I[Num];
-
-        CopyMem (NodePointer, &CacheTemplate, sizeof (CacheTemplate));
-        NodePointer->NextLevelOfCache = OFFSET_OF (BAIKAL_ACPI_PPTT, CacheL2[ClusterNum]);
-        NodePointer->Size = 0x10000;
-        NodePointer->Associativity = 4;
-        NodePointer->NumberOfSets = NodePointer->Size / (NodePointer->Associativity * 64);
-        CopyMem (&NodePointer->Attributes, &CacheAttributes, sizeof (CacheAttributes));
-        NodePointer->CacheId = CacheNum;
-      }
+    for (Idx = 0; Idx < BS1000_CORE_COUNT; ++Idx, ++Num) {
+      CacheInfoToPpttCache (
+        &Pptt.CacheL2[Num],
+        &Caches[BS1000_CACHE_L2],
+        0,
+        CACHE_INFO_ID (ChipIdx, BS1000_CACHE_L2, Idx)
+        );
+      CacheInfoToPpttCache (
+        &Pptt.CacheL1D[Num],
+        &Caches[BS1000_CACHE_L1D],
+        OFFSET_OF (BAIKAL_ACPI_PPTT, CacheL2[Num]),
+        CACHE_INFO_ID (ChipIdx, BS1000_CACHE_L1D, Idx)
+        );
+      CacheInfoToPpttCache (
+        &Pptt.CacheL1I[Num],
+        &Caches[BS1000_CACHE_L1I],
+        OFFSET_OF (BAIKAL_ACPI_PPTT, CacheL2[Num]),
+        CACHE_INFO_ID (ChipIdx, BS1000_CACHE_L1I, Idx)
+        );
     }
   }
 
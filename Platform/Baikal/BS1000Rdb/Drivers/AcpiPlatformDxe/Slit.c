@@ -4,19 +4,23 @@
 **/
 
 #include <IndustryStandard/Acpi.h>
+#include <Platform/ConfigVars.h>
 #include "AcpiPlatform.h"
 
 #include <BS1000.h>
 
-#if PLATFORM_CHIP_COUNT > 1
-
-#define SELF_CHIP_DISTANCE    10
 #define REMOTE_CHIP_DISTANCE  20
 
+// Each chip is reported as up to ACPI_SNC_3 sub-NUMA domains
+#define SLIT_MAX_DOMAINS      (PLATFORM_CHIP_COUNT * ACPI_SNC_3)
+
+extern UINT32 SncGetDomainCount (VOID);
+extern UINT8 SncGetDistance (UINT32 From, UINT32 To);
+
 #pragma pack(1)
 typedef struct {
   EFI_ACPI_6_4_SYSTEM_LOCALITY_DISTANCE_INFORMATION_TABLE_HEADER  Header;
-  UINT8                                                           Matrix[PLATFORM_CHIP_COUNT * PLATFORM_CHIP_COUNT];
+  UINT8                                                           Matrix[SLIT_MAX_DOMAINS * SLIT_MAX_DOMAINS];
 } BAIKAL_ACPI_SLIT;
 #pragma pack()
 
@@ -38,28 +42,31 @@ SlitInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
-  UINTN  Idx1;
-  UINTN  Idx2;
-  UINTN  Num;
+  UINTN   Count;
+  UINTN   Idx1;
+  UINTN   Idx2;
+  UINTN   Num;
+  UINT32  SncCount;
+
+  SncCount = SncGetDomainCount ();
+  Count = PLATFORM_CHIP_COUNT * SncCount;
+  if (Count == 1) {
+    return EFI_UNSUPPORTED;
+  }
 
-  for (Idx1 = 0, Num = 0; Idx1 < PLATFORM_CHIP_COUNT; ++Idx1) {
-    for (Idx2 = 0; Idx2 < PLATFORM_CHIP_COUNT; ++Idx2, ++Num) {
-      Slit.Matrix[Num] = (Idx1 == Idx2) ? SELF_CHIP_DISTANCE : REMOTE_CHIP_DISTANCE;
+  for (Idx1 = 0, Num = 0; Idx1 < Count; ++Idx1) {
+    for (Idx2 = 0; Idx2 < Count; ++Idx2, ++Num) {
+      if (Idx1 / SncCount == Idx2 / SncCount) {
+        Slit.Matrix[Num] = SncGetDistance (Idx1 % SncCount, Idx2 % SncCount);
+      } else {
+        Slit.Matrix[Num] = REMOTE_CHIP_DISTANCE;
+      }
     }
   }
 
+  Slit.Header.NumberOfSystemLocalities = Count;
+  Slit.Header.Header.Length = OFFSET_OF (BAIKAL_ACPI_SLIT, Matrix) + Count * Count;
+
   *Table = (EFI_ACPI_DESCRIPTION_HEADER *) &Slit;
   return EFI_SUCCESS;
 }
-
-#else
-
-EFI_STATUS
-SlitInit (
-  EFI_ACPI_DESCRIPTION_HEADER  **Table
-  )
-{
-  return EFI_UNSUPPORTED;
-}
-
-#endif
@@ -0,0 +1,325 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Library/BaseLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Platform/ConfigVars.h>
+#include <Protocol/FdtClient.h>
+
+#include <BS1000.h>
+
+#define SNC_LOCAL_DISTANCE  10
+
+#define SNC_CPU_COMPATIBLE  "arm,cortex-a75"
+#define SNC_ITS_COMPATIBLE  "arm,gic-v3-its"
+#define SNC_ITS_BASE        0x01040000
+#define SNC_ITS_STRIDE      0x20000
+
+#define MPIDR_CLUSTER(Mpidr)  (((Mpidr) >> 16) & 0xFF)
+
+//
+// Sub-NUMA clustering splits a chip into groups of neighbouring clusters,
+// each with the memory controllers closest to it. The interleaving of the
+// DDR channels is set up before UEFI runs, so the only thing the firmware
+// here can do is to describe the result: the memory, cpu and ITS nodes of
+// the device tree carry the numa-node-id of their domain. A cluster or an
+// ITS without one is assigned to the domains in order. If the memory nodes
+// do not describe the split the chip is reported as a single domain.
+//
+
+STATIC UINT32  mSncDomainCount;
+STATIC UINT8   mSncClusterDomain[BS1000_CLUSTER_COUNT];
+STATIC UINT8   mSncItsDomain[BS1000_GIC_ITS_COUNT];
+
+#if PLATFORM_CHIP_COUNT == 1
+STATIC
+BOOLEAN
+SncMemoryIsSplit (
+  IN  UINT32  DomainCount
+  )
+{
+  UINT32                Domain;
+  UINT32                DomainMask;
+  FDT_CLIENT_PROTOCOL  *FdtClient;
+  INT32                 Node;
+  CONST VOID           *Prop;
+  UINT32                PropSize;
+  CONST VOID           *Reg;
+  UINTN                 AddressCells;
+  UINTN                 SizeCells;
+  UINT32                RegSize;
+  EFI_STATUS            Status;
+
+  Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  DomainMask = 0;
+  for (Status = FdtClient->FindMemoryNodeReg (FdtClient, &Node, &Reg, &AddressCells, &SizeCells, &RegSize);
+       !EFI_ERROR (Status);
+       Status = FdtClient->FindNextMemoryNodeReg (FdtClient, Node, &Node, &Reg, &AddressCells, &SizeCells, &RegSize)) {
+    Status = FdtClient->GetNodeProperty (FdtClient, Node, "numa-node-id", &Prop, &PropSize);
+    if (EFI_ERROR (Status) || PropSize != sizeof (UINT32)) {
+      DEBUG ((EFI_D_WARN, "%a: memory node without numa-node-id\n", __func__));
+      return FALSE;
+    }
+
+    Domain = SwapBytes32 (ReadUnaligned32 (Prop));
+    if (Domain >= DomainCount) {
+      DEBUG ((EFI_D_WARN, "%a: numa-node-id %u out of range\n", __func__, Domain));
+      return FALSE;
+    }
+
+    DomainMask |= 1U << Domain;
+  }
+
+  // Every domain needs local memory, the OS does not expect memoryless SNC nodes
+  return DomainMask == (1U << DomainCount) - 1;
+}
+
+typedef
+UINTN
+(*SNC_LOCATE_FUNCTION) (
+  UINT64
+  );
+
+//
+// numa-node-id of every node with the given compatible, stored in Domains
+// at the index Locate derives from the node's first reg address
+//
+STATIC
+VOID
+SncLoadDomains (
+  IN      FDT_CLIENT_PROTOCOL  *FdtClient,
+  IN      CONST CHAR8          *Compatible,
+  IN      UINT32                DomainCount,
+  IN      SNC_LOCATE_FUNCTION   Locate,
+  IN OUT  UINT8                *Domains,
+  IN      UINTN                 Count
+  )
+{
+  UINT32                 Domain;
+  UINTN                  Idx;
+  INT32                  Node;
+  CONST VOID            *Prop;
+  UINT32                 PropSize;
+  CONST FDT_CLIENT_REG  *Reg;
+  UINT32                 RegCount;
+  BOOLEAN                Found[MAX (BS1000_CLUSTER_COUNT, BS1000_GIC_ITS_COUNT)];
+  EFI_STATUS             Status;
+
+  ASSERT (Count <= ARRAY_SIZE (Found));
+  for (Idx = 0; Idx < Count; ++Idx) {
+    Found[Idx] = FALSE;
+  }
+
+  for (Status = FdtClient->FindCompatibleNode (FdtClient, Compatible, &Node);
+       !EFI_ERROR (Status);
+       Status = FdtClient->FindNextCompatibleNode (FdtClient, Compatible, Node, &Node)) {
+    if (EFI_ERROR (FdtClient->GetNodeReg (FdtClient, Node, &Reg, &RegCount)) || RegCount == 0 ||
+        EFI_ERROR (FdtClient->GetNodeProperty (FdtClient, Node, "numa-node-id", &Prop, &PropSize)) ||
+        PropSize != sizeof (UINT32)) {
+      continue;
+    }
+
+    Idx    = Locate (Reg[0].Address);
+    Domain = SwapBytes32 (ReadUnaligned32 (Prop));
+    if (Idx < Count && Domain < DomainCount) {
+      Domains[Idx] = (UINT8) Domain;
+      Found[Idx]   = TRUE;
+    }
+  }
+
+  for (Idx = 0; Idx < Count; ++Idx) {
+    if (!Found[Idx]) {
+      DEBUG ((EFI_D_WARN, "%a: %a %u: no numa-node-id, using domain %u\n", __func__, Compatible, Idx, Domains[Idx]));
+    }
+  }
+}
+
+STATIC
+UINTN
+SncLocateCluster (
+  IN  UINT64  Mpidr
+  )
+{
+  return MPIDR_CLUSTER (Mpidr);
+}
+
+STATIC
+UINTN
+SncLocateIts (
+  IN  UINT64  Address
+  )
+{
+  return (Address - SNC_ITS_BASE) / SNC_ITS_STRIDE;
+}
+#endif
+
+/**
+  Number of proximity domains a chip is split into: 1 unless SNC has been
+  enabled in the setup and the memory map supports it.
+**/
+UINT32
+SncGetDomainCount (
+  VOID
+  )
+{
+#if PLATFORM_CHIP_COUNT == 1
+  FDT_CLIENT_PROTOCOL  *FdtClient;
+  UINTN                 Idx;
+  UINT32                Mode;
+#endif
+
+  if (mSncDomainCount != 0) {
+    return mSncDomainCount;
+  }
+
+  mSncDomainCount = 1;
+
+#if PLATFORM_CHIP_COUNT == 1
+  Mode = PcdGet32 (PcdAcpiSncMode);
+  if (Mode == ACPI_SNC_OFF) {
+    return mSncDomainCount;
+  }
+
+  if ((Mode != ACPI_SNC_2 && Mode != ACPI_SNC_3) || BS1000_CLUSTER_COUNT % Mode != 0) {
+    DEBUG ((EFI_D_ERROR, "%a: unsupported SNC mode %u\n", __func__, Mode));
+    return mSncDomainCount;
+  }
+
+  if (!SncMemoryIsSplit (Mode)) {
+    DEBUG ((EFI_D_WARN, "%a: memory map is not split for SNC-%u, using one domain\n", __func__, Mode));
+    return mSncDomainCount;
+  }
+
+  //
+  // Place the clusters and the ITSes like the device tree does, so that
+  // they end up in the domain of their local memory
+  //
+  for (Idx = 0; Idx < BS1000_CLUSTER_COUNT; ++Idx) {
+    mSncClusterDomain[Idx] = (UINT8) (Idx * Mode / BS1000_CLUSTER_COUNT);
+  }
+
+  for (Idx = 0; Idx < BS1000_GIC_ITS_COUNT; ++Idx) {
+    mSncItsDomain[Idx] = (UINT8) (Idx * Mode / BS1000_GIC_ITS_COUNT);
+  }
+
+  if (!EFI_ERROR (gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient))) {
+    SncLoadDomains (FdtClient, SNC_CPU_COMPATIBLE, Mode, SncLocateCluster, mSncClusterDomain, BS1000_CLUSTER_COUNT);
+    SncLoadDomains (FdtClient, SNC_ITS_COMPATIBLE, Mode, SncLocateIts, mSncItsDomain, BS1000_GIC_ITS_COUNT);
+  }
+
+  mSncDomainCount = Mode;
+  DEBUG ((EFI_D_INFO, "%a: SNC-%u\n", __func__, Mode));
+#endif
+
+  return mSncDomainCount;
+}
+
+UINT32
+SncGetClusterDomain (
+  IN  UINTN  Cluster
+  )
+{
+  if (SncGetDomainCount () == 1 || Cluster >= BS1000_CLUSTER_COUNT) {
+    return 0;
+  }
+
+  return mSncClusterDomain[Cluster];
+}
+
+UINT32
+SncGetItsDomain (
+  IN  UINTN  Its
+  )
+{
+  if (SncGetDomainCount () == 1 || Its >= BS1000_GIC_ITS_COUNT) {
+    return 0;
+  }
+
+  return mSncItsDomain[Its];
+}
+
+UINT32
+SncGetMemoryDomain (
+  IN  INT32  Node
+  )
+{
+  FDT_CLIENT_PROTOCOL  *FdtClient;
+  CONST VOID           *Prop;
+  UINT32                PropSize;
+  EFI_STATUS            Status;
+
+  if (SncGetDomainCount () == 1) {
+    return 0;
+  }
+
+  Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
+  if (!EFI_ERROR (Status)) {
+    Status = FdtClient->GetNodeProperty (FdtClient, Node, "numa-node-id", &Prop, &PropSize);
+  }
+
+  if (EFI_ERROR (Status) || PropSize != sizeof (UINT32)) {
+    return 0;
+  }
+
+  return SwapBytes32 (ReadUnaligned32 (Prop));
+}
+
+/**
+  SLIT distance between two SNC domains of a chip. A numa-distance-map-v1
+  node in the device tree takes precedence, otherwise the distance is the
+  ratio of the remote to the local access latency. Distances between
+  different domains are kept above SNC_LOCAL_DISTANCE, as SLIT requires.
+**/
+UINT8
+SncGetDistance (
+  IN  UINT32  From,
+  IN  UINT32  To
+  )
+{
+  FDT_CLIENT_PROTOCOL  *FdtClient;
+  UINTN                 Idx;
+  CONST UINT32         *Matrix;
+  UINT32                MatrixSize;
+  EFI_STATUS            Status;
+
+  if (From == To) {
+    return SNC_LOCAL_DISTANCE;
+  }
+
+  Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
+  if (!EFI_ERROR (Status)) {
+    Status = FdtClient->FindCompatibleNodeProperty (
+                          FdtClient,
+                          "numa-distance-map-v1",
+                          "distance-matrix",
+                          (CONST VOID **) &Matrix,
+                          &MatrixSize
+                          );
+  }
+
+  if (!EFI_ERROR (Status)) {
+    for (Idx = 0; Idx + 3 <= MatrixSize / sizeof (UINT32); Idx += 3) {
+      if ((SwapBytes32 (Matrix[Idx]) == From && SwapBytes32 (Matrix[Idx + 1]) == To) ||
+          (SwapBytes32 (Matrix[Idx]) == To && SwapBytes32 (Matrix[Idx + 1]) == From)) {
+        return (UINT8) MAX (MIN (SwapBytes32 (Matrix[Idx + 2]), MAX_UINT8 - 1), SNC_LOCAL_DISTANCE + 1);
+      }
+    }
+  }
+
+  return (UINT8) MAX (
+                   MIN (
+                     (SNC_LOCAL_DISTANCE * FixedPcdGet32 (PcdSncRemoteLatency) +
+                      FixedPcdGet32 (PcdHmatLocalLatency) / 2) / FixedPcdGet32 (PcdHmatLocalLatency),
+                     MAX_UINT8 - 1
+                     ),
+                   SNC_LOCAL_DISTANCE + 1
+                   );
+}
@@ -16,7 +16,10 @@
 
 #include <BS1000.h>
 
-#if PLATFORM_CHIP_COUNT > 1
+extern UINT32 SncGetDomainCount (VOID);
+extern UINT32 SncGetClusterDomain (UINTN Cluster);
+extern UINT32 SncGetItsDomain (UINTN Its);
+extern UINT32 SncGetMemoryDomain (INT32 Node);
 
 STATIC EFI_ACPI_6_4_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER SratHeaderTemplate = {
   BAIKAL_ACPI_HEADER (
@@ -31,80 +34,36 @@ STATIC EFI_ACPI_6_4_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER SratHeaderTemplate = {
   0
 };
 
-typedef struct {
-  UINT64  Addr;
-  UINT64  Size;
-} MEMORY_REGION_DESCRIPTION;
-
 STATIC
-EFI_STATUS
-GetMemoryRegions (
-  OUT MEMORY_REGION_DESCRIPTION ** CONST  Regions,
-  OUT UINTN * CONST                       Count
+UINTN
+SratGetMemoryRangeCount (
+  VOID
   )
 {
-  UINTN                       Amount;
-  UINTN                       AddressCells;
-  UINTN                       Idx;
-  INT32                       Node = 0;
-  MEMORY_REGION_DESCRIPTION  *MemReg = NULL;
-  CONST UINT32               *Reg;
-  UINTN                       RegCount = 0;
-  UINTN                       SizeCells;
-  EFI_STATUS                  Status;
-
-  if (Regions == NULL || Count == NULL) {
-    return EFI_INVALID_PARAMETER;
+  UINTN          Amount;
+  UINTN          AddressCells;
+  UINTN          Count = 0;
+  INT32          Node = 0;
+  CONST UINT32  *Reg;
+  UINTN          SizeCells;
+
+  while (!EFI_ERROR (GetMemoryRanges (&Node, &Reg, &Amount, &AddressCells, &SizeCells))) {
+    Count += Amount;
   }
 
-  while ((Status = GetMemoryRanges (&Node, &Reg, &Amount, &AddressCells, &SizeCells)) != EFI_NOT_FOUND) {
-    if (EFI_ERROR (Status)) {
-      if (MemReg != NULL) {
-        FreePool (MemReg);
-      }
-      return Status;
-    }
-
-    MEMORY_REGION_DESCRIPTION  *TmpArray = (MEMORY_REGION_DESCRIPTION *) ReallocatePool (
-                                  RegCount * sizeof (MEMORY_REGION_DESCRIPTION),
-                                  (RegCount + Amount) * sizeof (MEMORY_REGION_DESCRIPTION),
-                                  MemReg);
-    if (TmpArray == NULL) {
-      DEBUG ((
-        EFI_D_ERROR,
-        "%a: failed to allocate memory for memory region info, Status = %r\n",
-        __func__,
-        EFI_OUT_OF_RESOURCES
-        ));
-      if (MemReg != NULL) {
-        FreePool (MemReg);
-      }
-      return EFI_OUT_OF_RESOURCES;
-    }
-
-    MemReg = TmpArray;
-
-    for (Idx = 0; Idx < Amount; ++Idx, ++RegCount) {
-      UINT64  Tmp;
-
-      Tmp = SwapBytes32 (*Reg++);
-      if (AddressCells > 1) {
-        Tmp = (Tmp << 32) | SwapBytes32 (*Reg++);
-      }
-      MemReg[RegCount].Addr = Tmp;
-
-      Tmp = SwapBytes32 (*Reg++);
-      if (SizeCells > 1) {
-        Tmp = (Tmp << 32) | SwapBytes32 (*Reg++);
-      }
-      MemReg[RegCount].Size = Tmp;
-    }
-  }
-
-  *Regions = MemReg;
-  *Count = RegCount;
+  return Count;
+}
 
-  return EFI_SUCCESS;
+STATIC
+UINTN
+SratGetTableSize (
+  IN  UINTN  RegCount
+  )
+{
+  return sizeof (SratHeaderTemplate) +
+         RegCount * sizeof (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE) +
+         PLATFORM_CHIP_COUNT * BS1000_CORE_COUNT * sizeof (EFI_ACPI_6_4_GICC_AFFINITY_STRUCTURE) +
+         PLATFORM_CHIP_COUNT * BS1000_GIC_ITS_COUNT * sizeof (EFI_ACPI_6_4_GIC_ITS_AFFINITY_STRUCTURE);
 }
 
 EFI_STATUS
@@ -112,62 +71,76 @@ SratInit (
   EFI_ACPI_DESCRIPTION_HEADER  **Table
   )
 {
+  UINTN                                                Amount;
+  UINTN                                                AddressCells;
+  UINT64                                               Addr;
   UINTN                                                ChipIdx;
   UINTN                                                Idx;
+  INT32                                                Node;
   UINTN                                                Num;
-  MEMORY_REGION_DESCRIPTION                           *Regions;
+  CONST UINT32                                        *Reg;
   UINTN                                                RegCount;
-  UINTN                                                Size;
+  UINT64                                               Size;
+  UINTN                                                SizeCells;
   EFI_ACPI_6_4_GICC_AFFINITY_STRUCTURE                *SratGiccAffinity;
   EFI_ACPI_6_4_GIC_ITS_AFFINITY_STRUCTURE             *SratGicItsAffinity;
   EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE              *SratMemAffinity;
   EFI_ACPI_6_4_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER  *SratTablePointer;
+  UINT32                                               SncCount;
   EFI_STATUS                                           Status;
-
-  Status = GetMemoryRegions (&Regions, &RegCount);
-  if (EFI_ERROR (Status)) {
-    return Status;
+  UINTN                                                TableSize;
+
+  //
+  // Nothing to describe on a single chip unless it is split into SNC domains
+  //
+  SncCount = SncGetDomainCount ();
+  if (PLATFORM_CHIP_COUNT * SncCount == 1) {
+    return EFI_UNSUPPORTED;
   }
 
-  Size = sizeof (SratHeaderTemplate) +
-         RegCount * sizeof (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE) +
-         PLATFORM_CHIP_COUNT * BS1000_CORE_COUNT * sizeof (EFI_ACPI_6_4_GICC_AFFINITY_STRUCTURE) +
-         PLATFORM_CHIP_COUNT * BS1000_GIC_ITS_COUNT * sizeof (EFI_ACPI_6_4_GIC_ITS_AFFINITY_STRUCTURE);
+  RegCount  = SratGetMemoryRangeCount ();
+  TableSize = SratGetTableSize (RegCount);
 
   /* SRAT Table Header */
-  SratTablePointer = (EFI_ACPI_6_4_SYSTEM_RESOURCE_AFFINITY_TABLE_HEADER *) AllocateZeroPool (Size);
+  SratTablePointer = AllocateZeroPool (TableSize);
   if (SratTablePointer == NULL) {
-    DEBUG ((
-      EFI_D_ERROR,
-      "%a: failed to allocate memory, Status = %r\n",
-      __func__,
-      EFI_OUT_OF_RESOURCES
-      ));
-    if (Regions != NULL) {
-      FreePool (Regions);
-    }
     return EFI_OUT_OF_RESOURCES;
   }
   CopyMem ((VOID *) SratTablePointer, (VOID *) &SratHeaderTemplate, sizeof (SratHeaderTemplate));
-  SratTablePointer->Header.Length = Size;
+  SratTablePointer->Header.Length = TableSize;
 
-  /* Memory Affinity Structures */
+  /* Memory Affinity Structures, filled in straight from the memory nodes */
   SratMemAffinity =
     (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE *) ((UINT8 *) SratTablePointer + sizeof (SratHeaderTemplate));
-  for (Idx = 0; Idx < RegCount; ++Idx) {
-    ZeroMem ((VOID *) &SratMemAffinity[Idx], sizeof (SratMemAffinity[Idx]));
-    SratMemAffinity[Idx].Type = EFI_ACPI_6_4_MEMORY_AFFINITY;
-    SratMemAffinity[Idx].Length = sizeof (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE);
-    SratMemAffinity[Idx].ProximityDomain = (UINT32) PLATFORM_ADDR_CHIP (Regions[Idx].Addr);
-    SratMemAffinity[Idx].AddressBaseLow =
-      (UINT32) (Regions[Idx].Addr & 0xFFFFFFFF);
-    SratMemAffinity[Idx].AddressBaseHigh =
-      (UINT32) ((Regions[Idx].Addr & 0xFFFFFFFF00000000ULL) >> 32);
-    SratMemAffinity[Idx].LengthLow =
-      (UINT32) (Regions[Idx].Size & 0xFFFFFFFF);
-    SratMemAffinity[Idx].LengthHigh =
-      (UINT32) ((Regions[Idx].Size & 0xFFFFFFFF00000000ULL) >> 32);
-    SratMemAffinity[Idx].Flags = EFI_ACPI_6_4_MEMORY_ENABLED;
+  Node = 0;
+  Num  = 0;
+  while ((Status = GetMemoryRanges (&Node, &Reg, &Amount, &AddressCells, &SizeCells)) != EFI_NOT_FOUND) {
+    if (EFI_ERROR (Status)) {
+      FreePool (SratTablePointer);
+      return Status;
+    }
+
+    for (Idx = 0; Idx < Amount && Num < RegCount; ++Idx, ++Num) {
+      Addr = SwapBytes32 (*Reg++);
+      if (AddressCells > 1) {
+        Addr = (Addr << 32) | SwapBytes32 (*Reg++);
+      }
+
+      Size = SwapBytes32 (*Reg++);
+      if (SizeCells > 1) {
+        Size = (Size << 32) | SwapBytes32 (*Reg++);
+      }
+
+      SratMemAffinity[Num].Type = EFI_ACPI_6_4_MEMORY_AFFINITY;
+      SratMemAffinity[Num].Length = sizeof (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE);
+      SratMemAffinity[Num].ProximityDomain = (UINT32) PLATFORM_ADDR_CHIP (Addr) * SncCount +
+                                             SncGetMemoryDomain (Node);
+      SratMemAffinity[Num].AddressBaseLow = (UINT32) (Addr & 0xFFFFFFFF);
+      SratMemAffinity[Num].AddressBaseHigh = (UINT32) ((Addr & 0xFFFFFFFF00000000ULL) >> 32);
+      SratMemAffinity[Num].LengthLow = (UINT32) (Size & 0xFFFFFFFF);
+      SratMemAffinity[Num].LengthHigh = (UINT32) ((Size & 0xFFFFFFFF00000000ULL) >> 32);
+      SratMemAffinity[Num].Flags = EFI_ACPI_6_4_MEMORY_ENABLED;
+    }
   }
 
   /* Gic Core Affinity Structures */
@@ -176,10 +149,10 @@ SratInit (
       RegCount * sizeof (EFI_ACPI_6_4_MEMORY_AFFINITY_STRUCTURE));
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
     for (Idx = 0; Idx < BS1000_CORE_COUNT; ++Idx, ++Num) {
-      ZeroMem ((VOID *) &SratGiccAffinity[Num], sizeof (SratGiccAffinity[Num]));
       SratGiccAffinity[Num].Type = EFI_ACPI_6_4_GICC_AFFINITY;
       SratGiccAffinity[Num].Length = sizeof (EFI_ACPI_6_4_GICC_AFFINITY_STRUCTURE);
-      SratGiccAffinity[Num].ProximityDomain = ChipIdx;
+      SratGiccAffinity[Num].ProximityDomain = ChipIdx * SncCount +
+                                              SncGetClusterDomain (Idx / BS1000_CORE_COUNT_PER_CLUSTER);
       SratGiccAffinity[Num].AcpiProcessorUid = Num;
       SratGiccAffinity[Num].Flags = EFI_ACPI_6_4_GICC_ENABLED;
     }
@@ -191,34 +164,17 @@ SratInit (
       PLATFORM_CHIP_COUNT * BS1000_CORE_COUNT * sizeof (EFI_ACPI_6_4_GICC_AFFINITY_STRUCTURE));
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
     for (Idx = 0; Idx < BS1000_GIC_ITS_COUNT; ++Idx, ++Num) {
-      ZeroMem ((VOID *) &SratGicItsAffinity[Num], sizeof (SratGicItsAffinity[Num]));
       SratGicItsAffinity[Num].Type = EFI_ACPI_6_4_GIC_ITS_AFFINITY;
       SratGicItsAffinity[Num].Length = sizeof (EFI_ACPI_6_4_GIC_ITS_AFFINITY_STRUCTURE);
-      SratGicItsAffinity[Num].ProximityDomain = ChipIdx;
+      SratGicItsAffinity[Num].ProximityDomain = ChipIdx * SncCount + SncGetItsDomain (Idx);
       SratGicItsAffinity[Num].ItsId = Num;
     }
   }
 
-  if (Regions != NULL) {
-    FreePool (Regions);
-  }
-
   *Table = (EFI_ACPI_DESCRIPTION_HEADER *) SratTablePointer;
   return EFI_SUCCESS;
 }
 
-#else
-
-EFI_STATUS
-SratInit (
-  EFI_ACPI_DESCRIPTION_HEADER  **Table
-  )
-{
-  return EFI_UNSUPPORTED;
-}
-
-#endif
-
 VOID
 SratDestroy (
   EFI_ACPI_DESCRIPTION_HEADER  *Table
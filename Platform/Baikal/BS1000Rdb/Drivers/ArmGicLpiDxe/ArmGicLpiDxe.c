@@ -12,14 +12,66 @@
 
 #include <BS1000.h>
 
-#define ARM_GICD_TYPER               0x0004
-#define ARM_GICD_TYPER_IDBITS_SHIFT  19
-#define ARM_GICD_TYPER_IDBITS_MASK   (0x1F << ARM_GICD_TYPER_IDBITS_SHIFT)
-#define ARM_GICR_CTLR                0x0000
-#define ARM_GICR_CTLR_ENABLE_LPIS    BIT0
-#define ARM_GICR_PROPBASER           0x0070
-#define ARM_GICR_PENDBASER           0x0078
-#define ARM_GICR_PENDBASER_PTZ       BIT62
+#define ARM_GICD_TYPER                        0x0004
+#define ARM_GICD_TYPER_IDBITS_SHIFT           19
+#define ARM_GICD_TYPER_IDBITS_MASK            (0x1F << ARM_GICD_TYPER_IDBITS_SHIFT)
+#define ARM_GICR_CTLR                         0x0000
+#define ARM_GICR_CTLR_ENABLE_LPIS             BIT0
+#define ARM_GICR_PROPBASER                    0x0070
+#define ARM_GICR_PENDBASER                    0x0078
+#define ARM_GICR_PENDBASER_PTZ                BIT62
+#define ARM_GICR_FRAME_SIZE                   0x20000
+
+// LPIs start at INTID 8192, so they need at least 14 ID bits
+#define ARM_LPI_INTID_BASE                    8192
+#define ARM_LPI_IDBITS_MIN                    13
+
+//
+// Allocate the LPI tables of a chip. The address window of every chip is
+// fixed by PLATFORM_ADDR_BITS_PER_CHIP and the memory map is built from the
+// device tree memory nodes, so the highest free pages below the end of the
+// window are in the chip's own DRAM unless it has none left. The tables of
+// chip 0 stay below 4 GiB as they always have. The result is zeroed and
+// 64 KiB aligned, as PENDBASER requires.
+//
+STATIC
+EFI_PHYSICAL_ADDRESS
+LpiTablesAllocate (
+  IN  UINTN  ChipIdx,
+  IN  UINTN  Size
+  )
+{
+  EFI_PHYSICAL_ADDRESS  Base;
+  UINTN                 Pages;
+  EFI_STATUS            Status;
+
+  Pages  = EFI_SIZE_TO_PAGES (Size + SIZE_64KB);
+  Status = EFI_NOT_FOUND;
+
+  if (ChipIdx > 0) {
+    Base = PLATFORM_CHIP_MEM_OFFSET (ChipIdx + 1) - 1;
+    Status = gBS->AllocatePages (AllocateMaxAddress, EfiACPIReclaimMemory, Pages, &Base);
+    if (!EFI_ERROR (Status) && PLATFORM_ADDR_CHIP (Base) != ChipIdx) {
+      gBS->FreePages (Base, Pages);
+      Status = EFI_NOT_FOUND;
+    }
+
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_WARN, "%a: no local memory on chip %u, LPI tables are remote\n", __func__, ChipIdx));
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    Base = (EFI_PHYSICAL_ADDRESS) (BASE_4GB - 1);
+    Status = gBS->AllocatePages (AllocateMaxAddress, EfiACPIReclaimMemory, Pages, &Base);
+    if (EFI_ERROR (Status)) {
+      return 0;
+    }
+  }
+
+  ZeroMem ((VOID *) Base, EFI_PAGES_TO_SIZE (Pages));
+  return ALIGN_VALUE (Base, SIZE_64KB);
+}
 
 EFI_STATUS
 EFIAPI
@@ -36,44 +88,72 @@ ArmGicLpiDxeInitialize (
   EFI_PHYSICAL_ADDRESS  LpiTablesBase;
   UINTN                 LpiTablesSize;
   EFI_PHYSICAL_ADDRESS  PendTableAddr;
-  UINT64                PropBaser;
-  EFI_STATUS            Status;
+  UINTN                 PendTableSize;
+  EFI_PHYSICAL_ADDRESS  PropTableAddr;
+  UINTN                 PropTableSize;
 
   GicDistributorBase    = FixedPcdGet64 (PcdGicDistributorBase);
   GicRedistributorsBase = FixedPcdGet64 (PcdGicRedistributorsBase);
 
-  LpiTablesBase = (EFI_PHYSICAL_ADDRESS) (BASE_4GB - 1);
-  LpiTablesSize = SIZE_64KB * (1 + BS1000_CORE_COUNT * PLATFORM_CHIP_COUNT);
-
-  Status = gBS->AllocatePages (
-                  AllocateMaxAddress,
-                  EfiACPIReclaimMemory,
-                  EFI_SIZE_TO_PAGES (LpiTablesSize),
-                  &LpiTablesBase
-                  );
-  if (EFI_ERROR (Status)) {
-    ASSERT_EFI_ERROR (Status);
-    return Status;
-  }
-
-  ZeroMem ((VOID *) LpiTablesBase, LpiTablesSize);
+  //
+  // The tables are sized for the IDs the platform is going to use rather
+  // than for everything the distributor implements: one byte per LPI for
+  // the property table, one bit per INTID for the pending tables.
+  //
   IdBits = (MmioRead32 (GicDistributorBase + ARM_GICD_TYPER) & ARM_GICD_TYPER_IDBITS_MASK) >>
            ARM_GICD_TYPER_IDBITS_SHIFT;
+  IdBits = MIN (IdBits, FixedPcdGet32 (PcdGicLpiIdBits) - 1);
+  if (IdBits < ARM_LPI_IDBITS_MIN) {
+    DEBUG ((EFI_D_ERROR, "%a: %u ID bits are not enough for LPIs\n", __func__, IdBits + 1));
+    return EFI_UNSUPPORTED;
+  }
 
-  PropBaser     = LpiTablesBase | IdBits;
-  PendTableAddr = LpiTablesBase + SIZE_64KB;
+  PropTableSize = ALIGN_VALUE (((UINTN) 1 << (IdBits + 1)) - ARM_LPI_INTID_BASE, SIZE_64KB);
+  PendTableSize = ALIGN_VALUE (((UINTN) 1 << (IdBits + 1)) / 8, SIZE_64KB);
 
+  //
+  // There is one property table for the whole system, like the OS keeps,
+  // next to the pending tables of chip 0. Every chip gets its pending
+  // tables in its own memory.
+  //
+  PropTableAddr = 0;
   for (ChipIdx = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
+    LpiTablesSize = PendTableSize * BS1000_CORE_COUNT;
+    if (ChipIdx == 0) {
+      LpiTablesSize += PropTableSize;
+    }
+
+    LpiTablesBase = LpiTablesAllocate (ChipIdx, LpiTablesSize);
+    if (LpiTablesBase == 0) {
+      ASSERT_EFI_ERROR (EFI_OUT_OF_RESOURCES);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    PendTableAddr = LpiTablesBase;
+    if (ChipIdx == 0) {
+      PropTableAddr  = LpiTablesBase;
+      PendTableAddr += PropTableSize;
+    }
+
+    DEBUG ((
+      EFI_D_INFO,
+      "%a: chip %u: PROPBASER 0x%lx, pending tables 0x%lx, %u ID bits\n",
+      __func__,
+      ChipIdx,
+      PropTableAddr,
+      PendTableAddr,
+      IdBits + 1
+      ));
+
     for (Core = 0; Core < BS1000_CORE_COUNT; ++Core) {
       EFI_PHYSICAL_ADDRESS  GicRdistBase =
-        PLATFORM_ADDR_OUT_CHIP(ChipIdx, GicRedistributorsBase) + 0x20000 * Core;
-      UINT64                PendBaser = ARM_GICR_PENDBASER_PTZ | PendTableAddr;
+        PLATFORM_ADDR_OUT_CHIP(ChipIdx, GicRedistributorsBase) + ARM_GICR_FRAME_SIZE * Core;
 
-      MmioWrite64 (GicRdistBase + ARM_GICR_PROPBASER, PropBaser);
-      MmioWrite64 (GicRdistBase + ARM_GICR_PENDBASER, PendBaser);
+      MmioWrite64 (GicRdistBase + ARM_GICR_PROPBASER, PropTableAddr | IdBits);
+      MmioWrite64 (GicRdistBase + ARM_GICR_PENDBASER, ARM_GICR_PENDBASER_PTZ | PendTableAddr);
       MmioOr32 (GicRdistBase + ARM_GICR_CTLR, ARM_GICR_CTLR_ENABLE_LPIS);
 
-      PendTableAddr += SIZE_64KB;
+      PendTableAddr += PendTableSize;
     }
   }
 
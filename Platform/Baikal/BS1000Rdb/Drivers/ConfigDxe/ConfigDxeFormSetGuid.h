@@ -0,0 +1,15 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef CONFIG_DXE_FORM_SET_GUID_H_
+#define CONFIG_DXE_FORM_SET_GUID_H_
+
+#define CONFIG_DXE_FORM_SET_GUID { \
+  0x30AA34DC, 0xEB61, 0x48C9, {0x93, 0xE7, 0x37, 0xD7, 0x85, 0x87, 0x15, 0x15} \
+  }
+
+extern EFI_GUID gConfigDxeFormSetGuid;
+
+#endif // CONFIG_DXE_FORM_SET_GUID_H_
@@ -10,6 +10,7 @@
 #include <Library/BaikalSmbiosLib.h>
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
+#include <Library/CacheInfoLib.h>
 #include <Library/CrcLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -449,9 +450,9 @@ SmbiosTable4Init (
 
   for (ChipIdx = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
     ((EFI_SMBIOS_TABLE_HEADER *) &SmbiosTable4)->Handle = BAIKAL_SMBIOS_TABLE_HANDLE (4, ChipIdx);
-    *(UINT16 *) &SmbiosTable4.L1CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * 5 + 1);
-    *(UINT16 *) &SmbiosTable4.L2CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * 5 + 2);
-    *(UINT16 *) &SmbiosTable4.L3CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * 5 + 3);
+    *(UINT16 *) &SmbiosTable4.L1CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * BS1000_CACHE_COUNT + BS1000_CACHE_L1D);
+    *(UINT16 *) &SmbiosTable4.L2CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * BS1000_CACHE_COUNT + BS1000_CACHE_L2);
+    *(UINT16 *) &SmbiosTable4.L3CacheHandle = BAIKAL_SMBIOS_TABLE_HANDLE (7, ChipIdx * BS1000_CACHE_COUNT + BS1000_CACHE_L3);
     SmbiosTable4Strings[0][3] += ChipIdx;
     Status = CreateSmbiosTable ((EFI_SMBIOS_TABLE_HEADER *) &SmbiosTable4,
                                 SmbiosTable4Strings, ARRAY_SIZE (SmbiosTable4Strings));
@@ -465,125 +466,101 @@ SmbiosTable4Init (
 
 // Cache Information tables, type 7
 
-#pragma pack(1)
-STATIC VOID  *SmbiosTable7[] = {
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L1 Instruction"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 0)
-      },
-      1,
-      0x180,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorParity,
-      CacheTypeInstruction,
-      CacheAssociativity4Way,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L1 Data"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 1)
-      },
-      1,
-      0x180,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorMultiBit,
-      CacheTypeData,
-      CacheAssociativity16Way,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT,
-      64 * BAIKAL_PROCESSOR_CORE_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L2"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 2)
-      },
-      1,
-      0x281,
-      512 * BAIKAL_PROCESSOR_CORE_COUNT,
-      512 * BAIKAL_PROCESSOR_CORE_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorMultiBit,
-      CacheTypeUnified,
-      CacheAssociativity8Way,
-      512 * BAIKAL_PROCESSOR_CORE_COUNT,
-      512 * BAIKAL_PROCESSOR_CORE_COUNT
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L3"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 3)
-      },
-      1,
-      0x282,
-      2048 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      2048 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      {},
-      {},
-      0,
-      CacheErrorMultiBit,
-      CacheTypeUnified,
-      CacheAssociativityUnknown,
-      2048 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-      2048 * BAIKAL_PROCESSOR_CLUSTER_COUNT,
-    }
-  ),
-  BAIKAL_SMBIOS_TABLE (
-    7,
-    BAIKAL_SMBIOS_STRING ("L4"),
-    {
-      {
-        SMBIOS_TYPE_CACHE_INFORMATION,
-        sizeof (SMBIOS_TABLE_TYPE7),
-        BAIKAL_SMBIOS_TABLE_HANDLE (7, 4)
-      },
-      1,
-      0x2A3,
-      32 * 1024,
-      32 * 1024,
-      {},
-      {},
-      0,
-      CacheErrorMultiBit,
-      CacheTypeUnified,
-      CacheAssociativityUnknown,
-      32 * 1024,
-      32 * 1024
-    }
-  )
+#define BAIKAL_CACHE_DESIGNATION_SIZE  16
+
+// Indexed like the BS1000_CACHE_INFO table
+STATIC CONST UINT8  SmbiosTable7ErrorCorrection[BS1000_CACHE_COUNT] = {
+  CacheErrorParity,     // L1I
+  CacheErrorMultiBit,   // L1D
+  CacheErrorMultiBit,   // L2
+  CacheErrorMultiBit,   // L3
+  CacheErrorMultiBit    // L4
 };
-#pragma pack()
+
+STATIC
+UINT16
+SmbiosTable7Configuration (
+  IN  CONST CACHE_INFO  *Cache
+  )
+{
+  UINT16  Mode;
+
+  if ((Cache->Policy & CACHE_INFO_WRITE_BACK) &&
+      (Cache->Policy & CACHE_INFO_WRITE_THROUGH)) {
+    Mode = 2;   // Varies with memory address
+  } else if (Cache->Policy & CACHE_INFO_WRITE_BACK) {
+    Mode = 1;
+  } else if (Cache->Policy & CACHE_INFO_WRITE_THROUGH) {
+    Mode = 0;
+  } else {
+    Mode = 3;   // Unknown
+  }
+
+  // Level, enabled, operational mode and location (external if outside the cluster)
+  return (Cache->Level - 1) | BIT7 | (Mode << 8) |
+         (Cache->Scope == CACHE_INFO_SCOPE_PACKAGE ? BIT5 : 0);
+}
+
+STATIC
+UINT8
+SmbiosTable7Associativity (
+  IN  UINT32  Ways
+  )
+{
+  switch (Ways) {
+  case 1:
+    return CacheAssociativityDirectMapped;
+  case 2:
+    return CacheAssociativity2Way;
+  case 4:
+    return CacheAssociativity4Way;
+  case 8:
+    return CacheAssociativity8Way;
+  case 12:
+    return CacheAssociativity12Way;
+  case 16:
+    return CacheAssociativity16Way;
+  case 20:
+    return CacheAssociativity20Way;
+  case 24:
+    return CacheAssociativity24Way;
+  case 32:
+    return CacheAssociativity32Way;
+  case 48:
+    return CacheAssociativity48Way;
+  case 64:
+    return CacheAssociativity64Way;
+  default:
+    return CacheAssociativityOther;
+  }
+}
+
+// Size in KiB to the 1K/64K granularity encoding of the 16-bit size fields
+STATIC
+UINT16
+SmbiosTable7Size (
+  IN  UINT32  Size
+  )
+{
+  if (Size <= 0x7FFF) {
+    return Size;
+  }
+
+  return Size / 64 > 0x7FFF ? 0xFFFF : BIT15 | (Size / 64);
+}
+
+STATIC
+UINT32
+SmbiosTable7Size2 (
+  IN  UINT32  Size
+  )
+{
+  if (Size <= 0x7FFFFFFF) {
+    return Size;
+  }
+
+  return BIT31 | (Size / 64);
+}
 
 STATIC
 EFI_STATUS
@@ -591,17 +568,60 @@ SmbiosTable7Init (
   VOID
   )
 {
-  UINTN       ChipIdx;
-  UINTN       Idx;
-  UINT16      Num;
-  EFI_STATUS  Status;
+  CACHE_INFO          Caches[BS1000_CACHE_COUNT] = BS1000_CACHE_INFO;
+  UINTN               ChipIdx;
+  CHAR8               Designation[BAIKAL_CACHE_DESIGNATION_SIZE];
+  UINTN               Idx;
+  UINTN               Instances;
+  UINT16              Num;
+  UINT32              Size;
+  EFI_STATUS          Status;
+  CHAR8              *StringPack[1];
+  SMBIOS_TABLE_TYPE7  Table7;
+
+  CacheInfoProbe (Caches, ARRAY_SIZE (Caches));
 
   for (ChipIdx = 0, Num = 0; ChipIdx < PLATFORM_CHIP_COUNT; ++ChipIdx) {
-    for (Idx = 0; Idx < ARRAY_SIZE (SmbiosTable7); ++Idx, ++Num) {
-      ((EFI_SMBIOS_TABLE_HEADER *) SmbiosTable7[Idx])->Handle = BAIKAL_SMBIOS_TABLE_HANDLE (7, Num);
-      *(UINT16 *) &((SMBIOS_TABLE_TYPE7 *) SmbiosTable7[Idx])->SupportedSRAMType = BIT1;
-      *(UINT16 *) &((SMBIOS_TABLE_TYPE7 *) SmbiosTable7[Idx])->CurrentSRAMType = BIT1;
-      Status = CreateSmbiosTable ((EFI_SMBIOS_TABLE_HEADER *) SmbiosTable7[Idx], NULL, 0);
+    for (Idx = 0; Idx < ARRAY_SIZE (Caches); ++Idx, ++Num) {
+      if (Caches[Idx].Scope == CACHE_INFO_SCOPE_CORE) {
+        Instances = BAIKAL_PROCESSOR_CORE_COUNT;
+      } else if (Caches[Idx].Scope == CACHE_INFO_SCOPE_CLUSTER) {
+        Instances = BAIKAL_PROCESSOR_CLUSTER_COUNT;
+      } else {
+        Instances = 1;
+      }
+
+      // Total size of all instances on the chip in KiB
+      Size = (UINT32) (((UINT64) Caches[Idx].Size * Instances) / SIZE_1KB);
+
+      ZeroMem (&Table7, sizeof (Table7));
+      Table7.Hdr.Type = SMBIOS_TYPE_CACHE_INFORMATION;
+      Table7.Hdr.Length = sizeof (SMBIOS_TABLE_TYPE7);
+      Table7.Hdr.Handle = BAIKAL_SMBIOS_TABLE_HANDLE (7, Num);
+      Table7.SocketDesignation = 1;
+      Table7.CacheConfiguration = SmbiosTable7Configuration (&Caches[Idx]);
+      *(UINT16 *) &Table7.MaximumCacheSize = SmbiosTable7Size (Size);
+      *(UINT16 *) &Table7.InstalledSize = SmbiosTable7Size (Size);
+      *(UINT16 *) &Table7.SupportedSRAMType = BIT1;
+      *(UINT16 *) &Table7.CurrentSRAMType = BIT1;
+      Table7.ErrorCorrectionType = SmbiosTable7ErrorCorrection[Idx];
+      Table7.SystemCacheType = Caches[Idx].Type == CACHE_INFO_TYPE_INSTRUCTION ? CacheTypeInstruction :
+                               Caches[Idx].Type == CACHE_INFO_TYPE_DATA ? CacheTypeData : CacheTypeUnified;
+      Table7.Associativity = SmbiosTable7Associativity (Caches[Idx].Associativity);
+      *(UINT32 *) &Table7.MaximumCacheSize2 = SmbiosTable7Size2 (Size);
+      *(UINT32 *) &Table7.InstalledSize2 = SmbiosTable7Size2 (Size);
+
+      AsciiSPrint (
+        Designation,
+        sizeof (Designation),
+        "L%u%a",
+        Caches[Idx].Level,
+        Caches[Idx].Type == CACHE_INFO_TYPE_INSTRUCTION ? " Instruction" :
+          Caches[Idx].Type == CACHE_INFO_TYPE_DATA ? " Data" : ""
+        );
+
+      StringPack[0] = Designation;
+      Status = CreateSmbiosTable ((EFI_SMBIOS_TABLE_HEADER *) &Table7, StringPack, ARRAY_SIZE (StringPack));
       if (EFI_ERROR (Status)) {
         return Status;
       }
@@ -93,19 +93,18 @@ SpdClientDxeInitialize (
       UINT8                         StartAddr = 0;
 
       for (;;) {
-        CONST VOID  *Prop;
-        UINT32       PropSize;
+        CONST FDT_CLIENT_REG  *Reg;
+        UINT32                 RegCount;
+        UINT64                 Rate;
 
         if (FdtClient->FindNextCompatibleNode (FdtClient, "snps,designware-i2c", Node, &Node) != EFI_SUCCESS) {
           return EFI_DEVICE_ERROR;
         }
 
-        if (FdtClient->GetNodeProperty (FdtClient, Node, "reg", &Prop, &PropSize) == EFI_SUCCESS && PropSize == 2 * sizeof (UINT64) &&
-            SwapBytes64 (ReadUnaligned64 (Prop)) == I2cBase &&
-            FdtClient->GetNodeProperty (FdtClient, Node, "clocks", &Prop, &PropSize) == EFI_SUCCESS && PropSize == sizeof (UINT32) &&
-            FdtClient->FindNodeByPhandle (FdtClient, SwapBytes32 (*(CONST UINT32 *) Prop), &Node) == EFI_SUCCESS &&
-            FdtClient->GetNodeProperty (FdtClient, Node, "clock-frequency", &Prop, &PropSize) == EFI_SUCCESS && PropSize == sizeof (UINT32)) {
-          I2cIclk = SwapBytes32 (*(CONST UINT32 *) Prop);
+        if (FdtClient->GetNodeReg (FdtClient, Node, &Reg, &RegCount) == EFI_SUCCESS &&
+            Reg[0].Address == I2cBase &&
+            FdtClient->GetNodeClockRate (FdtClient, Node, 0, &Rate) == EFI_SUCCESS) {
+          I2cIclk = Rate;
           break;
         }
       }
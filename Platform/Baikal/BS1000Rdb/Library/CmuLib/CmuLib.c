@@ -4,7 +4,7 @@
 **/
 
 #include <Uefi.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/CmuLib.h>
 
 #define BAIKAL_SMC_CLK_SET  0xC2000401
@@ -20,7 +20,7 @@ CmuClkChGetRate (
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_CLK_GET;
   ArmSmcArgs.Arg1 = ClkChCtlAddr;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -36,5 +36,5 @@ CmuClkChSetRate (
   ArmSmcArgs.Arg0 = BAIKAL_SMC_CLK_SET;
   ArmSmcArgs.Arg1 = ClkChCtlAddr;
   ArmSmcArgs.Arg2 = ClkChRate;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
 }
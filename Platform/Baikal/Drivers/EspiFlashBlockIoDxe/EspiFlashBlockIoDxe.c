@@ -12,33 +12,96 @@
 #include <Library/DxeServicesTableLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/PcdLib.h>
+#include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/UefiLib.h>
 #include <Library/UefiRuntimeLib.h>
 #include <Platform/FlashMap.h>
 #include <Protocol/BlockIo.h>
+#include <Protocol/BlockIo2.h>
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Library/EspiLib.h>
 #include <BM1000.h>
 
 #define ESPI_FLASH_PRIVATE_DATA_SIGNATURE  SIGNATURE_32 ('E', 'S', 'P', 'I')
 #define ESPI_FLASH_PRIVATE_FROM_BLKIO(a)   CR (a, ESPI_FLASH_PRIVATE_DATA, BlockIo, ESPI_FLASH_PRIVATE_DATA_SIGNATURE)
+#define ESPI_FLASH_PRIVATE_FROM_BLKIO2(a)  CR (a, ESPI_FLASH_PRIVATE_DATA, BlockIo2, ESPI_FLASH_PRIVATE_DATA_SIGNATURE)
 #define ESPI_FLASH_GPIO_CS  0
 
 #define DIVIDE_ROUND_UP(x,n)  (((x) + (n) - 1) / (n))
 #define FAT_BLOCK_SIZE  512
 
+//
+// Write-back cache: dirty sectors are erased and programmed by a timer
+// driven state machine. A sector is left alone for ESPI_FLASH_WRITEBACK_DELAY
+// after its last write so that consecutive block writes are merged. A sector
+// that fails to write back stays dirty; it is retried when it is written
+// again or on the next flush, which reports the error.
+//
+#define ESPI_FLASH_CACHE_LINES       (SPI_SECTOR / SPI_SUBSECTOR)
+#define ESPI_FLASH_TIMER_PERIOD      EFI_TIMER_PERIOD_MILLISECONDS (1)
+#define ESPI_FLASH_TICK_BUDGET       200000ULL    // ns of work per timer tick
+#define ESPI_FLASH_WRITEBACK_DELAY   50000000ULL  // ns
+#define ESPI_FLASH_BUSY_TIMEOUT      5000000000ULL
+#define ESPI_FLASH_POLL_US           5
+
 typedef struct {
   VENDOR_DEVICE_PATH        Vendor;
   EFI_DEVICE_PATH_PROTOCOL  End;
 } ESPI_FLASH_DEVICE_PATH;
 
+typedef struct {
+  BOOLEAN  Valid;
+  BOOLEAN  Dirty;
+  BOOLEAN  Busy;        // Owned by the write-back job
+  BOOLEAN  Failed;      // Last write-back failed, not retried in the background
+  UINTN    Adr;
+  UINT8    *Data;
+  UINT32   Generation;  // Incremented by every write
+  UINT64   DirtyTime;
+  UINT64   LastUse;
+} ESPI_FLASH_CACHE_LINE;
+
+typedef enum {
+  EspiFlashJobIdle,
+  EspiFlashJobErase,
+  EspiFlashJobProgram
+} ESPI_FLASH_JOB_STATE;
+
+typedef struct {
+  ESPI_FLASH_JOB_STATE  State;
+  UINTN                 Adr;
+  UINTN                 Size;
+  UINTN                 Offset;
+  UINTN                 LineCount;
+  UINTN                 Lines[ESPI_FLASH_CACHE_LINES];
+  UINT32                Generations[ESPI_FLASH_CACHE_LINES];
+} ESPI_FLASH_JOB;
+
+typedef enum {
+  EspiFlashStepIdle,     // Nothing to write back
+  EspiFlashStepBusy,     // Flash is busy with an erase or program
+  EspiFlashStepProgress
+} ESPI_FLASH_STEP;
+
+typedef struct {
+  LIST_ENTRY              Link;
+  EFI_BLOCK_IO2_TOKEN     *Token;
+} ESPI_FLASH_FLUSH_REQUEST;
+
 typedef struct {
   UINTN                   Signature;
   EFI_BLOCK_IO_PROTOCOL   BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL  BlockIo2;
   EFI_BLOCK_IO_MEDIA      Media;
   ESPI_FLASH_DEVICE_PATH  DevicePath;
   UINT64                  Size;
+  ESPI_FLASH_CACHE_LINE   Cache[ESPI_FLASH_CACHE_LINES];
+  ESPI_FLASH_JOB          Job;
+  EFI_STATUS              WriteBackStatus;
+  LIST_ENTRY              FlushRequests;
+  EFI_EVENT               TimerEvent;
+  EFI_EVENT               ExitBootServicesEvent;
 } ESPI_FLASH_PRIVATE_DATA;
 
 STATIC UINTN  SectorSize;
@@ -71,31 +134,447 @@ STATIC ESPI_FLASH_DEVICE_PATH   mEspiFlashBlockIoDevicePath = {
 };
 
 //
-// EFI_BLOCK_IO_PROTOCOL
+// Write-back cache
 //
+STATIC
+UINT64
+EspiFlashTime (
+  VOID
+  )
+{
+  return GetTimeInNanoSecond (GetPerformanceCounter ());
+}
+
+STATIC
 EFI_STATUS
+EspiFlashWaitIdle (
+  VOID
+  )
+{
+  INTN    Busy;
+  UINT64  TimeStart;
+
+  TimeStart = EspiFlashTime ();
+  for (;;) {
+    Busy = EspiBusy (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS);
+    if (Busy < 0) {
+      return EFI_DEVICE_ERROR;
+    } else if (!Busy) {
+      return EFI_SUCCESS;
+    } else if (EspiFlashTime () - TimeStart > ESPI_FLASH_BUSY_TIMEOUT) {
+      return EFI_TIMEOUT;
+    }
+
+    MicroSecondDelay (ESPI_FLASH_POLL_US);
+  }
+}
+
+STATIC
+INTN
+EspiFlashLineLookup (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN UINTN                     Adr
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ESPI_FLASH_CACHE_LINES; ++Index) {
+    if (PrivateData->Cache[Index].Valid && PrivateData->Cache[Index].Adr == Adr) {
+      return Index;
+    }
+  }
+
+  return -1;
+}
+
+STATIC
+VOID
+EspiFlashJobFinish (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN EFI_STATUS                Status
+  )
+{
+  ESPI_FLASH_JOB         *Job = &PrivateData->Job;
+  ESPI_FLASH_CACHE_LINE  *Line;
+  UINTN                  Index;
+
+  for (Index = 0; Index < Job->LineCount; ++Index) {
+    Line = &PrivateData->Cache[Job->Lines[Index]];
+    Line->Busy = FALSE;
+    if (EFI_ERROR (Status)) {
+      // Keep the data, retrying a failing sector on every tick does not help
+      Line->Failed = TRUE;
+    } else if (Line->Generation == Job->Generations[Index]) {
+      Line->Dirty  = FALSE;
+      Line->Failed = FALSE;
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((
+      EFI_D_ERROR,
+      "%a: write-back of 0x%lx @ 0x%08lx failed, %r\n",
+      __func__,
+      Job->Size,
+      Job->Adr,
+      Status
+      ));
+    PrivateData->WriteBackStatus = Status;
+  }
+
+  Job->State = EspiFlashJobIdle;
+}
+
+STATIC
+BOOLEAN
+EspiFlashJobStart (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN BOOLEAN                   Force
+  )
+{
+  ESPI_FLASH_JOB         *Job = &PrivateData->Job;
+  ESPI_FLASH_CACHE_LINE  *Line;
+  INTN                   Oldest = -1;
+  INTN                   Found;
+  UINTN                  Index;
+  UINTN                  Group;
+  UINTN                  Cmd;
+  UINT64                 Now;
+
+  Now = EspiFlashTime ();
+  for (Index = 0; Index < ESPI_FLASH_CACHE_LINES; ++Index) {
+    Line = &PrivateData->Cache[Index];
+    if (!Line->Dirty || Line->Busy || Line->Failed) {
+      continue;
+    }
+
+    if (!Force && Now - Line->DirtyTime < ESPI_FLASH_WRITEBACK_DELAY) {
+      continue;
+    }
+
+    if (Oldest < 0 || Line->DirtyTime < PrivateData->Cache[Oldest].DirtyTime) {
+      Oldest = Index;
+    }
+  }
+
+  if (Oldest < 0) {
+    return FALSE;
+  }
+
+  Job->Adr       = PrivateData->Cache[Oldest].Adr;
+  Job->Size      = SectorSize;
+  Job->LineCount = 1;
+  Job->Lines[0]  = Oldest;
+  Cmd            = CMD_FLASH_SSE;
+
+  //
+  // Use a single sector erase if every subsector of the sector is dirty
+  //
+  if (SectorSize == SPI_SUBSECTOR) {
+    Group = Job->Adr & ~((UINTN)SPI_SECTOR - 1);
+    for (Index = 0; Index < SPI_SECTOR / SPI_SUBSECTOR; ++Index) {
+      Found = EspiFlashLineLookup (PrivateData, Group + Index * SPI_SUBSECTOR);
+      if (Found < 0 || !PrivateData->Cache[Found].Dirty || PrivateData->Cache[Found].Busy ||
+          PrivateData->Cache[Found].Failed) {
+        break;
+      }
+
+      Job->Lines[Index] = Found;
+    }
+
+    if (Index == SPI_SECTOR / SPI_SUBSECTOR) {
+      Job->Adr       = Group;
+      Job->Size      = SPI_SECTOR;
+      Job->LineCount = Index;
+      Cmd            = CMD_FLASH_SE;
+    } else {
+      Job->Lines[0] = Oldest;
+    }
+  }
+
+  for (Index = 0; Index < Job->LineCount; ++Index) {
+    Line = &PrivateData->Cache[Job->Lines[Index]];
+    Line->Busy = TRUE;
+    Job->Generations[Index] = Line->Generation;
+  }
+
+  Job->Offset = 0;
+  Job->State  = EspiFlashJobErase;
+  if (EspiEraseStart (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, Cmd, Job->Adr)) {
+    EspiFlashJobFinish (PrivateData, EFI_DEVICE_ERROR);
+  }
+
+  return TRUE;
+}
+
+/**
+  Advance the write-back state machine by one flash operation.
+
+  @param  PrivateData  Device context.
+  @param  Force        Write back dirty sectors regardless of their age.
+**/
+STATIC
+ESPI_FLASH_STEP
+EspiFlashStep (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN BOOLEAN                   Force
+  )
+{
+  ESPI_FLASH_JOB         *Job = &PrivateData->Job;
+  ESPI_FLASH_CACHE_LINE  *Line;
+  INTN                   Busy;
+  UINTN                  Part;
+
+  if (Job->State == EspiFlashJobIdle) {
+    return EspiFlashJobStart (PrivateData, Force) ? EspiFlashStepProgress : EspiFlashStepIdle;
+  }
+
+  Busy = EspiBusy (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS);
+  if (Busy < 0) {
+    EspiFlashJobFinish (PrivateData, EFI_DEVICE_ERROR);
+    return EspiFlashStepProgress;
+  } else if (Busy) {
+    return EspiFlashStepBusy;
+  }
+
+  if (Job->State == EspiFlashJobErase) {
+    Job->State = EspiFlashJobProgram;
+  }
+
+  if (Job->Offset == Job->Size) {
+    EspiFlashJobFinish (PrivateData, EFI_SUCCESS);
+    return EspiFlashStepProgress;
+  }
+
+  Line = &PrivateData->Cache[Job->Lines[Job->Offset / SectorSize]];
+  Part = MIN (SPI_MAX_WRITE, SectorSize - Job->Offset % SectorSize);
+  if (EspiWriteStart (
+        BM1000_ESPI_BASE,
+        ESPI_FLASH_GPIO_CS,
+        Job->Adr + Job->Offset,
+        Line->Data + Job->Offset % SectorSize,
+        Part
+        )) {
+    EspiFlashJobFinish (PrivateData, EFI_DEVICE_ERROR);
+    return EspiFlashStepProgress;
+  }
+
+  Job->Offset += Part;
+  return EspiFlashStepProgress;
+}
+
+//
+// Give the sectors that have failed to write back another try
+//
+STATIC
+VOID
+EspiFlashRetryFailed (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ESPI_FLASH_CACHE_LINES; ++Index) {
+    PrivateData->Cache[Index].Failed = FALSE;
+  }
+}
+
+/**
+  Write back all dirty sectors and wait for the flash to become idle.
+  Sectors that fail again are left dirty and the error is returned.
+  Must be called at TPL_CALLBACK.
+**/
+STATIC
+EFI_STATUS
+EspiFlashFlush (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData
+  )
+{
+  EFI_STATUS       Status;
+  ESPI_FLASH_STEP  Step;
+  UINT64           BusyStart = 0;
+
+  EspiFlashRetryFailed (PrivateData);
+  for (;;) {
+    Step = EspiFlashStep (PrivateData, TRUE);
+    if (Step == EspiFlashStepIdle) {
+      break;
+    } else if (Step == EspiFlashStepBusy) {
+      if (BusyStart == 0) {
+        BusyStart = EspiFlashTime ();
+      } else if (EspiFlashTime () - BusyStart > ESPI_FLASH_BUSY_TIMEOUT) {
+        EspiFlashJobFinish (PrivateData, EFI_TIMEOUT);
+        BusyStart = 0;
+        continue;
+      }
+
+      MicroSecondDelay (ESPI_FLASH_POLL_US);
+    } else {
+      BusyStart = 0;
+    }
+  }
+
+  Status = PrivateData->WriteBackStatus;
+  PrivateData->WriteBackStatus = EFI_SUCCESS;
+  return Status;
+}
+
+STATIC
+VOID
+EspiFlashCompleteFlushRequests (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN EFI_STATUS                Status
+  )
+{
+  ESPI_FLASH_FLUSH_REQUEST  *Request;
+
+  while (!IsListEmpty (&PrivateData->FlushRequests)) {
+    Request = BASE_CR (GetFirstNode (&PrivateData->FlushRequests), ESPI_FLASH_FLUSH_REQUEST, Link);
+    RemoveEntryList (&Request->Link);
+    Request->Token->TransactionStatus = Status;
+    gBS->SignalEvent (Request->Token->Event);
+    FreePool (Request);
+  }
+}
+
+STATIC
+VOID
 EFIAPI
-EspiFlashBlockIoReset (
-  IN EFI_BLOCK_IO_PROTOCOL  *This,
-  IN BOOLEAN                ExtendedVerification
+EspiFlashTimerHandler (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData = Context;
+  BOOLEAN                  Force;
+  ESPI_FLASH_STEP          Step;
+  UINT64                   TimeStart;
+  EFI_STATUS               Status;
+
+  Force     = !IsListEmpty (&PrivateData->FlushRequests);
+  TimeStart = EspiFlashTime ();
+  do {
+    Step = EspiFlashStep (PrivateData, Force);
+  } while (Step == EspiFlashStepProgress &&
+           EspiFlashTime () - TimeStart < ESPI_FLASH_TICK_BUDGET);
+
+  //
+  // Nothing left to start: every dirty sector has been written back or has
+  // failed
+  //
+  if (Force && Step == EspiFlashStepIdle) {
+    Status = PrivateData->WriteBackStatus;
+    PrivateData->WriteBackStatus = EFI_SUCCESS;
+    EspiFlashCompleteFlushRequests (PrivateData, Status);
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+EspiFlashExitBootServices (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
   )
 {
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData = Context;
+
+  gBS->SetTimer (PrivateData->TimerEvent, TimerCancel, 0);
+  EspiFlashFlush (PrivateData);
+}
+
+/**
+  Return the cache line holding the sector at Adr, allocating one if needed.
+  Lines are recycled in LRU order; if all lines are dirty, the oldest
+  ones are written back synchronously for up to ESPI_FLASH_BUSY_TIMEOUT.
+**/
+STATIC
+EFI_STATUS
+EspiFlashLineGet (
+  IN  ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN  UINTN                     Adr,
+  IN  BOOLEAN                   Fill,
+  OUT ESPI_FLASH_CACHE_LINE    **Line
+  )
+{
+  ESPI_FLASH_CACHE_LINE  *Candidate;
+  EFI_STATUS             Status;
+  INTN                   Victim;
+  UINTN                  Index;
+  ESPI_FLASH_STEP        Step;
+  UINT64                 TimeStart;
+
+  Victim = EspiFlashLineLookup (PrivateData, Adr);
+  if (Victim >= 0) {
+    *Line = &PrivateData->Cache[Victim];
+    (*Line)->LastUse = EspiFlashTime ();
+    return EFI_SUCCESS;
+  }
+
+  TimeStart = EspiFlashTime ();
+  for (;;) {
+    Victim = -1;
+    for (Index = 0; Index < ESPI_FLASH_CACHE_LINES; ++Index) {
+      Candidate = &PrivateData->Cache[Index];
+      if (!Candidate->Valid) {
+        Victim = Index;
+        break;
+      }
+
+      if (!Candidate->Dirty && !Candidate->Busy &&
+          (Victim < 0 || Candidate->LastUse < PrivateData->Cache[Victim].LastUse)) {
+        Victim = Index;
+      }
+    }
+
+    if (Victim >= 0) {
+      break;
+    }
+
+    Step = EspiFlashStep (PrivateData, TRUE);
+    if (Step == EspiFlashStepIdle) {
+      // Every line holds a sector that has failed to write back
+      return EFI_DEVICE_ERROR;
+    } else if (EspiFlashTime () - TimeStart > ESPI_FLASH_BUSY_TIMEOUT) {
+      return EFI_TIMEOUT;
+    } else if (Step == EspiFlashStepBusy) {
+      MicroSecondDelay (ESPI_FLASH_POLL_US);
+    }
+  }
+
+  Candidate = &PrivateData->Cache[Victim];
+  Candidate->Valid = FALSE;
+  if (Fill) {
+    Status = EspiFlashWaitIdle ();
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (EspiRead (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, Adr, Candidate->Data, SectorSize)) {
+      return EFI_DEVICE_ERROR;
+    }
+  }
+
+  Candidate->Valid   = TRUE;
+  Candidate->Dirty   = FALSE;
+  Candidate->Failed  = FALSE;
+  Candidate->Adr     = Adr;
+  Candidate->LastUse = EspiFlashTime ();
+  *Line = Candidate;
   return EFI_SUCCESS;
 }
 
+STATIC
 EFI_STATUS
-EFIAPI
-EspiFlashBlockIoReadBlocks (
-  IN  EFI_BLOCK_IO_PROTOCOL  *This,
-  IN  UINT32                  MediaId,
-  IN  EFI_LBA                 Lba,
-  IN  UINTN                   BufferSize,
-  OUT VOID                   *Buffer
+EspiFlashCheckRequest (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN UINT32                    MediaId,
+  IN EFI_LBA                   Lba,
+  IN UINTN                     BufferSize,
+  IN VOID                     *Buffer
   )
 {
-  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
-  UINTN                     NumberOfBlocks;
-  UINTN                     FlashOffset;
+  UINTN  NumberOfBlocks;
 
   if (Buffer == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -105,8 +584,6 @@ EspiFlashBlockIoReadBlocks (
     return EFI_BAD_BUFFER_SIZE;
   }
 
-  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO (This);
-
   if (MediaId != PrivateData->Media.MediaId) {
     return EFI_MEDIA_CHANGED;
   }
@@ -124,11 +601,152 @@ EspiFlashBlockIoReadBlocks (
     return EFI_INVALID_PARAMETER;
   }
 
-  FlashOffset = Lba * FAT_BLOCK_SIZE;
-  EspiRead (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, FlashOffset, Buffer, BufferSize);
   return EFI_SUCCESS;
 }
 
+STATIC
+EFI_STATUS
+EspiFlashRead (
+  IN  ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN  EFI_LBA                   Lba,
+  IN  UINTN                     BufferSize,
+  OUT VOID                     *Buffer
+  )
+{
+  UINT8       *Data = Buffer;
+  UINTN       FlashOffset;
+  UINTN       Adr;
+  UINTN       Offset;
+  UINTN       Part;
+  INTN        Index;
+  EFI_STATUS  Status;
+  EFI_TPL     OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Status = EFI_SUCCESS;
+
+  FlashOffset = Lba * FAT_BLOCK_SIZE;
+  while (BufferSize) {
+    Adr    = (FlashOffset / SectorSize) * SectorSize;
+    Offset = FlashOffset - Adr;
+    Part   = MIN (BufferSize, SectorSize - Offset);
+
+    Index = EspiFlashLineLookup (PrivateData, Adr);
+    if (Index >= 0) {
+      CopyMem (Data, PrivateData->Cache[Index].Data + Offset, Part);
+    } else {
+      Status = EspiFlashWaitIdle ();
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+
+      if (EspiRead (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, FlashOffset, Data, Part)) {
+        Status = EFI_DEVICE_ERROR;
+        break;
+      }
+    }
+
+    FlashOffset += Part;
+    Data        += Part;
+    BufferSize  -= Part;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+STATIC
+EFI_STATUS
+EspiFlashWrite (
+  IN ESPI_FLASH_PRIVATE_DATA  *PrivateData,
+  IN EFI_LBA                   Lba,
+  IN UINTN                     BufferSize,
+  IN VOID                     *Buffer
+  )
+{
+  ESPI_FLASH_CACHE_LINE  *Line;
+  UINT8                  *Data = Buffer;
+  UINTN                  FlashOffset;
+  UINTN                  Adr;
+  UINTN                  Offset;
+  UINTN                  Part;
+  EFI_STATUS             Status;
+  EFI_TPL                OldTpl;
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Status = EFI_SUCCESS;
+
+  FlashOffset = Lba * FAT_BLOCK_SIZE;
+  while (BufferSize) {
+    Adr    = (FlashOffset / SectorSize) * SectorSize;
+    Offset = FlashOffset - Adr;
+    Part   = MIN (BufferSize, SectorSize - Offset);
+
+    Status = EspiFlashLineGet (PrivateData, Adr, Part != SectorSize, &Line);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+
+    CopyMem (Line->Data + Offset, Data, Part);
+    Line->Dirty     = TRUE;
+    Line->Failed    = FALSE;
+    Line->DirtyTime = EspiFlashTime ();
+    ++Line->Generation;
+
+    FlashOffset += Part;
+    Data        += Part;
+    BufferSize  -= Part;
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+//
+// EFI_BLOCK_IO_PROTOCOL
+//
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIoReset (
+  IN EFI_BLOCK_IO_PROTOCOL  *This,
+  IN BOOLEAN                ExtendedVerification
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+  EFI_STATUS               Status;
+  EFI_TPL                  OldTpl;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Status = EspiFlashFlush (PrivateData);
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIoReadBlocks (
+  IN  EFI_BLOCK_IO_PROTOCOL  *This,
+  IN  UINT32                  MediaId,
+  IN  EFI_LBA                 Lba,
+  IN  UINTN                   BufferSize,
+  OUT VOID                   *Buffer
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+  EFI_STATUS               Status;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO (This);
+
+  Status = EspiFlashCheckRequest (PrivateData, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  return EspiFlashRead (PrivateData, Lba, BufferSize, Buffer);
+}
+
 EFI_STATUS
 EFIAPI
 EspiFlashBlockIoWriteBlocks (
@@ -140,77 +758,166 @@ EspiFlashBlockIoWriteBlocks (
   )
 {
   ESPI_FLASH_PRIVATE_DATA  *PrivateData;
-  UINTN                    NumberOfBlocks;
-  UINTN                    FlashOffset;
-  UINTN                    Adr;
-  UINTN                    Offset;
-  UINTN                    TotalSize;
-  UINTN                    Cnt;
-  UINTN                    Size;
-  VOID                     *Buf;
-
-  if (Buffer == NULL) {
-    return EFI_INVALID_PARAMETER;
-  }
-
-  if (BufferSize == 0) {
-    return EFI_BAD_BUFFER_SIZE;
-  }
+  EFI_STATUS               Status;
 
   PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO (This);
 
-  if (MediaId != PrivateData->Media.MediaId) {
-    return EFI_MEDIA_CHANGED;
+  Status = EspiFlashCheckRequest (PrivateData, MediaId, Lba, BufferSize, Buffer);
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   if (TRUE == PrivateData->Media.ReadOnly) {
     return EFI_WRITE_PROTECTED;
   }
 
-  if ((BufferSize % PrivateData->Media.BlockSize) != 0) {
-    return EFI_BAD_BUFFER_SIZE;
-  }
+  return EspiFlashWrite (PrivateData, Lba, BufferSize, Buffer);
+}
 
-  if (Lba > PrivateData->Media.LastBlock) {
-    return EFI_INVALID_PARAMETER;
-  }
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIoFlushBlocks (
+  IN EFI_BLOCK_IO_PROTOCOL  *This
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+  EFI_STATUS               Status;
+  EFI_TPL                  OldTpl;
 
-  NumberOfBlocks = BufferSize / PrivateData->Media.BlockSize;
-  if ((Lba + NumberOfBlocks - 1) > PrivateData->Media.LastBlock) {
-    return EFI_INVALID_PARAMETER;
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Status = EspiFlashFlush (PrivateData);
+  gBS->RestoreTPL (OldTpl);
+  return Status;
+}
+
+//
+// EFI_BLOCK_IO2_PROTOCOL
+//
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIo2Reset (
+  IN EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN BOOLEAN                 ExtendedVerification
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO2 (This);
+  return EspiFlashBlockIoReset (&PrivateData->BlockIo, ExtendedVerification);
+}
+
+/**
+  Complete a request. Requests are served from the cache or the flash
+  before returning, so a non-blocking request is signaled immediately.
+**/
+STATIC
+EFI_STATUS
+EspiFlashComplete (
+  IN EFI_BLOCK_IO2_TOKEN  *Token,
+  IN EFI_STATUS           Status
+  )
+{
+  if (Token != NULL && Token->Event != NULL) {
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    Token->TransactionStatus = Status;
+    gBS->SignalEvent (Token->Event);
+    return EFI_SUCCESS;
   }
 
-  FlashOffset = Lba * FAT_BLOCK_SIZE;
-  Adr = (FlashOffset / SectorSize) * SectorSize;
-  Offset = FlashOffset - Adr;
-  TotalSize = Offset + BufferSize;
-  Cnt = DIVIDE_ROUND_UP (TotalSize, SectorSize);
-  Size = Cnt * SectorSize;
-
-  Buf = AllocatePool (Size);
-  if (Buf == NULL) {
-    return EFI_OUT_OF_RESOURCES;
+  return Status;
+}
+
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIo2ReadBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  OUT    VOID                    *Buffer
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+  EFI_STATUS               Status;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO2 (This);
+
+  Status = EspiFlashCheckRequest (PrivateData, MediaId, Lba, BufferSize, Buffer);
+  if (!EFI_ERROR (Status)) {
+    Status = EspiFlashRead (PrivateData, Lba, BufferSize, Buffer);
   }
 
-  EspiRead (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, Adr, Buf, Size);
-  CopyMem (Buf + Offset, Buffer, BufferSize);
-  EspiErase (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, Adr, Size);
-  EspiWrite (BM1000_ESPI_BASE, ESPI_FLASH_GPIO_CS, Adr, Buf, Size);
+  return EspiFlashComplete (Token, Status);
+}
 
-  if (Buf != NULL) {
-    FreePool (Buf);
+EFI_STATUS
+EFIAPI
+EspiFlashBlockIo2WriteBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN     UINT32                  MediaId,
+  IN     EFI_LBA                 Lba,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token,
+  IN     UINTN                   BufferSize,
+  IN     VOID                    *Buffer
+  )
+{
+  ESPI_FLASH_PRIVATE_DATA  *PrivateData;
+  EFI_STATUS               Status;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO2 (This);
+
+  Status = EspiFlashCheckRequest (PrivateData, MediaId, Lba, BufferSize, Buffer);
+  if (!EFI_ERROR (Status)) {
+    if (TRUE == PrivateData->Media.ReadOnly) {
+      Status = EFI_WRITE_PROTECTED;
+    } else {
+      Status = EspiFlashWrite (PrivateData, Lba, BufferSize, Buffer);
+    }
   }
 
-  return EFI_SUCCESS;
+  return EspiFlashComplete (Token, Status);
 }
 
 EFI_STATUS
 EFIAPI
-EspiFlashBlockIoFlushBlocks (
-  IN EFI_BLOCK_IO_PROTOCOL  *This
+EspiFlashBlockIo2FlushBlocksEx (
+  IN     EFI_BLOCK_IO2_PROTOCOL  *This,
+  IN OUT EFI_BLOCK_IO2_TOKEN     *Token
   )
 {
-  return EFI_SUCCESS;
+  ESPI_FLASH_PRIVATE_DATA   *PrivateData;
+  ESPI_FLASH_FLUSH_REQUEST  *Request;
+  EFI_STATUS                Status;
+  EFI_TPL                   OldTpl;
+
+  PrivateData = ESPI_FLASH_PRIVATE_FROM_BLKIO2 (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  if (Token != NULL && Token->Event != NULL) {
+    //
+    // Completed by the timer handler once every dirty sector is written back
+    //
+    Request = AllocatePool (sizeof (ESPI_FLASH_FLUSH_REQUEST));
+    if (Request == NULL) {
+      Status = EFI_OUT_OF_RESOURCES;
+    } else {
+      Request->Token = Token;
+      InsertTailList (&PrivateData->FlushRequests, &Request->Link);
+      EspiFlashRetryFailed (PrivateData);
+      Status = EFI_SUCCESS;
+    }
+  } else {
+    Status = EspiFlashFlush (PrivateData);
+  }
+
+  gBS->RestoreTPL (OldTpl);
+  return Status;
 }
 
 EFI_BLOCK_IO_PROTOCOL  mEspiFlashBlockIoProtocol = {
@@ -222,6 +929,14 @@ EFI_BLOCK_IO_PROTOCOL  mEspiFlashBlockIoProtocol = {
   EspiFlashBlockIoFlushBlocks
 };
 
+EFI_BLOCK_IO2_PROTOCOL  mEspiFlashBlockIo2Protocol = {
+  (EFI_BLOCK_IO_MEDIA *) 0,
+  EspiFlashBlockIo2Reset,
+  EspiFlashBlockIo2ReadBlocksEx,
+  EspiFlashBlockIo2WriteBlocksEx,
+  EspiFlashBlockIo2FlushBlocksEx
+};
+
 EFI_STATUS
 EFIAPI
 EspiFlashInstallBlock (
@@ -230,11 +945,15 @@ EspiFlashInstallBlock (
 {
   ESPI_FLASH_PRIVATE_DATA  *PrivateData = &mEspiFlash;
   EFI_BLOCK_IO_PROTOCOL    *BlockIo;
+  EFI_BLOCK_IO2_PROTOCOL   *BlockIo2;
   EFI_BLOCK_IO_MEDIA       *Media;
   EFI_STATUS               Status;
+  UINTN                    Index;
+  UINT8                    *CacheData;
 
-  BlockIo = &PrivateData->BlockIo;
-  Media   = &PrivateData->Media;
+  BlockIo  = &PrivateData->BlockIo;
+  BlockIo2 = &PrivateData->BlockIo2;
+  Media    = &PrivateData->Media;
 
   PrivateData->Size = SectorSize * SectorCount;
   PrivateData->Signature = ESPI_FLASH_PRIVATE_DATA_SIGNATURE;
@@ -242,28 +961,66 @@ EspiFlashInstallBlock (
     return EFI_NO_MEDIA;
   }
 
+  CacheData = AllocatePool (ESPI_FLASH_CACHE_LINES * SectorSize);
+  if (CacheData == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < ESPI_FLASH_CACHE_LINES; ++Index) {
+    PrivateData->Cache[Index].Data = CacheData + Index * SectorSize;
+  }
+
+  PrivateData->WriteBackStatus = EFI_SUCCESS;
+  InitializeListHead (&PrivateData->FlushRequests);
+
   CopyMem (BlockIo, &mEspiFlashBlockIoProtocol, sizeof (EFI_BLOCK_IO_PROTOCOL));
+  CopyMem (BlockIo2, &mEspiFlashBlockIo2Protocol, sizeof (EFI_BLOCK_IO2_PROTOCOL));
 
   BlockIo->Media          = Media;
+  BlockIo2->Media         = Media;
   Media->RemovableMedia   = FALSE;
   Media->MediaPresent     = TRUE;
   Media->LogicalPartition = FALSE;
   Media->ReadOnly         = FALSE;
-  Media->WriteCaching     = FALSE;
+  Media->WriteCaching     = TRUE;
   Media->BlockSize        = FAT_BLOCK_SIZE;
   Media->LastBlock        = DivU64x32 (PrivateData->Size + FAT_BLOCK_SIZE - 1, FAT_BLOCK_SIZE) - 1;
   PrivateData->DevicePath = mEspiFlashBlockIoDevicePath;
 
   if (Media->LastBlock < 1) {
+    FreePool (CacheData);
     return EFI_NO_MEDIA;
   }
 
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  EspiFlashTimerHandler,
+                  PrivateData,
+                  &PrivateData->TimerEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->SetTimer (PrivateData->TimerEvent, TimerPeriodic, ESPI_FLASH_TIMER_PERIOD);
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->CreateEvent (
+                  EVT_SIGNAL_EXIT_BOOT_SERVICES,
+                  TPL_CALLBACK,
+                  EspiFlashExitBootServices,
+                  PrivateData,
+                  &PrivateData->ExitBootServicesEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mEspiFlashBlockIoHandle,
                   &gEfiDevicePathProtocolGuid,
                   &mEspiFlash.DevicePath,
                   &gEfiBlockIoProtocolGuid,
                   &mEspiFlash.BlockIo,
+                  &gEfiBlockIo2ProtocolGuid,
+                  &mEspiFlash.BlockIo2,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -8,12 +8,15 @@
 **/
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/HobLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <libfdt.h>
 
+#include <Guid/EventGroup.h>
 #include <Guid/Fdt.h>
 #include <Guid/FdtHob.h>
 #include <Guid/PlatformHasDeviceTree.h>
@@ -22,6 +25,721 @@
 
 STATIC VOID  *mDeviceTreeBase;
 
+//
+// Tree index: every string found in a 'compatible' property maps to the
+// sorted list of offsets of the nodes that carry it, and every phandle maps
+// to its node. The index is built once at start-up and kept in sync with the
+// tree: property updates only shift the offsets of the nodes that follow, so
+// these are patched in place, while adding or deleting nodes and changing a
+// 'compatible' or 'phandle' property invalidate the index, which is rebuilt
+// on the next lookup.
+//
+#define FDT_COMPAT_BUCKETS     256
+#define FDT_REG_CACHE_BUCKETS  64
+#define FDT_INDEX_NONE         MAX_UINT32
+
+typedef struct {
+  UINT32  Hash;
+  UINT32  Next;       // Next key in the same bucket
+  CHAR8   *Name;
+  INT32   *Nodes;     // Ascending node offsets
+  UINT32  NodeCount;
+  UINT32  NodeMax;
+} FDT_COMPAT_KEY;
+
+typedef struct {
+  UINT32  Phandle;
+  INT32   Node;
+} FDT_PHANDLE_ENTRY;
+
+//
+// Decoded 'reg' properties. Unlike the index the cache is simply dropped
+// whenever the tree changes.
+//
+typedef struct {
+  INT32           Node;
+  UINT32          Next;   // Next entry in the same bucket
+  UINT32          Count;
+  FDT_CLIENT_REG  *Regs;
+} FDT_REG_CACHE;
+
+STATIC FDT_COMPAT_KEY     *mCompatKeys;
+STATIC UINT32             mCompatKeyCount;
+STATIC UINT32             mCompatKeyMax;
+STATIC UINT32             mCompatBuckets[FDT_COMPAT_BUCKETS];
+STATIC FDT_PHANDLE_ENTRY  *mPhandles;
+STATIC UINT32             mPhandleCount;
+STATIC UINT32             mPhandleMax;
+STATIC BOOLEAN            mFdtIndexValid;
+
+STATIC FDT_REG_CACHE      *mRegCache;
+STATIC UINT32             mRegCacheCount;
+STATIC UINT32             mRegCacheMax;
+STATIC UINT32             mRegCacheBuckets[FDT_REG_CACHE_BUCKETS];
+
+STATIC
+UINT32
+CompatHash (
+  IN  CONST CHAR8  *String
+  )
+{
+  UINT32  Hash = 0x811C9DC5;
+
+  // FNV-1a
+  while (*String != '\0') {
+    Hash ^= (UINT8)*String++;
+    Hash *= 0x01000193;
+  }
+
+  return Hash;
+}
+
+STATIC
+VOID
+FdtRegCacheFlush (
+  VOID
+  )
+{
+  UINT32  Idx;
+
+  for (Idx = 0; Idx < mRegCacheCount; ++Idx) {
+    FreePool (mRegCache[Idx].Regs);
+  }
+
+  mRegCacheCount = 0;
+  SetMem32 (mRegCacheBuckets, sizeof (mRegCacheBuckets), FDT_INDEX_NONE);
+}
+
+STATIC
+VOID
+FdtIndexFree (
+  VOID
+  )
+{
+  UINT32  Idx;
+
+  for (Idx = 0; Idx < mCompatKeyCount; ++Idx) {
+    FreePool (mCompatKeys[Idx].Name);
+    if (mCompatKeys[Idx].Nodes != NULL) {
+      FreePool (mCompatKeys[Idx].Nodes);
+    }
+  }
+
+  mCompatKeyCount = 0;
+  mPhandleCount   = 0;
+  mFdtIndexValid  = FALSE;
+  SetMem32 (mCompatBuckets, sizeof (mCompatBuckets), FDT_INDEX_NONE);
+}
+
+STATIC
+FDT_COMPAT_KEY *
+CompatIndexLookup (
+  IN  CONST CHAR8  *String,
+  IN  UINT32        Hash
+  )
+{
+  UINT32  Idx;
+
+  for (Idx = mCompatBuckets[Hash % FDT_COMPAT_BUCKETS];
+       Idx != FDT_INDEX_NONE;
+       Idx = mCompatKeys[Idx].Next) {
+    if (mCompatKeys[Idx].Hash == Hash &&
+        AsciiStrCmp (mCompatKeys[Idx].Name, String) == 0) {
+      return &mCompatKeys[Idx];
+    }
+  }
+
+  return NULL;
+}
+
+STATIC
+EFI_STATUS
+CompatIndexAdd (
+  IN  CONST CHAR8  *String,
+  IN  INT32         Node
+  )
+{
+  UINT32          Hash;
+  FDT_COMPAT_KEY  *Key;
+  VOID            *New;
+
+  Hash = CompatHash (String);
+  Key  = CompatIndexLookup (String, Hash);
+  if (Key == NULL) {
+    if (mCompatKeyCount == mCompatKeyMax) {
+      New = ReallocatePool (
+              mCompatKeyMax * sizeof (FDT_COMPAT_KEY),
+              (mCompatKeyMax + 64) * sizeof (FDT_COMPAT_KEY),
+              mCompatKeys
+              );
+      if (New == NULL) {
+        return EFI_OUT_OF_RESOURCES;
+      }
+
+      mCompatKeys    = New;
+      mCompatKeyMax += 64;
+    }
+
+    Key = &mCompatKeys[mCompatKeyCount];
+    Key->Name = AllocateCopyPool (AsciiStrSize (String), String);
+    if (Key->Name == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Key->Hash      = Hash;
+    Key->Nodes     = NULL;
+    Key->NodeCount = 0;
+    Key->NodeMax   = 0;
+    Key->Next      = mCompatBuckets[Hash % FDT_COMPAT_BUCKETS];
+    mCompatBuckets[Hash % FDT_COMPAT_BUCKETS] = mCompatKeyCount++;
+  }
+
+  //
+  // Nodes are added in tree order, a string listed twice by the same
+  // node is only recorded once
+  //
+  if (Key->NodeCount > 0 && Key->Nodes[Key->NodeCount - 1] == Node) {
+    return EFI_SUCCESS;
+  }
+
+  if (Key->NodeCount == Key->NodeMax) {
+    New = ReallocatePool (
+            Key->NodeMax * sizeof (INT32),
+            (Key->NodeMax ? Key->NodeMax * 2 : 4) * sizeof (INT32),
+            Key->Nodes
+            );
+    if (New == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    Key->Nodes   = New;
+    Key->NodeMax = Key->NodeMax ? Key->NodeMax * 2 : 4;
+  }
+
+  Key->Nodes[Key->NodeCount++] = Node;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+PhandleIndexAdd (
+  IN  UINT32  Phandle,
+  IN  INT32   Node
+  )
+{
+  UINT32  Idx;
+  VOID    *New;
+
+  if (mPhandleCount == mPhandleMax) {
+    New = ReallocatePool (
+            mPhandleMax * sizeof (FDT_PHANDLE_ENTRY),
+            (mPhandleMax + 64) * sizeof (FDT_PHANDLE_ENTRY),
+            mPhandles
+            );
+    if (New == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mPhandles    = New;
+    mPhandleMax += 64;
+  }
+
+  //
+  // Keep the table sorted by phandle. dtc numbers phandles in tree order,
+  // so this is normally a plain append.
+  //
+  for (Idx = mPhandleCount; Idx > 0 && mPhandles[Idx - 1].Phandle > Phandle; --Idx) {
+    mPhandles[Idx] = mPhandles[Idx - 1];
+  }
+
+  mPhandles[Idx].Phandle = Phandle;
+  mPhandles[Idx].Node    = Node;
+  ++mPhandleCount;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+FdtIndexBuild (
+  VOID
+  )
+{
+  INT32        Node;
+  CONST CHAR8  *Type, *Compatible;
+  INT32        Len;
+  UINT32       Phandle;
+  EFI_STATUS   Status = EFI_SUCCESS;
+
+  FdtIndexFree ();
+
+  for (Node = fdt_next_node (mDeviceTreeBase, 0, NULL);
+       Node >= 0 && !EFI_ERROR (Status);
+       Node = fdt_next_node (mDeviceTreeBase, Node, NULL)) {
+    Phandle = fdt_get_phandle (mDeviceTreeBase, Node);
+    if (Phandle != 0) {
+      Status = PhandleIndexAdd (Phandle, Node);
+    }
+
+    Type = fdt_getprop (mDeviceTreeBase, Node, "compatible", &Len);
+    if (Type == NULL) {
+      continue;
+    }
+
+    for (Compatible = Type; Compatible < Type + Len && *Compatible && !EFI_ERROR (Status);
+         Compatible += 1 + AsciiStrLen (Compatible)) {
+      Status = CompatIndexAdd (Compatible, Node);
+    }
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: %r, falling back to tree walks\n", __func__, Status));
+    FdtIndexFree ();
+    return Status;
+  }
+
+  mFdtIndexValid = TRUE;
+  return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+FdtIndexInvalidate (
+  VOID
+  )
+{
+  mFdtIndexValid = FALSE;
+  FdtRegCacheFlush ();
+}
+
+//
+// A property of Node has changed its size by Delta bytes: the nodes that
+// follow it in the structure block have moved by the same amount
+//
+STATIC
+VOID
+FdtIndexShift (
+  IN  INT32  Node,
+  IN  INT32  Delta
+  )
+{
+  UINT32  KeyIdx;
+  UINT32  Idx;
+
+  if (!mFdtIndexValid || Delta == 0) {
+    return;
+  }
+
+  for (KeyIdx = 0; KeyIdx < mCompatKeyCount; ++KeyIdx) {
+    for (Idx = 0; Idx < mCompatKeys[KeyIdx].NodeCount; ++Idx) {
+      if (mCompatKeys[KeyIdx].Nodes[Idx] > Node) {
+        mCompatKeys[KeyIdx].Nodes[Idx] += Delta;
+      }
+    }
+  }
+
+  for (Idx = 0; Idx < mPhandleCount; ++Idx) {
+    if (mPhandles[Idx].Node > Node) {
+      mPhandles[Idx].Node += Delta;
+    }
+  }
+}
+
+STATIC
+VOID
+FdtIndexPropertyChanged (
+  IN  INT32         Node,
+  IN  CONST CHAR8  *PropertyName,
+  IN  UINT32        StructSize
+  )
+{
+  FdtRegCacheFlush ();
+
+  if (AsciiStrCmp (PropertyName, "compatible") == 0 ||
+      AsciiStrCmp (PropertyName, "phandle") == 0 ||
+      AsciiStrCmp (PropertyName, "linux,phandle") == 0) {
+    mFdtIndexValid = FALSE;
+  } else {
+    FdtIndexShift (Node, (INT32)(fdt_size_dt_struct (mDeviceTreeBase) - StructSize));
+  }
+}
+
+STATIC
+UINT32
+FdtGetCells (
+  IN  INT32         Node,
+  IN  CONST CHAR8  *Name,
+  IN  UINT32        Default
+  )
+{
+  CONST UINT32  *Prop;
+  INT32         Len;
+
+  Prop = fdt_getprop (mDeviceTreeBase, Node, Name, &Len);
+  if (Prop == NULL || Len != sizeof (UINT32)) {
+    return Default;
+  }
+
+  return SwapBytes32 (ReadUnaligned32 (Prop));
+}
+
+STATIC
+UINT64
+FdtReadCells (
+  IN  CONST UINT32  *Cells,
+  IN  UINT32         Count
+  )
+{
+  UINT64  Value = 0;
+
+  while (Count-- > 0) {
+    Value = LShiftU64 (Value, 32) | SwapBytes32 (ReadUnaligned32 (Cells++));
+  }
+
+  return Value;
+}
+
+//
+// The tree is kept in a buffer of its own with some free space at the end,
+// so that fixups do not run out of room, and packed again when it is handed
+// over to the OS. An outgrown buffer is freed once the tree has moved; like
+// any edit of the tree, this invalidates the property pointers callers got.
+//
+#define FDT_CLIENT_HEADROOM   SIZE_64KB
+
+STATIC UINTN    mDeviceTreeCapacity;
+STATIC BOOLEAN  mDeviceTreeInstalled;
+STATIC BOOLEAN  mDeviceTreeOwned;       // Buffer allocated here, not the HOB copy
+
+//
+// Edits queued between BeginUpdate and CommitUpdate. They refer to node
+// offsets of the tree as it was at BeginUpdate and are applied in place on
+// commit, from the last node to the first.
+//
+typedef enum {
+  FdtEditSetProperty,
+  FdtEditDeleteProperty,
+  FdtEditDeleteNode
+} FDT_EDIT_OP;
+
+typedef struct {
+  FDT_EDIT_OP  Op;
+  INT32        Node;
+  CHAR8        *Name;   // NULL for FdtEditDeleteNode
+  VOID         *Value;
+  UINT32       Size;
+} FDT_EDIT;
+
+STATIC FDT_EDIT  *mEdits;
+STATIC UINT32    mEditCount;
+STATIC UINT32    mEditMax;
+STATIC UINTN     mUpdateDepth;
+
+STATIC
+VOID
+FdtReplace (
+  IN  VOID   *DeviceTreeBase,
+  IN  UINTN   Capacity
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mDeviceTreeOwned) {
+    FreePages (mDeviceTreeBase, EFI_SIZE_TO_PAGES (mDeviceTreeCapacity));
+  }
+
+  mDeviceTreeBase     = DeviceTreeBase;
+  mDeviceTreeCapacity = Capacity;
+  mDeviceTreeOwned    = TRUE;
+
+  if (mDeviceTreeInstalled) {
+    Status = gBS->InstallConfigurationTable (&gFdtTableGuid, mDeviceTreeBase);
+    ASSERT_EFI_ERROR (Status);
+  }
+}
+
+//
+// Move the tree to a new buffer of at least Size bytes
+//
+STATIC
+EFI_STATUS
+FdtMoveTo (
+  IN  UINTN  Size
+  )
+{
+  UINTN  Pages;
+  VOID   *New;
+
+  Pages = EFI_SIZE_TO_PAGES (Size);
+  New   = AllocatePages (Pages);
+  if (New == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (fdt_open_into (mDeviceTreeBase, New, EFI_PAGES_TO_SIZE (Pages)) != 0) {
+    FreePages (New, Pages);
+    return EFI_DEVICE_ERROR;
+  }
+
+  FdtReplace (New, EFI_PAGES_TO_SIZE (Pages));
+  return EFI_SUCCESS;
+}
+
+//
+// Make room for an edit that has failed with -FDT_ERR_NOSPACE
+//
+STATIC
+EFI_STATUS
+FdtEnsureRoom (
+  IN  UINTN  Needed
+  )
+{
+  if (fdt_totalsize (mDeviceTreeBase) + Needed <= mDeviceTreeCapacity) {
+    //
+    // The tree has been packed, there is enough free space in the buffer
+    //
+    if (fdt_open_into (mDeviceTreeBase, mDeviceTreeBase, mDeviceTreeCapacity) != 0) {
+      return EFI_DEVICE_ERROR;
+    }
+
+    return EFI_SUCCESS;
+  }
+
+  return FdtMoveTo (MAX (2 * mDeviceTreeCapacity, mDeviceTreeCapacity + Needed + FDT_CLIENT_HEADROOM));
+}
+
+STATIC
+VOID
+FdtEditsFree (
+  VOID
+  )
+{
+  UINT32  Idx;
+
+  for (Idx = 0; Idx < mEditCount; ++Idx) {
+    if (mEdits[Idx].Name != NULL) {
+      FreePool (mEdits[Idx].Name);
+    }
+
+    if (mEdits[Idx].Value != NULL) {
+      FreePool (mEdits[Idx].Value);
+    }
+  }
+
+  mEditCount = 0;
+}
+
+STATIC
+FDT_EDIT *
+FdtEditFind (
+  IN  INT32         Node,
+  IN  CONST CHAR8  *Name OPTIONAL
+  )
+{
+  UINT32  Idx;
+
+  for (Idx = 0; Idx < mEditCount; ++Idx) {
+    if (mEdits[Idx].Node != Node) {
+      continue;
+    }
+
+    if (Name == NULL) {
+      if (mEdits[Idx].Op == FdtEditDeleteNode) {
+        return &mEdits[Idx];
+      }
+    } else if (mEdits[Idx].Name != NULL && AsciiStrCmp (mEdits[Idx].Name, Name) == 0) {
+      return &mEdits[Idx];
+    }
+  }
+
+  return NULL;
+}
+
+//
+// Drop the queued property edits of a node that is queued for deletion:
+// they would be applied to the node that takes its offset once it is gone
+//
+STATIC
+VOID
+FdtEditsDrop (
+  IN  INT32  Node
+  )
+{
+  UINT32  Idx;
+  UINT32  Kept;
+
+  for (Idx = 0, Kept = 0; Idx < mEditCount; ++Idx) {
+    if (mEdits[Idx].Node != Node) {
+      mEdits[Kept++] = mEdits[Idx];
+      continue;
+    }
+
+    if (mEdits[Idx].Name != NULL) {
+      FreePool (mEdits[Idx].Name);
+    }
+
+    if (mEdits[Idx].Value != NULL) {
+      FreePool (mEdits[Idx].Value);
+    }
+  }
+
+  mEditCount = Kept;
+}
+
+STATIC
+EFI_STATUS
+FdtEditQueue (
+  IN  FDT_EDIT_OP    Op,
+  IN  INT32          Node,
+  IN  CONST CHAR8   *Name OPTIONAL,
+  IN  CONST VOID    *Value OPTIONAL,
+  IN  UINT32         Size
+  )
+{
+  FDT_EDIT  *Edit;
+  VOID      *New;
+  VOID      *Copy = NULL;
+
+  // A node queued for deletion is already gone for the caller
+  if (FdtEditFind (Node, NULL) != NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  if (Op == FdtEditDeleteNode) {
+    FdtEditsDrop (Node);
+  }
+
+  if (Value != NULL && Size > 0) {
+    Copy = AllocateCopyPool (Size, Value);
+    if (Copy == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  //
+  // A later edit of the same property supersedes the earlier one
+  //
+  Edit = FdtEditFind (Node, Name);
+  if (Edit == NULL) {
+    if (mEditCount == mEditMax) {
+      New = ReallocatePool (
+              mEditMax * sizeof (FDT_EDIT),
+              (mEditMax + 16) * sizeof (FDT_EDIT),
+              mEdits
+              );
+      if (New == NULL) {
+        goto OutOfResources;
+      }
+
+      mEdits    = New;
+      mEditMax += 16;
+    }
+
+    Edit = &mEdits[mEditCount];
+    Edit->Name = NULL;
+    if (Name != NULL) {
+      Edit->Name = AllocateCopyPool (AsciiStrSize (Name), Name);
+      if (Edit->Name == NULL) {
+        goto OutOfResources;
+      }
+    }
+
+    ++mEditCount;
+  } else if (Edit->Value != NULL) {
+    FreePool (Edit->Value);
+  }
+
+  Edit->Op    = Op;
+  Edit->Node  = Node;
+  Edit->Value = Copy;
+  Edit->Size  = Size;
+  return EFI_SUCCESS;
+
+OutOfResources:
+  if (Copy != NULL) {
+    FreePool (Copy);
+  }
+
+  return EFI_OUT_OF_RESOURCES;
+}
+
+//
+// Apply the queued edits in place. Changing or deleting a node only moves
+// the part of the tree behind that node's own offset, so the edits are
+// applied from the last node to the first and the offsets they refer to
+// stay valid throughout.
+//
+STATIC
+EFI_STATUS
+FdtEditsApply (
+  VOID
+  )
+{
+  FDT_EDIT    Edit;
+  UINT32      Idx;
+  UINT32      Pos;
+  INT32       Ret;
+  EFI_STATUS  Status = EFI_SUCCESS;
+
+  if (mEditCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Sort by descending node offset. The order of the edits of one node
+  // does not matter, a later edit of the same property has replaced the
+  // earlier one when it was queued.
+  //
+  for (Idx = 1; Idx < mEditCount; ++Idx) {
+    Edit = mEdits[Idx];
+    for (Pos = Idx; Pos > 0 && mEdits[Pos - 1].Node < Edit.Node; --Pos) {
+      mEdits[Pos] = mEdits[Pos - 1];
+    }
+
+    mEdits[Pos] = Edit;
+  }
+
+  for (Idx = 0; Idx < mEditCount; ++Idx) {
+    switch (mEdits[Idx].Op) {
+    case FdtEditSetProperty:
+      Ret = fdt_setprop (mDeviceTreeBase, mEdits[Idx].Node, mEdits[Idx].Name, mEdits[Idx].Value, mEdits[Idx].Size);
+      if (Ret == -FDT_ERR_NOSPACE &&
+          !EFI_ERROR (FdtEnsureRoom (mEdits[Idx].Size + AsciiStrSize (mEdits[Idx].Name)))) {
+        Ret = fdt_setprop (mDeviceTreeBase, mEdits[Idx].Node, mEdits[Idx].Name, mEdits[Idx].Value, mEdits[Idx].Size);
+      }
+
+      break;
+
+    case FdtEditDeleteProperty:
+      Ret = fdt_delprop (mDeviceTreeBase, mEdits[Idx].Node, mEdits[Idx].Name);
+      if (Ret == -FDT_ERR_NOTFOUND) {
+        Ret = 0;
+      }
+
+      break;
+
+    default:
+      Ret = fdt_del_node (mDeviceTreeBase, mEdits[Idx].Node);
+      break;
+    }
+
+    if (Ret != 0) {
+      DEBUG ((
+        EFI_D_ERROR,
+        "%a: node 0x%x: unable to apply edit of %a: %a\n",
+        __func__,
+        mEdits[Idx].Node,
+        mEdits[Idx].Name != NULL ? mEdits[Idx].Name : "node",
+        fdt_strerror (Ret)
+        ));
+      Status = EFI_DEVICE_ERROR;
+    }
+  }
+
+  FdtEditsFree ();
+  FdtIndexInvalidate ();
+  return Status;
+}
+
 STATIC
 BOOLEAN
 EFIAPI
@@ -91,15 +809,27 @@ SetNodeProperty (
   IN  CONST UINT32             PropSize
   )
 {
-  INT32 Ret;
+  INT32  Ret;
+  UINT32 StructSize;
 
   ASSERT (mDeviceTreeBase != NULL);
 
+  if (mUpdateDepth > 0) {
+    return FdtEditQueue (FdtEditSetProperty, Node, PropertyName, Prop, PropSize);
+  }
+
+  StructSize = fdt_size_dt_struct (mDeviceTreeBase);
   Ret = fdt_setprop (mDeviceTreeBase, Node, PropertyName, Prop, PropSize);
+  if (Ret == -FDT_ERR_NOSPACE &&
+      !EFI_ERROR (FdtEnsureRoom (PropSize + AsciiStrSize (PropertyName)))) {
+    Ret = fdt_setprop (mDeviceTreeBase, Node, PropertyName, Prop, PropSize);
+  }
+
   if (Ret != 0) {
     return EFI_DEVICE_ERROR;
   }
 
+  FdtIndexPropertyChanged (Node, PropertyName, StructSize);
   return EFI_SUCCESS;
 }
 
@@ -113,13 +843,43 @@ FindNextCompatibleNode (
   OUT INT32                   *Node
   )
 {
-  INT32          Prev, Next;
-  CONST CHAR8    *Type, *Compatible;
-  INT32          Len;
+  INT32           Prev, Next;
+  CONST CHAR8     *Type, *Compatible;
+  INT32           Len;
+  FDT_COMPAT_KEY  *Key;
+  UINT32          Low, High, Mid;
 
   ASSERT (mDeviceTreeBase != NULL);
   ASSERT (Node != NULL);
 
+  if (mFdtIndexValid || !EFI_ERROR (FdtIndexBuild ())) {
+    Key = CompatIndexLookup (CompatibleString, CompatHash (CompatibleString));
+    if (Key == NULL) {
+      return EFI_NOT_FOUND;
+    }
+
+    //
+    // First node past PrevNode
+    //
+    Low  = 0;
+    High = Key->NodeCount;
+    while (Low < High) {
+      Mid = (Low + High) / 2;
+      if (Key->Nodes[Mid] <= PrevNode) {
+        Low = Mid + 1;
+      } else {
+        High = Mid;
+      }
+    }
+
+    if (Low == Key->NodeCount) {
+      return EFI_NOT_FOUND;
+    }
+
+    *Node = Key->Nodes[Low];
+    return EFI_SUCCESS;
+  }
+
   for (Prev = PrevNode;; Prev = Next) {
     Next = fdt_next_node (mDeviceTreeBase, Prev, NULL);
     if (Next < 0) {
@@ -179,11 +939,30 @@ FindNodeByPhandle (
   OUT INT32                   *Node
   )
 {
-  INTN  Offset;
+  INTN    Offset;
+  UINT32  Low, High, Mid;
 
   ASSERT (mDeviceTreeBase != NULL);
   ASSERT (Node != NULL);
 
+  if (mFdtIndexValid || !EFI_ERROR (FdtIndexBuild ())) {
+    Low  = 0;
+    High = mPhandleCount;
+    while (Low < High) {
+      Mid = (Low + High) / 2;
+      if (mPhandles[Mid].Phandle == Phandle) {
+        *Node = mPhandles[Mid].Node;
+        return EFI_SUCCESS;
+      } else if (mPhandles[Mid].Phandle < Phandle) {
+        Low = Mid + 1;
+      } else {
+        High = Mid;
+      }
+    }
+
+    return EFI_NOT_FOUND;
+  }
+
   Offset = fdt_node_offset_by_phandle(mDeviceTreeBase, Phandle);
   if (Offset >= 0) {
     *Node = Offset;
@@ -382,7 +1161,20 @@ GetOrInsertChosenNode (
 
   NewNode = fdt_path_offset (mDeviceTreeBase, "/chosen");
   if (NewNode < 0) {
+    //
+    // Adding a node cannot be queued, and adding it now would move the
+    // nodes the queued edits refer to
+    //
+    if (mUpdateDepth > 0) {
+      return EFI_NOT_READY;
+    }
+
     NewNode = fdt_add_subnode (mDeviceTreeBase, 0, "/chosen");
+    if (NewNode == -FDT_ERR_NOSPACE && !EFI_ERROR (FdtEnsureRoom (EFI_PAGE_SIZE))) {
+      NewNode = fdt_add_subnode (mDeviceTreeBase, 0, "/chosen");
+    }
+
+    FdtIndexInvalidate ();
   }
 
   if (NewNode < 0) {
@@ -429,7 +1221,12 @@ DeleteNode (
   ASSERT (mDeviceTreeBase != NULL);
   ASSERT (Node != 0);
 
+  if (mUpdateDepth > 0) {
+    return FdtEditQueue (FdtEditDeleteNode, Node, NULL, NULL, 0);
+  }
+
   fdt_del_node(mDeviceTreeBase, Node);
+  FdtIndexInvalidate ();
 
   return EFI_SUCCESS;
 }
@@ -443,14 +1240,303 @@ DeleteProperty (
   IN  CONST CHAR8             *Name
   )
 {
+  UINT32  StructSize;
+
   ASSERT (mDeviceTreeBase != NULL);
   ASSERT (Node != 0);
 
-  fdt_delprop(mDeviceTreeBase, Node, Name);
+  if (mUpdateDepth > 0) {
+    return FdtEditQueue (FdtEditDeleteProperty, Node, Name, NULL, 0);
+  }
+
+  StructSize = fdt_size_dt_struct (mDeviceTreeBase);
+  if (fdt_delprop(mDeviceTreeBase, Node, Name) == 0) {
+    FdtIndexPropertyChanged (Node, Name, StructSize);
+  }
 
   return EFI_SUCCESS;
 }
 
+STATIC
+EFI_STATUS
+EFIAPI
+GetNodeReg (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  OUT CONST FDT_CLIENT_REG    **Regs,
+  OUT UINT32                  *Count
+  )
+{
+  UINT32          Idx;
+  INT32           Parent;
+  UINT32          AddressCells;
+  UINT32          SizeCells;
+  CONST UINT32    *Prop;
+  INT32           Len;
+  FDT_CLIENT_REG  *Decoded;
+  VOID            *New;
+
+  ASSERT (mDeviceTreeBase != NULL);
+  ASSERT (Regs != NULL);
+  ASSERT (Count != NULL);
+
+  for (Idx = mRegCacheBuckets[(UINT32)Node % FDT_REG_CACHE_BUCKETS];
+       Idx != FDT_INDEX_NONE;
+       Idx = mRegCache[Idx].Next) {
+    if (mRegCache[Idx].Node == Node) {
+      *Regs  = mRegCache[Idx].Regs;
+      *Count = mRegCache[Idx].Count;
+      return EFI_SUCCESS;
+    }
+  }
+
+  Prop = fdt_getprop (mDeviceTreeBase, Node, "reg", &Len);
+  Parent = fdt_parent_offset (mDeviceTreeBase, Node);
+  if (Prop == NULL || Len <= 0 || Parent < 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Defaults as per the Devicetree Specification
+  //
+  AddressCells = FdtGetCells (Parent, "#address-cells", 2);
+  SizeCells    = FdtGetCells (Parent, "#size-cells", 1);
+  if (AddressCells == 0 || AddressCells > 2 || SizeCells > 2 ||
+      (Len % ((AddressCells + SizeCells) * sizeof (UINT32))) != 0) {
+    DEBUG ((EFI_D_ERROR, "%a: node 0x%x has unsupported 'reg' layout\n", __func__, Node));
+    return EFI_UNSUPPORTED;
+  }
+
+  if (mRegCacheCount == mRegCacheMax) {
+    New = ReallocatePool (
+            mRegCacheMax * sizeof (FDT_REG_CACHE),
+            (mRegCacheMax + 32) * sizeof (FDT_REG_CACHE),
+            mRegCache
+            );
+    if (New == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    mRegCache     = New;
+    mRegCacheMax += 32;
+  }
+
+  *Count  = Len / ((AddressCells + SizeCells) * sizeof (UINT32));
+  Decoded = AllocatePool (*Count * sizeof (FDT_CLIENT_REG));
+  if (Decoded == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  for (Idx = 0; Idx < *Count; ++Idx) {
+    Decoded[Idx].Address = FdtReadCells (Prop, AddressCells);
+    Prop += AddressCells;
+    Decoded[Idx].Size = FdtReadCells (Prop, SizeCells);
+    Prop += SizeCells;
+  }
+
+  mRegCache[mRegCacheCount].Node  = Node;
+  mRegCache[mRegCacheCount].Count = *Count;
+  mRegCache[mRegCacheCount].Regs  = Decoded;
+  mRegCache[mRegCacheCount].Next  = mRegCacheBuckets[(UINT32)Node % FDT_REG_CACHE_BUCKETS];
+  mRegCacheBuckets[(UINT32)Node % FDT_REG_CACHE_BUCKETS] = mRegCacheCount++;
+
+  *Regs = Decoded;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+GetNodeRegByName (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST CHAR8             *RegName,
+  OUT CONST FDT_CLIENT_REG    **Reg
+  )
+{
+  CONST CHAR8           *Names, *Name;
+  INT32                 Len;
+  UINT32                RegIdx;
+  CONST FDT_CLIENT_REG  *Regs;
+  UINT32                Count;
+  EFI_STATUS            Status;
+
+  ASSERT (mDeviceTreeBase != NULL);
+  ASSERT (Reg != NULL);
+
+  Names = fdt_getprop (mDeviceTreeBase, Node, "reg-names", &Len);
+  if (Names == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  for (Name = Names, RegIdx = 0; Name < Names + Len && *Name;
+       Name += 1 + AsciiStrLen (Name), ++RegIdx) {
+    if (AsciiStrCmp (Name, RegName) == 0) {
+      Status = GetNodeReg (This, Node, &Regs, &Count);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      if (RegIdx >= Count) {
+        return EFI_NOT_FOUND;
+      }
+
+      *Reg = &Regs[RegIdx];
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+GetNodeClockRate (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST UINT32             Index,
+  OUT UINT64                  *Rate
+  )
+{
+  CONST UINT32  *Prop, *End;
+  INT32         Len;
+  UINT32        ClkIdx;
+  INT32         ClkNode;
+  EFI_STATUS    Status;
+
+  ASSERT (mDeviceTreeBase != NULL);
+  ASSERT (Rate != NULL);
+
+  Prop = fdt_getprop (mDeviceTreeBase, Node, "clocks", &Len);
+  if (Prop == NULL || Len <= 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Each entry is a provider phandle followed by #clock-cells of the
+  // provider. Only fixed rate providers can be resolved here.
+  //
+  End = Prop + Len / sizeof (UINT32);
+  for (ClkIdx = 0; Prop < End; ++ClkIdx) {
+    Status = FindNodeByPhandle (This, SwapBytes32 (ReadUnaligned32 (Prop)), &ClkNode);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+
+    if (ClkIdx == Index) {
+      Prop = fdt_getprop (mDeviceTreeBase, ClkNode, "clock-frequency", &Len);
+      if (Prop == NULL || (Len != sizeof (UINT32) && Len != sizeof (UINT64))) {
+        return EFI_UNSUPPORTED;
+      }
+
+      *Rate = FdtReadCells (Prop, Len / sizeof (UINT32));
+      return EFI_SUCCESS;
+    }
+
+    Prop += 1 + FdtGetCells (ClkNode, "#clock-cells", 0);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+GetNodeInterrupt (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST UINT32             Index,
+  OUT FDT_CLIENT_INTERRUPT    *Interrupt
+  )
+{
+  CONST UINT32  *Prop;
+  INT32         Len;
+  INT32         Parent;
+  INT32         Controller = -1;
+  UINT32        Cells;
+  UINT32        Idx;
+  EFI_STATUS    Status;
+
+  ASSERT (mDeviceTreeBase != NULL);
+  ASSERT (Interrupt != NULL);
+
+  Prop = fdt_getprop (mDeviceTreeBase, Node, "interrupts", &Len);
+  if (Prop == NULL || Len <= 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // 'interrupt-parent' is inherited from the closest ancestor that has it
+  //
+  for (Parent = Node; Parent >= 0; Parent = fdt_parent_offset (mDeviceTreeBase, Parent)) {
+    Cells = FdtGetCells (Parent, "interrupt-parent", 0);
+    if (Cells != 0) {
+      Status = FindNodeByPhandle (This, Cells, &Controller);
+      if (EFI_ERROR (Status)) {
+        return Status;
+      }
+
+      break;
+    }
+  }
+
+  if (Controller < 0) {
+    return EFI_NOT_FOUND;
+  }
+
+  Cells = FdtGetCells (Controller, "#interrupt-cells", 0);
+  if (Cells == 0 || Cells > ARRAY_SIZE (Interrupt->Cells)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if ((Index + 1) * Cells * sizeof (UINT32) > (UINT32)Len) {
+    return EFI_NOT_FOUND;
+  }
+
+  Prop += Index * Cells;
+  Interrupt->Controller = Controller;
+  Interrupt->CellCount  = Cells;
+  for (Idx = 0; Idx < Cells; ++Idx) {
+    Interrupt->Cells[Idx] = SwapBytes32 (ReadUnaligned32 (Prop + Idx));
+  }
+
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+BeginUpdate (
+  IN  FDT_CLIENT_PROTOCOL     *This
+  )
+{
+  ASSERT (mDeviceTreeBase != NULL);
+
+  ++mUpdateDepth;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+CommitUpdate (
+  IN  FDT_CLIENT_PROTOCOL     *This
+  )
+{
+  ASSERT (mDeviceTreeBase != NULL);
+
+  if (mUpdateDepth == 0) {
+    return EFI_NOT_READY;
+  }
+
+  if (--mUpdateDepth > 0) {
+    return EFI_SUCCESS;
+  }
+
+  return FdtEditsApply ();
+}
+
 STATIC FDT_CLIENT_PROTOCOL mFdtClientProtocol = {
   IsNodeEnabled,
   GetNodeProperty,
@@ -467,9 +1553,32 @@ STATIC FDT_CLIENT_PROTOCOL mFdtClientProtocol = {
   GetOrInsertChosenNode,
   FindNodeByAlias,
   DeleteNode,
-  DeleteProperty
+  DeleteProperty,
+  GetNodeReg,
+  GetNodeRegByName,
+  GetNodeClockRate,
+  GetNodeInterrupt,
+  BeginUpdate,
+  CommitUpdate
 };
 
+//
+// Drop the headroom before the tree is handed over to the OS. Edits made
+// after this, e.g. by other ReadyToBoot handlers, reopen the tree in place.
+//
+STATIC
+VOID
+EFIAPI
+OnFdtPack (
+  IN EFI_EVENT Event,
+  IN VOID      *Context
+  )
+{
+  if (fdt_pack (mDeviceTreeBase) == 0) {
+    DEBUG ((EFI_D_INFO, "%a: DTB packed to 0x%x bytes\n", __func__, fdt_totalsize (mDeviceTreeBase)));
+  }
+}
+
 STATIC
 VOID
 EFIAPI
@@ -492,7 +1601,7 @@ OnPlatformHasDeviceTree (
     return;
   }
 
-  DeviceTreeBase = Context;
+  DeviceTreeBase = mDeviceTreeBase;
   DEBUG ((
     DEBUG_INFO,
     "%a: exposing DTB @ 0x%p to OS\n",
@@ -501,6 +1610,7 @@ OnPlatformHasDeviceTree (
     ));
   Status = gBS->InstallConfigurationTable (&gFdtTableGuid, DeviceTreeBase);
   ASSERT_EFI_ERROR (Status);
+  mDeviceTreeInstalled = TRUE;
 
   gBS->CloseEvent (Event);
 }
@@ -516,6 +1626,7 @@ InitializeFdtClientDxe (
   VOID              *DeviceTreeBase;
   EFI_STATUS        Status;
   EFI_EVENT         PlatformHasDeviceTreeEvent;
+  EFI_EVENT         PackEvent;
   VOID              *Registration;
 
   Hob = GetFirstGuidHob (&gFdtHobGuid);
@@ -530,10 +1641,18 @@ InitializeFdtClientDxe (
     return EFI_NOT_FOUND;
   }
 
-  mDeviceTreeBase = DeviceTreeBase;
+  mDeviceTreeBase     = DeviceTreeBase;
+  mDeviceTreeCapacity = fdt_totalsize (DeviceTreeBase);
+
+  if (EFI_ERROR (FdtMoveTo (fdt_totalsize (DeviceTreeBase) + FDT_CLIENT_HEADROOM))) {
+    DEBUG ((EFI_D_WARN, "%a: unable to expand DTB, fixups are done in place\n", __func__));
+  }
 
   DEBUG ((EFI_D_INFO, "%a: DTB @ 0x%p\n", __func__, mDeviceTreeBase));
 
+  FdtRegCacheFlush ();
+  FdtIndexBuild ();
+
   Status = gBS->InstallProtocolInterface (
                   &ImageHandle,
                   &gEdkiiPlatformHasDeviceTreeGuid,
@@ -553,7 +1672,7 @@ InitializeFdtClientDxe (
                   EVT_NOTIFY_SIGNAL,
                   TPL_CALLBACK,
                   OnPlatformHasDeviceTree,
-                  DeviceTreeBase,             // Context
+                  NULL,                       // Context
                   &PlatformHasDeviceTreeEvent
                   );
   if (EFI_ERROR (Status)) {
@@ -601,7 +1720,27 @@ InitializeFdtClientDxe (
     goto CloseEvent;
   }
 
-  return Status;
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  OnFdtPack,
+                  NULL,
+                  &gEfiEventReadyToBootGuid,
+                  &PackEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->CreateEventEx (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  OnFdtPack,
+                  NULL,
+                  &gEfiEventExitBootServicesGuid,
+                  &PackEvent
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  return EFI_SUCCESS;
 
 CloseEvent:
   gBS->CloseEvent (PlatformHasDeviceTreeEvent);
@@ -191,6 +191,7 @@ FruClientDxeInitialize (
   INT32                  Node;
   CONST VOID            *Prop;
   UINT32                 PropSize;
+  UINT64                 Rate;
   EFI_STATUS             Status;
   UINTN                  Idx;
   CHAR8                  EthAlias[16]; // "ethernetX"
@@ -252,12 +253,8 @@ FruClientDxeInitialize (
           FdtClient->GetNodeProperty (FdtClient, Node, "reg", &Prop, &PropSize) == EFI_SUCCESS &&
           PropSize == 2 * sizeof (UINT64)) {
         mI2cBase = SwapBytes64 (ReadUnaligned64 (Prop));
-        if (FdtClient->GetNodeProperty (FdtClient, Node, "clocks", &Prop, &PropSize) == EFI_SUCCESS &&
-            PropSize == sizeof (UINT32) &&
-            FdtClient->FindNodeByPhandle (FdtClient, SwapBytes32 (*(CONST UINT32 *) Prop), &Node) == EFI_SUCCESS &&
-            FdtClient->GetNodeProperty (FdtClient, Node, "clock-frequency", &Prop, &PropSize) == EFI_SUCCESS &&
-            PropSize == sizeof (UINT32)) {
-          mI2cIclk = SwapBytes32 (*(CONST UINT32 *) Prop);
+        if (FdtClient->GetNodeClockRate (FdtClient, Node, 0, &Rate) == EFI_SUCCESS) {
+          mI2cIclk = Rate;
         }
       } else {
         mFruAddr = 0;
@@ -4,7 +4,7 @@
 **/
 
 #include <Library/ArmLib.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/CmuLib.h>
 #include <Library/DebugLib.h>
 #include <Library/GpioLib.h>
@@ -402,7 +402,7 @@ GmacSnpGetStatus (
         }
 
         ArmSmcArgs.Arg1 = (EFI_PHYSICAL_ADDRESS) Gmac->Regs;
-        ArmCallSmc (&ArmSmcArgs);
+        SmcCall (&ArmSmcArgs);
       }
 
       CmuClkChSetRate (Gmac->Tx2ClkChCtlAddr, Gmac->Tx2ClkChRate);
@@ -0,0 +1,352 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <IndustryStandard/Pci.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/PciIo.h>
+
+#define PCIE_CAP_OFF                     0x02
+#define PCIE_CAP_PORT_TYPE(Cap)          (((Cap) >> 4) & 0xF)
+#define PCIE_DEVCAP_OFF                  0x04
+#define PCIE_DEVCAP_MPSS(Cap)            ((Cap) & 0x7)
+#define PCIE_DEVCAP_EXT_TAG              BIT5
+#define PCIE_DEVCTL_OFF                  0x08
+#define PCIE_DEVCTL_RELAXED_ORDERING     BIT4
+#define PCIE_DEVCTL_MPS_SHIFT            5
+#define PCIE_DEVCTL_MPS_MASK             (0x7 << PCIE_DEVCTL_MPS_SHIFT)
+#define PCIE_DEVCTL_EXT_TAG              BIT8
+#define PCIE_DEVCTL_MRRS_SHIFT           12
+#define PCIE_DEVCTL_MRRS_MASK            (0x7 << PCIE_DEVCTL_MRRS_SHIFT)
+#define PCIE_DEVCAP2_OFF                 0x24
+#define PCIE_DEVCAP2_10BIT_TAG_COMPLETER BIT16
+#define PCIE_DEVCAP2_10BIT_TAG_REQUESTER BIT17
+#define PCIE_DEVCTL2_OFF                 0x28
+#define PCIE_DEVCTL2_10BIT_TAG_REQUESTER BIT12
+
+// Encoded payload/read request sizes: 0 - 128 bytes ... 5 - 4096 bytes
+#define PCIE_SIZE_BYTES(Enc)             (128U << (Enc))
+#define PCIE_SIZE_ENC_MAX                5
+
+typedef struct {
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  UINTN                 Segment;
+  UINTN                 Bus;
+  UINTN                 Device;
+  UINTN                 Function;
+  UINT8                 CapOff;
+  UINT8                 PortType;
+  UINT8                 SecondaryBus;
+  UINT8                 SubordinateBus;
+  BOOLEAN               IsBridge;
+  UINT32                DevCap;
+  UINT32                DevCap2;
+  UINT16                DevCtl;
+  UINT16                DevCtl2;
+  BOOLEAN               Tuned;
+} PCIE_TUNING_FUNC;
+
+STATIC VOID  *mPcieTuningRegistration;
+
+STATIC
+UINT8
+PcieTuningFindCap (
+  IN  EFI_PCI_IO_PROTOCOL  *PciIo
+  )
+{
+  UINT16  Status;
+  UINT8   CapOff;
+  UINT8   CapId;
+  UINTN   Limit;
+
+  PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, PCI_PRIMARY_STATUS_OFFSET, 1, &Status);
+  if (!(Status & EFI_PCI_STATUS_CAPABILITY)) {
+    return 0;
+  }
+
+  PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, PCI_CAPBILITY_POINTER_OFFSET, 1, &CapOff);
+
+  // Bound the walk: a malformed list must not hang the boot
+  for (Limit = 48; CapOff >= 0x40 && Limit > 0; --Limit) {
+    CapOff &= ~0x3;
+    PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, CapOff, 1, &CapId);
+    if (CapId == EFI_PCI_CAPABILITY_ID_PCIEXP) {
+      return CapOff;
+    }
+
+    PciIo->Pci.Read (PciIo, EfiPciIoWidthUint8, CapOff + 1, 1, &CapOff);
+  }
+
+  return 0;
+}
+
+STATIC
+BOOLEAN
+PcieTuningInSubtree (
+  IN  CONST PCIE_TUNING_FUNC  *Root,
+  IN  CONST PCIE_TUNING_FUNC  *Func
+  )
+{
+  return Func->Segment == Root->Segment &&
+         Func->Bus >= Root->SecondaryBus &&
+         Func->Bus <= Root->SubordinateBus;
+}
+
+/**
+  Tune one root port and everything below it.
+
+  The payload size is the largest one supported by every function in the
+  hierarchy, root port (i.e. the RC's DBI) included, so that peer-to-peer
+  traffic between siblings stays legal as well.
+**/
+STATIC
+VOID
+PcieTuningRootPort (
+  IN      PCIE_TUNING_FUNC  *Funcs,
+  IN      UINTN              FuncCount,
+  IN OUT  PCIE_TUNING_FUNC  *Root
+  )
+{
+  UINTN              Iter;
+  UINT32             Mps;
+  UINT32             Mrrs;
+  UINT32             MrrsMax;
+  BOOLEAN            ExtTag;
+  BOOLEAN            TenBitTag;
+  BOOLEAN            RelaxedOrdering;
+  PCIE_TUNING_FUNC  *Func;
+
+  Mps       = PCIE_DEVCAP_MPSS (Root->DevCap);
+  ExtTag    = (Root->DevCap  & PCIE_DEVCAP_EXT_TAG) != 0;
+  TenBitTag = (Root->DevCap2 & PCIE_DEVCAP2_10BIT_TAG_COMPLETER) != 0;
+
+  for (Iter = 0; Iter < FuncCount; ++Iter) {
+    Func = &Funcs[Iter];
+    if (!PcieTuningInSubtree (Root, Func)) {
+      continue;
+    }
+
+    Mps       = MIN (Mps, PCIE_DEVCAP_MPSS (Func->DevCap));
+    ExtTag    = ExtTag    && (Func->DevCap  & PCIE_DEVCAP_EXT_TAG) != 0;
+    TenBitTag = TenBitTag && (Func->DevCap2 & PCIE_DEVCAP2_10BIT_TAG_COMPLETER) != 0;
+  }
+
+  MrrsMax = PcdGet32 (PcdPcieMaxReadRequestSize);
+  Mrrs    = PCIE_SIZE_ENC_MAX;
+  while (Mrrs > 0 && PCIE_SIZE_BYTES (Mrrs) > MrrsMax) {
+    --Mrrs;
+  }
+
+  RelaxedOrdering = PcdGetBool (PcdPcieRelaxedOrdering);
+
+  for (Iter = 0; Iter < FuncCount; ++Iter) {
+    Func = &Funcs[Iter];
+    if (Func != Root && !PcieTuningInSubtree (Root, Func)) {
+      continue;
+    }
+
+    Func->DevCtl &= ~(PCIE_DEVCTL_MPS_MASK | PCIE_DEVCTL_MRRS_MASK |
+                      PCIE_DEVCTL_EXT_TAG | PCIE_DEVCTL_RELAXED_ORDERING);
+    Func->DevCtl |= (Mps  << PCIE_DEVCTL_MPS_SHIFT) |
+                    (Mrrs << PCIE_DEVCTL_MRRS_SHIFT);
+    if (ExtTag) {
+      Func->DevCtl |= PCIE_DEVCTL_EXT_TAG;
+    }
+
+    if (RelaxedOrdering) {
+      Func->DevCtl |= PCIE_DEVCTL_RELAXED_ORDERING;
+    }
+
+    Func->PciIo->Pci.Write (
+                       Func->PciIo,
+                       EfiPciIoWidthUint16,
+                       Func->CapOff + PCIE_DEVCTL_OFF,
+                       1,
+                       &Func->DevCtl
+                       );
+
+    //
+    // A 10-bit tag requester needs every completer on its path to accept the
+    // wide tags. Only the root port and the switch ports are on the path of
+    // DMA to memory; for peer-to-peer the other endpoints are, too.
+    //
+    if (TenBitTag && (Func->DevCap2 & PCIE_DEVCAP2_10BIT_TAG_REQUESTER)) {
+      Func->DevCtl2 |= PCIE_DEVCTL2_10BIT_TAG_REQUESTER;
+      Func->PciIo->Pci.Write (
+                         Func->PciIo,
+                         EfiPciIoWidthUint16,
+                         Func->CapOff + PCIE_DEVCTL2_OFF,
+                         1,
+                         &Func->DevCtl2
+                         );
+    }
+
+    Func->Tuned = TRUE;
+  }
+}
+
+STATIC
+VOID
+PcieTuningReport (
+  IN  CONST PCIE_TUNING_FUNC  *Funcs,
+  IN  UINTN                    FuncCount
+  )
+{
+  UINTN                    Iter;
+  CONST PCIE_TUNING_FUNC  *Func;
+
+  DEBUG ((EFI_D_INFO, "PCIe tuning:  Seg:Bu:De.F   Type  MPS(max)    MRRS  ExtTag  10bTag  RO\n"));
+  for (Iter = 0; Iter < FuncCount; ++Iter) {
+    Func = &Funcs[Iter];
+    DEBUG ((
+      EFI_D_INFO,
+      "PCIe tuning: %04x:%02x:%02x.%x  %4d  %4d(%4d)  %4d  %-6a  %-6a  %a%a\n",
+      (UINT32) Func->Segment,
+      (UINT32) Func->Bus,
+      (UINT32) Func->Device,
+      (UINT32) Func->Function,
+      Func->PortType,
+      PCIE_SIZE_BYTES ((Func->DevCtl & PCIE_DEVCTL_MPS_MASK) >> PCIE_DEVCTL_MPS_SHIFT),
+      PCIE_SIZE_BYTES (PCIE_DEVCAP_MPSS (Func->DevCap)),
+      PCIE_SIZE_BYTES ((Func->DevCtl & PCIE_DEVCTL_MRRS_MASK) >> PCIE_DEVCTL_MRRS_SHIFT),
+      (Func->DevCtl  & PCIE_DEVCTL_EXT_TAG) ? "on" : "off",
+      (Func->DevCtl2 & PCIE_DEVCTL2_10BIT_TAG_REQUESTER) ? "on" : "off",
+      (Func->DevCtl  & PCIE_DEVCTL_RELAXED_ORDERING) ? "on" : "off",
+      Func->Tuned ? "" : "  (no root port, untouched)"
+      ));
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+PcieTuningEnumerationComplete (
+  IN  EFI_EVENT  Event,
+  IN  VOID       *Context
+  )
+{
+  EFI_HANDLE           *HandleBuffer;
+  UINTN                 HandleCount;
+  UINTN                 Iter;
+  UINTN                 FuncCount;
+  PCIE_TUNING_FUNC     *Funcs;
+  PCIE_TUNING_FUNC     *Func;
+  EFI_PCI_IO_PROTOCOL  *PciIo;
+  PCI_TYPE01            PciConfigHeader;
+  UINT16                PcieCap;
+  VOID                 *Interface;
+  EFI_STATUS            Status;
+
+  Status = gBS->LocateProtocol (&gEfiPciEnumerationCompleteProtocolGuid, NULL, &Interface);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+
+  Status = gBS->LocateHandleBuffer (
+                  ByProtocol,
+                  &gEfiPciIoProtocolGuid,
+                  NULL,
+                  &HandleCount,
+                  &HandleBuffer
+                  );
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  Funcs = AllocateZeroPool (HandleCount * sizeof (PCIE_TUNING_FUNC));
+  if (Funcs == NULL) {
+    gBS->FreePool (HandleBuffer);
+    return;
+  }
+
+  FuncCount = 0;
+  for (Iter = 0; Iter < HandleCount; ++Iter) {
+    Status = gBS->HandleProtocol (
+                    HandleBuffer[Iter],
+                    &gEfiPciIoProtocolGuid,
+                    (VOID **) &PciIo
+                    );
+    if (EFI_ERROR (Status)) {
+      continue;
+    }
+
+    Func = &Funcs[FuncCount];
+    Func->CapOff = PcieTuningFindCap (PciIo);
+    if (Func->CapOff == 0) {
+      // Conventional PCI behind a bridge has nothing to tune
+      continue;
+    }
+
+    Func->PciIo = PciIo;
+    PciIo->GetLocation (PciIo, &Func->Segment, &Func->Bus, &Func->Device, &Func->Function);
+    PciIo->Pci.Read (
+                 PciIo,
+                 EfiPciIoWidthUint32,
+                 0,
+                 sizeof (PciConfigHeader) / sizeof (UINT32),
+                 &PciConfigHeader
+                 );
+    Func->IsBridge = IS_PCI_P2P (&PciConfigHeader);
+    if (Func->IsBridge) {
+      Func->SecondaryBus   = PciConfigHeader.Bridge.SecondaryBus;
+      Func->SubordinateBus = PciConfigHeader.Bridge.SubordinateBus;
+    }
+
+    PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, Func->CapOff + PCIE_CAP_OFF, 1, &PcieCap);
+    PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, Func->CapOff + PCIE_DEVCAP_OFF, 1, &Func->DevCap);
+    PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, Func->CapOff + PCIE_DEVCTL_OFF, 1, &Func->DevCtl);
+    Func->PortType = PCIE_CAP_PORT_TYPE (PcieCap);
+
+    // Device Capabilities/Control 2 only exist from capability version 2 on
+    if ((PcieCap & 0xF) >= 2) {
+      PciIo->Pci.Read (PciIo, EfiPciIoWidthUint32, Func->CapOff + PCIE_DEVCAP2_OFF, 1, &Func->DevCap2);
+      PciIo->Pci.Read (PciIo, EfiPciIoWidthUint16, Func->CapOff + PCIE_DEVCTL2_OFF, 1, &Func->DevCtl2);
+    }
+
+    ++FuncCount;
+  }
+
+  gBS->FreePool (HandleBuffer);
+
+  for (Iter = 0; Iter < FuncCount; ++Iter) {
+    if (Funcs[Iter].IsBridge && Funcs[Iter].PortType == PCIE_DEVICE_PORT_TYPE_ROOT_PORT) {
+      PcieTuningRootPort (Funcs, FuncCount, &Funcs[Iter]);
+    }
+  }
+
+  PcieTuningReport (Funcs, FuncCount);
+  FreePool (Funcs);
+}
+
+EFI_STATUS
+EFIAPI
+PcieTuningDxeInitialize (
+  IN  EFI_HANDLE        ImageHandle,
+  IN  EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_EVENT  Event;
+
+  //
+  // Run once the PCI bus driver has assigned the resources but before any
+  // device driver is connected, so that no DMA is in flight when the payload
+  // sizes change
+  //
+  Event = EfiCreateProtocolNotifyEvent (
+            &gEfiPciEnumerationCompleteProtocolGuid,
+            TPL_CALLBACK,
+            PcieTuningEnumerationComplete,
+            NULL,
+            &mPcieTuningRegistration
+            );
+
+  return Event != NULL ? EFI_SUCCESS : EFI_OUT_OF_RESOURCES;
+}
@@ -0,0 +1,159 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/SmcTrace.h>
+
+#define SMC_TRACE_MAX_MODULES  128
+
+STATIC SMC_TRACE_MODULE  *mSmcTraceModules[SMC_TRACE_MAX_MODULES];
+STATIC UINTN             mSmcTraceModuleCount;
+
+STATIC
+EFI_STATUS
+EFIAPI
+SmcTraceRegister (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  IN  SMC_TRACE_MODULE    *Module
+  )
+{
+  if (Module == NULL || Module->Signature != SMC_TRACE_MODULE_SIGNATURE) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (mSmcTraceModuleCount == SMC_TRACE_MAX_MODULES) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mSmcTraceModules[mSmcTraceModuleCount++] = Module;
+  return EFI_SUCCESS;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SmcTraceUnregister (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  IN  SMC_TRACE_MODULE    *Module
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < mSmcTraceModuleCount; ++Index) {
+    if (mSmcTraceModules[Index] == Module) {
+      mSmcTraceModules[Index] = mSmcTraceModules[--mSmcTraceModuleCount];
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+STATIC
+EFI_STATUS
+EFIAPI
+SmcTraceGetModules (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  OUT SMC_TRACE_MODULE    ***Modules,
+  OUT UINTN               *ModuleCount
+  )
+{
+  if (Modules == NULL || ModuleCount == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *Modules     = mSmcTraceModules;
+  *ModuleCount = mSmcTraceModuleCount;
+  return EFI_SUCCESS;
+}
+
+STATIC
+VOID
+EFIAPI
+SmcTraceReset (
+  IN  SMC_TRACE_PROTOCOL  *This
+  )
+{
+  UINTN             Index;
+  SMC_TRACE_MODULE  *Module;
+
+  for (Index = 0; Index < mSmcTraceModuleCount; ++Index) {
+    Module = mSmcTraceModules[Index];
+    Module->StatCount = 0;
+    Module->Dropped   = 0;
+    Module->TraceHead = 0;
+    ZeroMem (Module->Stats, sizeof (Module->Stats));
+  }
+}
+
+STATIC SMC_TRACE_PROTOCOL  mSmcTrace = {
+  SmcTraceRegister,
+  SmcTraceUnregister,
+  SmcTraceGetModules,
+  SmcTraceReset
+};
+
+STATIC
+VOID
+EFIAPI
+SmcTraceOnReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  UINTN             Index;
+  UINTN             StatIndex;
+  SMC_TRACE_MODULE  *Module;
+  SMC_TRACE_STAT    *Stat;
+
+  gBS->CloseEvent (Event);
+
+  for (Index = 0; Index < mSmcTraceModuleCount; ++Index) {
+    Module = mSmcTraceModules[Index];
+    for (StatIndex = 0; StatIndex < Module->StatCount; ++StatIndex) {
+      Stat = &Module->Stats[StatIndex];
+      DEBUG ((
+        EFI_D_INFO,
+        "SmcTrace: %a 0x%08x: %lu calls, total %lu us, max %lu us\n",
+        Module->ModuleName,
+        Stat->FunctionId,
+        Stat->Count,
+        GetTimeInNanoSecond (Stat->TotalTicks) / 1000,
+        GetTimeInNanoSecond (Stat->MaxTicks) / 1000
+        ));
+    }
+  }
+}
+
+EFI_STATUS
+EFIAPI
+SmcTraceDxeInitialize (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  EFI_STATUS  Status;
+  EFI_EVENT   ReadyToBootEvent;
+
+  Status = EfiCreateEventReadyToBootEx (
+             TPL_CALLBACK,
+             SmcTraceOnReadyToBoot,
+             NULL,
+             &ReadyToBootEvent
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  return gBS->InstallMultipleProtocolInterfaces (
+                &ImageHandle,
+                &gSmcTraceProtocolGuid,
+                &mSmcTrace,
+                NULL
+                );
+}
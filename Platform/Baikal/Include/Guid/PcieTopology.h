@@ -0,0 +1,77 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+  PCIe link training results remembered across boots by PciHostBridgeLib.
+  Ports are indexed by PCI segment.
+**/
+
+#ifndef PCIE_TOPOLOGY_H_
+#define PCIE_TOPOLOGY_H_
+
+#define BAIKAL_PCIE_TOPOLOGY_GUID { \
+  0x8908F53A, 0xD337, 0x4322, { 0x84, 0x02, 0x99, 0x51, 0xEB, 0x86, 0xF7, 0x71 }}
+
+#define PCIE_TOPOLOGY_VARIABLE_NAME  L"PcieTopology"
+#define PCIE_TOPOLOGY_REVISION       1
+#define PCIE_TOPOLOGY_MAX_PORTS      32
+
+#define PCIE_TOPOLOGY_PORT_VALID       BIT0   // Port was trained on the previous boot
+#define PCIE_TOPOLOGY_PORT_PRESENT     BIT1   // Link partner was detected
+#define PCIE_TOPOLOGY_PORT_LINK_UP     BIT2   // Link reached L0
+#define PCIE_TOPOLOGY_PORT_CFG0_QUIRK  BIT3   // Device does not filter CFG0 requests
+
+typedef struct {
+  UINT8   Flags;
+  UINT8   Speed;      // Negotiated link speed (1 - 2.5 GT/s, 2 - 5 GT/s, ...)
+  UINT8   Width;      // Negotiated link width
+  UINT8   Reserved;
+  UINT32  DeviceId;   // Vendor and device ID of 1:0.0
+} PCIE_TOPOLOGY_PORT;
+
+typedef struct {
+  UINT32              Revision;
+  UINT32              PortCount;
+  PCIE_TOPOLOGY_PORT  Ports[PCIE_TOPOLOGY_MAX_PORTS];
+} PCIE_TOPOLOGY;
+
+//
+// Link training statistics of the current boot, published by PciHostBridgeLib
+// in a volatile variable for the PcieLinkReport application. Ports are
+// indexed like in PCIE_TOPOLOGY.
+//
+#define PCIE_LINK_STATS_VARIABLE_NAME  L"PcieLinkStats"
+#define PCIE_LINK_STATS_REVISION       1
+
+typedef struct {
+  UINT64  DbiBase;    // Root port DBI, 0 if the port has not been set up
+  UINT32  DetectUs;   // LTSSM start to link partner detected
+  UINT32  LinkUpUs;   // LTSSM start to L0
+  UINT32  CfgWaitUs;  // L0 to config space of 1:0.0 ready
+  UINT8   Flags;      // PCIE_TOPOLOGY_PORT_*
+  UINT8   Speed;      // Negotiated link speed once training is over
+  UINT8   Width;      // Negotiated link width once training is over
+  UINT8   Retrains;   // Training restarts and retrain requests
+} PCIE_LINK_STATS_PORT;
+
+typedef struct {
+  UINT32                Revision;
+  UINT32                PortCount;
+  UINT64                TrainingUs;  // Time spent waiting for all the links
+  PCIE_LINK_STATS_PORT  Ports[PCIE_TOPOLOGY_MAX_PORTS];
+} PCIE_LINK_STATS;
+
+//
+// 64-bit prefetchable windows of the root bridges, published by
+// PciHostBridgeLib in PcdPciePMem64Windows for the ACPI _CRS. Windows are
+// indexed like in PCIE_TOPOLOGY, a window of size 0 is not set up.
+//
+typedef struct {
+  UINT64  Base;         // PCI address
+  UINT64  Size;
+  UINT64  Translation;  // CPU address - PCI address, as in ACPI _TRA
+} PCIE_PMEM64_WINDOW;
+
+extern EFI_GUID gBaikalPcieTopologyGuid;
+
+#endif // PCIE_TOPOLOGY_H_
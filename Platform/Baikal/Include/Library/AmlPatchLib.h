@@ -0,0 +1,54 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef AML_PATCH_LIB_H_
+#define AML_PATCH_LIB_H_
+
+#include <IndustryStandard/Acpi.h>
+
+/**
+  Set the value of a named integer of a definition block in place. The
+  integer keeps the width it was compiled with, so the ASL must give it a
+  placeholder of the right size (and not 0, 1 or ~0, which are encoded
+  without data).
+
+  @param  Table  The definition block.
+  @param  Name   The four character name of the integer.
+  @param  Value  The new value.
+
+  @retval EFI_SUCCESS            The integer was patched.
+  @retval EFI_NOT_FOUND          There is no such named integer.
+  @retval EFI_UNSUPPORTED        The name does not hold an integer constant.
+  @retval EFI_INVALID_PARAMETER  Value does not fit the integer.
+**/
+EFI_STATUS
+EFIAPI
+AmlPatchName (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
+  IN  CONST CHAR8                  *Name,
+  IN  UINT64                        Value
+  );
+
+/**
+  Replace a unique 32-bit placeholder anywhere in the AML of a definition
+  block, e.g. an element of a package or a field of a resource template,
+  which cannot be found by name.
+
+  @param  Table        The definition block.
+  @param  Placeholder  The value the ASL was compiled with.
+  @param  Value        The new value.
+
+  @retval EFI_SUCCESS    The placeholder was patched.
+  @retval EFI_NOT_FOUND  The placeholder is not in the table.
+**/
+EFI_STATUS
+EFIAPI
+AmlPatchPlaceholder32 (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
+  IN  UINT32                        Placeholder,
+  IN  UINT32                        Value
+  );
+
+#endif // AML_PATCH_LIB_H_
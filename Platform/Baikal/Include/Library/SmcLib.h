@@ -0,0 +1,26 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef SMC_LIB_H_
+#define SMC_LIB_H_
+
+#include <Library/ArmSmcLib.h>
+
+/**
+  Call a Baikal secure monitor service.
+
+  All Baikal-specific SMC services are issued through this function so
+  that an instrumented library instance can account for the time spent
+  in the secure monitor.
+
+  @param[in,out]  Args  SMC arguments on input, results on output.
+**/
+VOID
+EFIAPI
+SmcCall (
+  IN OUT ARM_SMC_ARGS  *Args
+  );
+
+#endif // SMC_LIB_H_
@@ -24,6 +24,13 @@ typedef struct {
   UINT32  Mode;
 } ACPI_MSI_VARSTORE_DATA;
 
+typedef struct {
+#define ACPI_SNC_OFF      0
+#define ACPI_SNC_2        2
+#define ACPI_SNC_3        3
+  UINT32  Mode;
+} ACPI_SNC_VARSTORE_DATA;
+
 typedef struct {
 #define VDU_LVDS_OFF      0
 #define VDU_LVDS_ON       1
@@ -164,6 +164,95 @@ EFI_STATUS
   IN  CONST CHAR8             *Name
   );
 
+//
+// Decoded 'reg' entry, addresses and sizes are in the parent bus space
+//
+typedef struct {
+  UINT64  Address;
+  UINT64  Size;
+} FDT_CLIENT_REG;
+
+//
+// Interrupt specifier in the format of the controller it belongs to
+//
+typedef struct {
+  INT32   Controller;
+  UINT32  CellCount;
+  UINT32  Cells[4];
+} FDT_CLIENT_INTERRUPT;
+
+//
+// Get the 'reg' entries of a node decoded using #address-cells and
+// #size-cells of its parent. The array is cached by the protocol and
+// stays valid until the device tree is modified.
+//
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_GET_NODE_REG) (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  OUT CONST FDT_CLIENT_REG    **Regs,
+  OUT UINT32                  *Count
+  );
+
+//
+// Get the 'reg' entry that is named RegName in 'reg-names'
+//
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_GET_NODE_REG_BY_NAME) (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST CHAR8             *RegName,
+  OUT CONST FDT_CLIENT_REG    **Reg
+  );
+
+//
+// Get the rate of the Index-th entry of 'clocks', the provider has to
+// describe a fixed rate clock with 'clock-frequency'
+//
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_GET_NODE_CLOCK_RATE) (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST UINT32             Index,
+  OUT UINT64                  *Rate
+  );
+
+//
+// Get the Index-th entry of 'interrupts' along with the controller
+// node resolved through 'interrupt-parent'
+//
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_GET_NODE_INTERRUPT) (
+  IN  FDT_CLIENT_PROTOCOL     *This,
+  IN  CONST INT32              Node,
+  IN  CONST UINT32             Index,
+  OUT FDT_CLIENT_INTERRUPT    *Interrupt
+  );
+
+//
+// Start queueing SetNodeProperty, DeleteProperty and DeleteNode calls
+// instead of applying them one by one. Node offsets stay valid and lookups
+// see the tree as it was until the outermost CommitUpdate, which applies
+// all queued edits in place. GetOrInsertChosenNode returns EFI_NOT_READY
+// inside an update if /chosen has to be added. A node queued for deletion
+// takes no further edits, they return EFI_NOT_FOUND.
+//
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_BEGIN_UPDATE) (
+  IN  FDT_CLIENT_PROTOCOL     *This
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *FDT_CLIENT_COMMIT_UPDATE) (
+  IN  FDT_CLIENT_PROTOCOL     *This
+  );
+
 struct _FDT_CLIENT_PROTOCOL {
   FDT_CLIENT_IS_NODE_ENABLED                IsNodeEnabled;
   FDT_CLIENT_GET_NODE_PROPERTY              GetNodeProperty;
@@ -184,6 +273,14 @@ struct _FDT_CLIENT_PROTOCOL {
   FDT_CLIENT_FIND_NODE_BY_ALIAS             FindNodeByAlias;
   FDT_CLIENT_DELETE_NODE                    DeleteNode;
   FDT_CLIENT_DELETE_PROPERTY                DeleteProperty;
+
+  FDT_CLIENT_GET_NODE_REG                   GetNodeReg;
+  FDT_CLIENT_GET_NODE_REG_BY_NAME           GetNodeRegByName;
+  FDT_CLIENT_GET_NODE_CLOCK_RATE            GetNodeClockRate;
+  FDT_CLIENT_GET_NODE_INTERRUPT             GetNodeInterrupt;
+
+  FDT_CLIENT_BEGIN_UPDATE                   BeginUpdate;
+  FDT_CLIENT_COMMIT_UPDATE                  CommitUpdate;
 };
 
 extern EFI_GUID gFdtClientProtocolGuid;
@@ -0,0 +1,87 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef SMC_TRACE_H_
+#define SMC_TRACE_H_
+
+#define SMC_TRACE_PROTOCOL_GUID { \
+  0x907C7C9A, 0xE2C1, 0x457F, { 0x9A, 0xEF, 0x5A, 0x1C, 0x5B, 0x5C, 0xE8, 0x93 }}
+
+#define SMC_TRACE_MODULE_SIGNATURE  SIGNATURE_32 ('S', 'M', 'C', 'T')
+#define SMC_TRACE_MAX_FUNCTIONS     32
+
+//
+// Per function ID statistics, latencies are in performance counter ticks
+//
+typedef struct {
+  UINT32  FunctionId;
+  UINT32  Reserved;
+  UINT64  Count;
+  UINT64  TotalTicks;
+  UINT64  MaxTicks;
+} SMC_TRACE_STAT;
+
+typedef struct {
+  UINT64  Timestamp;
+  UINT64  Ticks;
+  UINT32  FunctionId;
+  UINT32  Arg1;
+} SMC_TRACE_ENTRY;
+
+//
+// Every module linked with the tracing SmcLib instance owns one of these
+// and registers it with the protocol
+//
+typedef struct {
+  UINT32           Signature;
+  CONST CHAR8      *ModuleName;
+  UINTN            StatCount;
+  UINT64           Dropped;     // Calls with no free SMC_TRACE_STAT slot
+  SMC_TRACE_STAT   Stats[SMC_TRACE_MAX_FUNCTIONS];
+  UINTN            TraceSize;   // Ring buffer entries, 0 if disabled
+  UINT64           TraceHead;   // Total number of recorded entries
+  SMC_TRACE_ENTRY  *Trace;
+} SMC_TRACE_MODULE;
+
+typedef struct _SMC_TRACE_PROTOCOL SMC_TRACE_PROTOCOL;
+
+typedef
+EFI_STATUS
+(EFIAPI *SMC_TRACE_REGISTER) (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  IN  SMC_TRACE_MODULE    *Module
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *SMC_TRACE_UNREGISTER) (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  IN  SMC_TRACE_MODULE    *Module
+  );
+
+typedef
+EFI_STATUS
+(EFIAPI *SMC_TRACE_GET_MODULES) (
+  IN  SMC_TRACE_PROTOCOL  *This,
+  OUT SMC_TRACE_MODULE    ***Modules,
+  OUT UINTN               *ModuleCount
+  );
+
+typedef
+VOID
+(EFIAPI *SMC_TRACE_RESET) (
+  IN  SMC_TRACE_PROTOCOL  *This
+  );
+
+struct _SMC_TRACE_PROTOCOL {
+  SMC_TRACE_REGISTER     Register;
+  SMC_TRACE_UNREGISTER   Unregister;
+  SMC_TRACE_GET_MODULES  GetModules;
+  SMC_TRACE_RESET        Reset;
+};
+
+extern EFI_GUID gSmcTraceProtocolGuid;
+
+#endif // SMC_TRACE_H_
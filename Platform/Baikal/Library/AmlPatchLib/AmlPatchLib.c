@@ -0,0 +1,124 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <IndustryStandard/Acpi.h>
+#include <IndustryStandard/AcpiAml.h>
+#include <Library/AmlPatchLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+
+// NameOp NameSeg
+#define AML_NAME_PATTERN_LEN  5
+
+/**
+  Find the first occurrence of a byte pattern in the AML of a definition
+  block that is followed by at least Tail more bytes of the table.
+**/
+STATIC
+UINT8 *
+AmlFind (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
+  IN  CONST UINT8                  *Pattern,
+  IN  UINTN                         PatternLen,
+  IN  UINTN                         Tail
+  )
+{
+  UINT8  *Data;
+  UINT8  *DataEnd;
+
+  if (Table->Length < sizeof (EFI_ACPI_DESCRIPTION_HEADER) + PatternLen + Tail) {
+    return NULL;
+  }
+
+  Data    = (UINT8 *) (Table + 1);
+  DataEnd = (UINT8 *) Table + Table->Length - PatternLen - Tail;
+  for (; Data <= DataEnd; ++Data) {
+    if (Data[0] == Pattern[0] && CompareMem (Data, Pattern, PatternLen) == 0) {
+      return Data;
+    }
+  }
+
+  return NULL;
+}
+
+EFI_STATUS
+EFIAPI
+AmlPatchName (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
+  IN  CONST CHAR8                  *Name,
+  IN  UINT64                        Value
+  )
+{
+  UINT8  *Data;
+  UINTN   Idx;
+  UINT8   Pattern[AML_NAME_PATTERN_LEN];
+  UINTN   Width;
+
+  Pattern[0] = AML_NAME_OP;
+  CopyMem (&Pattern[1], Name, 4);
+
+  Data = AmlFind (Table, Pattern, AML_NAME_PATTERN_LEN, 1);
+  if (Data == NULL) {
+    DEBUG ((EFI_D_ERROR, "%a: %a not found\n", __func__, Name));
+    return EFI_NOT_FOUND;
+  }
+
+  Data += AML_NAME_PATTERN_LEN;
+  switch (Data[0]) {
+  case AML_BYTE_PREFIX:
+    Width = sizeof (UINT8);
+    break;
+  case AML_WORD_PREFIX:
+    Width = sizeof (UINT16);
+    break;
+  case AML_DWORD_PREFIX:
+    Width = sizeof (UINT32);
+    break;
+  case AML_QWORD_PREFIX:
+    Width = sizeof (UINT64);
+    break;
+  default:
+    DEBUG ((EFI_D_ERROR, "%a: %a is of kind 0x%x\n", __func__, Name, Data[0]));
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Data + 1 + Width > (UINT8 *) Table + Table->Length) {
+    return EFI_UNSUPPORTED;
+  }
+
+  if (Width < sizeof (UINT64) && (Value >> (Width * 8)) != 0) {
+    DEBUG ((EFI_D_ERROR, "%a: 0x%lx does not fit %a\n", __func__, Value, Name));
+    return EFI_INVALID_PARAMETER;
+  }
+
+  // AML integers are little endian
+  for (Idx = 0; Idx < Width; ++Idx) {
+    Data[1 + Idx] = (UINT8) (Value >> (Idx * 8));
+  }
+
+  DEBUG ((EFI_D_VERBOSE, "%a: %a = 0x%lx\n", __func__, Name, Value));
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+AmlPatchPlaceholder32 (
+  IN  EFI_ACPI_DESCRIPTION_HEADER  *Table,
+  IN  UINT32                        Placeholder,
+  IN  UINT32                        Value
+  )
+{
+  UINT8  *Data;
+
+  Data = AmlFind (Table, (CONST UINT8 *) &Placeholder, sizeof (Placeholder), 0);
+  if (Data == NULL) {
+    DEBUG ((EFI_D_ERROR, "%a: 0x%08x not found\n", __func__, Placeholder));
+    return EFI_NOT_FOUND;
+  }
+
+  WriteUnaligned32 ((UINT32 *) Data, Value);
+  return EFI_SUCCESS;
+}
@@ -434,6 +434,7 @@ LibRtcInitialize (
   INT32                 Node = 0;
   CONST VOID           *Prop;
   UINT32                PropSize;
+  UINT64                Rate;
   EFI_STATUS            Status;
 
   Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
@@ -460,10 +461,8 @@ LibRtcInitialize (
       FdtClient->GetNodeProperty (FdtClient, Node, "reg", &Prop, &PropSize) == EFI_SUCCESS && PropSize == 2 * sizeof (UINT64)) {
     I2cBase = SwapBytes64 (ReadUnaligned64 (Prop));
 
-    if (FdtClient->GetNodeProperty (FdtClient, Node, "clocks", &Prop, &PropSize) == EFI_SUCCESS && PropSize == sizeof (UINT32) &&
-        FdtClient->FindNodeByPhandle (FdtClient, SwapBytes32 (*(CONST UINT32 *) Prop), &Node) == EFI_SUCCESS &&
-        FdtClient->GetNodeProperty (FdtClient, Node, "clock-frequency", &Prop, &PropSize) == EFI_SUCCESS && PropSize == sizeof (UINT32)) {
-      I2cIclk = SwapBytes32 (*(CONST UINT32 *) Prop);
+    if (FdtClient->GetNodeClockRate (FdtClient, Node, 0, &Rate) == EFI_SUCCESS) {
+      I2cIclk = Rate;
     } else {
       return EFI_DEVICE_ERROR;
     }
@@ -10,7 +10,7 @@
   SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/PcdLib.h>
 #include <Library/DebugLib.h>
 #include <Library/IoLib.h>
@@ -40,7 +40,7 @@ BaikalSetVduFrequency (
   ArmSmcArgs.Arg3 = OscFreq;
   ArmSmcArgs.Arg4 = RefFreq;
 
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   if (ArmSmcArgs.Arg0) {
     return EFI_DEVICE_ERROR;
   }
@@ -10,7 +10,7 @@
 #include <Protocol/FdtClient.h>
 #include <Protocol/Cpu.h>
 #include <IndustryStandard/Sd.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/TimerLib.h>
 #include <Library/BaseLib.h>
@@ -249,7 +249,7 @@ SdSetClock (
   ArmSmcArgs.Arg4 = BM1000_MMAVLSP_CMU0_BASE;
   ArmSmcArgs.Arg3 = 2 * Clock;
 
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   if (ArmSmcArgs.Arg0 < 0) {
     return EFI_DEVICE_ERROR;
   }
@@ -263,7 +263,7 @@ SdSetClock (
   ArmSmcArgs.Arg4 = BM1000_MMAVLSP_CMU0_BASE;
   ArmSmcArgs.Arg3 = Round;
 
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   if (ArmSmcArgs.Arg0 < 0) {
     return EFI_DEVICE_ERROR;
   }
@@ -283,7 +283,7 @@ SdGetClock (
   ArmSmcArgs.Arg2 = BAIKAL_SMC_CMU_CLKCH_GET_RATE;
   ArmSmcArgs.Arg4 = BM1000_MMAVLSP_CMU0_BASE;
 
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   if (ArmSmcArgs.Arg0 < 0) {
     return EFI_DEVICE_ERROR;
   }
@@ -4,7 +4,7 @@
 **/
 
 #include <PiDxe.h>
-#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
 #include <Library/UefiRuntimeLib.h>
 
 #define BAIKAL_SMC_FLASH_DATA_SIZE  1024
@@ -32,7 +32,7 @@ SmcFlashErase (
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_ERASE;
   ArmSmcArgs.Arg1 = Addr;
   ArmSmcArgs.Arg2 = Size;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -45,7 +45,7 @@ SmcFlashInfo (
   ARM_SMC_ARGS  ArmSmcArgs;
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_INFO;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
 
   if (SectorSize != NULL) {
     *SectorSize = ArmSmcArgs.Arg1;
@@ -67,7 +67,7 @@ SmcFlashLock (
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_LOCK;
   ArmSmcArgs.Arg1 = Lock;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -85,7 +85,7 @@ SmcFlashPosition (
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_POSITION;
   ArmSmcArgs.Arg1 = Position;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -103,7 +103,7 @@ SmcFlashPull4Words (
   }
 
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_PULL;
-  ArmCallSmc (&ArmSmcArgs); // Pull 4xUINT64 words from TF-A
+  SmcCall (&ArmSmcArgs); // Pull 4xUINT64 words from TF-A
   DataPtr[0] = ArmSmcArgs.Arg0;
   DataPtr[1] = ArmSmcArgs.Arg1;
   DataPtr[2] = ArmSmcArgs.Arg2;
@@ -167,7 +167,7 @@ SmcFlashPush4Words (
   ArmSmcArgs.Arg2 = DataPtr[1];
   ArmSmcArgs.Arg3 = DataPtr[2];
   ArmSmcArgs.Arg4 = DataPtr[3];
-  ArmCallSmc (&ArmSmcArgs); // Push 4xUINT64 words to TF-A
+  SmcCall (&ArmSmcArgs); // Push 4xUINT64 words to TF-A
   return ArmSmcArgs.Arg0;
 }
 
@@ -225,7 +225,7 @@ SmcFlashReadBuf (
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_READ;
   ArmSmcArgs.Arg1 = Addr;
   ArmSmcArgs.Arg2 = Size;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
@@ -280,7 +280,7 @@ SmcFlashWriteBuf (
   ArmSmcArgs.Arg0 = BAIKAL_SMC_FLASH_WRITE;
   ArmSmcArgs.Arg1 = Addr;
   ArmSmcArgs.Arg2 = Size;
-  ArmCallSmc (&ArmSmcArgs);
+  SmcCall (&ArmSmcArgs);
   return ArmSmcArgs.Arg0;
 }
 
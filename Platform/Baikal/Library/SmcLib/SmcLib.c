@@ -0,0 +1,17 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/ArmSmcLib.h>
+#include <Library/SmcLib.h>
+
+VOID
+EFIAPI
+SmcCall (
+  IN OUT ARM_SMC_ARGS  *Args
+  )
+{
+  ArmCallSmc (Args);
+}
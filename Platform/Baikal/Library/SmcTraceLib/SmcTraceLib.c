@@ -0,0 +1,173 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Uefi.h>
+#include <Library/ArmSmcLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
+#include <Library/SmcLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+#include <Protocol/SmcTrace.h>
+
+STATIC SMC_TRACE_MODULE    mSmcTraceModule;
+STATIC SMC_TRACE_PROTOCOL  *mSmcTrace;
+STATIC EFI_EVENT           mSmcTraceRegistrationEvent;
+STATIC EFI_EVENT           mSmcTraceExitBootServicesEvent;
+STATIC VOID                *mSmcTraceRegistration;
+
+VOID
+EFIAPI
+SmcCall (
+  IN OUT ARM_SMC_ARGS  *Args
+  )
+{
+  UINT32           FunctionId;
+  UINT32           Arg1;
+  UINT64           Start;
+  UINT64           Ticks;
+  UINTN            Index;
+  SMC_TRACE_STAT   *Stat;
+  SMC_TRACE_ENTRY  *Entry;
+
+  FunctionId = (UINT32)Args->Arg0;
+  Arg1       = (UINT32)Args->Arg1;
+
+  Start = GetPerformanceCounter ();
+  ArmCallSmc (Args);
+  Ticks = GetPerformanceCounter () - Start;
+
+  Stat = NULL;
+  for (Index = 0; Index < mSmcTraceModule.StatCount; ++Index) {
+    if (mSmcTraceModule.Stats[Index].FunctionId == FunctionId) {
+      Stat = &mSmcTraceModule.Stats[Index];
+      break;
+    }
+  }
+
+  if (Stat == NULL && mSmcTraceModule.StatCount < SMC_TRACE_MAX_FUNCTIONS) {
+    Stat = &mSmcTraceModule.Stats[mSmcTraceModule.StatCount++];
+    Stat->FunctionId = FunctionId;
+  }
+
+  if (Stat != NULL) {
+    ++Stat->Count;
+    Stat->TotalTicks += Ticks;
+    Stat->MaxTicks    = MAX (Stat->MaxTicks, Ticks);
+  } else {
+    ++mSmcTraceModule.Dropped;
+  }
+
+  if (mSmcTraceModule.Trace != NULL) {
+    Entry = &mSmcTraceModule.Trace[mSmcTraceModule.TraceHead % mSmcTraceModule.TraceSize];
+    Entry->Timestamp  = Start;
+    Entry->Ticks      = Ticks;
+    Entry->FunctionId = FunctionId;
+    Entry->Arg1       = Arg1;
+    ++mSmcTraceModule.TraceHead;
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+SmcTraceRegister (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  EFI_STATUS  Status;
+
+  if (mSmcTrace != NULL) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol (&gSmcTraceProtocolGuid, NULL, (VOID **)&mSmcTrace);
+  if (EFI_ERROR (Status)) {
+    mSmcTrace = NULL;
+    return;
+  }
+
+  mSmcTrace->Register (mSmcTrace, &mSmcTraceModule);
+  if (mSmcTraceRegistrationEvent != NULL) {
+    gBS->CloseEvent (mSmcTraceRegistrationEvent);
+    mSmcTraceRegistrationEvent = NULL;
+  }
+}
+
+STATIC
+VOID
+EFIAPI
+SmcTraceExitBootServices (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  //
+  // The ring buffer is not converted to virtual addresses, keep
+  // only the statistics that live in the image itself
+  //
+  mSmcTraceModule.Trace = NULL;
+  mSmcTrace = NULL;
+}
+
+EFI_STATUS
+EFIAPI
+SmcTraceLibConstructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  mSmcTraceModule.Signature  = SMC_TRACE_MODULE_SIGNATURE;
+  mSmcTraceModule.ModuleName = gEfiCallerBaseName;
+  mSmcTraceModule.TraceSize  = FixedPcdGet32 (PcdSmcTraceRingSize);
+  if (mSmcTraceModule.TraceSize != 0) {
+    mSmcTraceModule.Trace = AllocateZeroPool (mSmcTraceModule.TraceSize * sizeof (SMC_TRACE_ENTRY));
+  }
+
+  gBS->CreateEvent (
+         EVT_SIGNAL_EXIT_BOOT_SERVICES,
+         TPL_CALLBACK,
+         SmcTraceExitBootServices,
+         NULL,
+         &mSmcTraceExitBootServicesEvent
+         );
+
+  mSmcTraceRegistrationEvent = EfiCreateProtocolNotifyEvent (
+                                 &gSmcTraceProtocolGuid,
+                                 TPL_CALLBACK,
+                                 SmcTraceRegister,
+                                 NULL,
+                                 &mSmcTraceRegistration
+                                 );
+  return EFI_SUCCESS;
+}
+
+EFI_STATUS
+EFIAPI
+SmcTraceLibDestructor (
+  IN EFI_HANDLE        ImageHandle,
+  IN EFI_SYSTEM_TABLE  *SystemTable
+  )
+{
+  if (mSmcTraceRegistrationEvent != NULL) {
+    gBS->CloseEvent (mSmcTraceRegistrationEvent);
+  }
+
+  if (mSmcTraceExitBootServicesEvent != NULL) {
+    gBS->CloseEvent (mSmcTraceExitBootServicesEvent);
+  }
+
+  if (mSmcTrace != NULL) {
+    mSmcTrace->Unregister (mSmcTrace, &mSmcTraceModule);
+  }
+
+  if (mSmcTraceModule.Trace != NULL) {
+    FreePool (mSmcTraceModule.Trace);
+  }
+
+  return EFI_SUCCESS;
+}
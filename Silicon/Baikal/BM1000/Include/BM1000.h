@@ -127,4 +127,22 @@
 #define BM1000_PCIE2_DYNIO2_BASE        0x6000000000
 #define BM1000_PCIE2_DYNIO2_SIZE        SIZE_128GB
 
+#define BM1000_CORE_COUNT               8
+#define BM1000_CLUSTER_COUNT            4
+#define BM1000_CORE_COUNT_PER_CLUSTER   2
+
+// Cache hierarchy (CacheInfoLib.h), in SMBIOS Type 7 handle order
+#define BM1000_CACHE_L1I                0
+#define BM1000_CACHE_L1D                1
+#define BM1000_CACHE_L2                 2
+#define BM1000_CACHE_L3                 3
+#define BM1000_CACHE_COUNT              4
+
+#define BM1000_CACHE_INFO  {                                                                  \
+  CACHE_INFO_DEFAULT (1, CACHE_INFO_TYPE_INSTRUCTION, CACHE_INFO_SCOPE_CORE,    0xC000,    3), \
+  CACHE_INFO_DEFAULT (1, CACHE_INFO_TYPE_DATA,        CACHE_INFO_SCOPE_CORE,    SIZE_32KB, 2), \
+  CACHE_INFO_DEFAULT (2, CACHE_INFO_TYPE_UNIFIED,     CACHE_INFO_SCOPE_CLUSTER, SIZE_1MB, 16), \
+  CACHE_INFO_DEFAULT (3, CACHE_INFO_TYPE_UNIFIED,     CACHE_INFO_SCOPE_PACKAGE, SIZE_8MB, 16)  \
+}
+
 #endif // BM1000_H_
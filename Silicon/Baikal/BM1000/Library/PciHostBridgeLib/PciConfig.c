@@ -93,6 +93,31 @@ PciConfigInstallHii(
     if (EFI_ERROR(Status)) {
       DEBUG((EFI_D_ERROR, "Can't set PciConfig var (%r)\n", Status));
     }
+  } else {
+    /* Extend a 'PciConfig' variable created by an older firmware. */
+    Size = sizeof (PCI_CONFIG_VARSTORE_DATA);
+    ZeroMem(&PciConfig, Size);
+    Status = gRT->GetVariable (
+                    L"PciConfig",
+                    &gPciConfigGuid,
+                    NULL,
+                    &Size,
+                    &PciConfig
+                    );
+    if (!EFI_ERROR(Status) && Size < sizeof (PCI_CONFIG_VARSTORE_DATA)) {
+      Status = gRT->SetVariable (
+                      L"PciConfig",
+                      &gPciConfigGuid,
+                      EFI_VARIABLE_NON_VOLATILE |
+                      EFI_VARIABLE_BOOTSERVICE_ACCESS |
+                      EFI_VARIABLE_RUNTIME_ACCESS,
+                      sizeof (PCI_CONFIG_VARSTORE_DATA),
+                      &PciConfig
+                      );
+      if (EFI_ERROR(Status)) {
+        DEBUG((EFI_D_ERROR, "Can't set PciConfig var (%r)\n", Status));
+      }
+    }
   }
 
   DriverHandle = NULL;
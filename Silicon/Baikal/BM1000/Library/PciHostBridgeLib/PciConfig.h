@@ -16,6 +16,8 @@ extern EFI_GUID gPciConfigGuid;
 typedef struct {
   UINT8 MaxSpeed[3];
   UINT8 _NotUsed;
+  UINT8 Gen3Preset[3];  // 0: H/W default, N: transmitter preset P(N-1)
+  UINT8 _NotUsed2;
 } PCI_CONFIG_VARSTORE_DATA;
 
 typedef struct {
@@ -24,4 +26,15 @@ typedef struct {
   UINT8 Val2:1;
 } PCI_SEGMENT_MASK_VARSTORE_DATA;
 
+//
+// Volatile variable set when links come up at 2.5 GT/s although both ends
+// support a higher speed
+//
+#define PCI_GEN1_LINKS_VARIABLE_NAME  L"PcieGen1Links"
+
+typedef struct {
+  UINT8 Mask;            // Bitmask of the affected PCIe controllers
+  UINT8 TargetSpeed[3];  // Speed each controller was expected to reach
+} PCI_GEN1_LINKS_DATA;
+
 #endif
@@ -19,12 +19,15 @@
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Platform/ConfigVars.h>
 #include <Protocol/FdtClient.h>
+#include <Protocol/PciEnumerationComplete.h>
 #include <Protocol/PciHostBridgeResourceAllocation.h>
 #include <Protocol/PciIo.h>
 #include <Guid/EventGroup.h>
+#include <Guid/PcieTopology.h>
 #include "PciConfig.h"
 
 #include <BM1000.h>
+#include <PcieSegment.h>
 
 #define BM1000_PCIE_GPR_RST(PcieIdx)                     (BM1000_PCIE_GPR_BASE + (PcieIdx) * 0x20 + 0x00)
 #define BM1000_PCIE_GPR_RST_PHY_RST                      BIT0
@@ -83,6 +86,9 @@
 #define BM1000_PCIE_PF0_PORT_LOGIC_GEN3_EQ_CONTROL_OFF_PSET_REQ_VEC_BITS             (0xFFFF << 8)
 #define BM1000_PCIE_PF0_PORT_LOGIC_GEN3_EQ_CONTROL_OFF_PSET_REQ_VEC_SHIFT            8
 
+#define BM1000_PCIE_SPCIE_CAP_ID                                                     0x0019
+#define BM1000_PCIE_SPCIE_CAP_LANE_EQ_CTRL_OFF                                       0x0C
+
 #define BM1000_PCIE_PF0_PORT_LOGIC_PIPE_LOOPBACK_CONTROL_OFF                         0x8B8
 #define BM1000_PCIE_PF0_PORT_LOGIC_PIPE_LOOPBACK_CONTROL_OFF_PIPE_LOOPBACK           BIT31
 
@@ -155,8 +161,35 @@
 #define BM1000_PCIE_CAP_PCIE_OFF        0x70
 #define BM1000_PCIE_CAP_MSIX_OFF        0xB0
 
-#define RANGES_FLAG_IO   0x01000000
-#define RANGES_FLAG_MEM  0x02000000
+#define RANGES_FLAG_SPACE_MASK  0x03000000
+#define RANGES_FLAG_IO          0x01000000
+#define RANGES_FLAG_MEM         0x02000000
+#define RANGES_FLAG_MEM64       0x03000000
+
+// Outbound iATU regions: PCIe0/PCIe1 have 4, PCIe2 has 16
+#define BM1000_PCIE_IATU_REGIONS(PcieIdx)  ((PcieIdx) == BM1000_PCIE2_IDX ? 16 : 4)
+
+#define PCIE_LINK_DETECT_TIMEOUT_NS  50000000ULL
+#define PCIE_LINK_UP_TIMEOUT_NS      100000000ULL
+#define PCIE_LINK_CFG_TIMEOUT_NS     1000000000ULL
+#define PCIE_LINK_POLL_US            100
+
+// Retrain policy: the delay before each extra retrain attempt doubles
+#define PCIE_RETRAIN_TIMEOUT_NS      1000000000ULL
+#define PCIE_RETRAIN_POLL_US         1000
+#define PCIE_RETRAIN_ATTEMPTS        5
+#define PCIE_RETRAIN_DELAY_MIN_US    10000
+#define PCIE_RETRAIN_DELAY_MAX_US    160000
+
+// Lanes covered by the 8.0 GT/s equalization presets
+#define PCIE_EQ_PRESETS_MAX          16
+
+typedef enum {
+  PcieLinkStateDetect,
+  PcieLinkStateTraining,
+  PcieLinkStateCfgWait,
+  PcieLinkStateDone
+} PCIE_LINK_STATE;
 
 BOOLEAN PciHostBridgeLibGetLink (UINTN  PcieIdx);
 extern EFI_STATUS PciConfigInstallHii(UINT8 SegmentMask);
@@ -231,7 +264,10 @@ STATIC CONST UINTN  mPcieDbiSizes[] = {
 };
 
 UINT32                        mPcieCfg0Quirk;
+STATIC UINT32                 mPcieLinkMask;
+STATIC VOID                  *mPcieRegistration;
 EFI_PHYSICAL_ADDRESS          mPcieCfgBases[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+PCIE_SEGMENT_DESC             mPcieSegments[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC UINTN                  mPcieCfgSizes[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC UINTN                  mPcieIdxs[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC UINTN                  mPcieMaxLinkSpeed[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
@@ -241,8 +277,14 @@ STATIC UINTN                  mPcieIoSizes[ARRAY_SIZE (mEfiPciRootBridgeDevicePa
 STATIC EFI_PHYSICAL_ADDRESS   mPcieMemBases[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC EFI_PHYSICAL_ADDRESS   mPcieMemMins[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC UINTN                  mPcieMemSizes[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+STATIC EFI_PHYSICAL_ADDRESS   mPciePMemBases[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+STATIC EFI_PHYSICAL_ADDRESS   mPciePMemMins[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+STATIC UINTN                  mPciePMemSizes[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
 STATIC PCI_ROOT_BRIDGE       *mPcieRootBridges;
 STATIC UINTN                  mPcieRootBridgesNum;
+STATIC PCIE_TOPOLOGY          mPcieTopologyPrev;
+STATIC PCIE_TOPOLOGY          mPcieTopology;
+STATIC PCIE_LINK_STATS        mPcieLinkStats;
 
 STATIC_ASSERT (
   ARRAY_SIZE (mPcieDbiBases) == ARRAY_SIZE (mEfiPciRootBridgeDevicePaths),
@@ -261,94 +303,18 @@ STATIC_ASSERT (
   "ARRAY_SIZE (mPcieCfgSizes) != ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)"
   );
 
-STATIC
-BOOLEAN
-PciHostBridgeLibPhyWaitForDone (
-  IN  EFI_PHYSICAL_ADDRESS  PcieDbiBase
-  )
-{
-  UINT32  Val;
-  UINTN   Limit;
-
-  for (Limit = 1000; Limit > 0; --Limit) {
-    Val = MmioRead32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL);
-    Val &= BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_DONE |
-           BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_BUSY;
-
-    if (Val == BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_DONE) {
-      return TRUE;
-    }
-
-    gBS->Stall (1 * 1000);
-  }
-
-  return FALSE;
-}
-
-STATIC
-BOOLEAN
-PciHostBridgeLibPhyRead (
-  IN  EFI_PHYSICAL_ADDRESS  PcieDbiBase,
-  IN  UINT32                PhyAddr,
-  OUT UINT32               *PhyData
-  )
-{
-  BOOLEAN         Ret;
-
-  MmioWrite32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_LANENUM, 1);
-  MmioWrite32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL, PhyAddr);
-
-  Ret = PciHostBridgeLibPhyWaitForDone (PcieDbiBase);
-  if (Ret) {
-    *PhyData = MmioRead32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_READDATA);
-  }
-
-  return Ret;
-}
-
-STATIC
-BOOLEAN
-PciHostBridgeLibPhyWrite (
-  IN  EFI_PHYSICAL_ADDRESS  PcieDbiBase,
-  IN  UINT32                PhyAddr,
-  IN  UINT32                PhyMask,
-  IN  UINT16                PhyData
-  )
-{
-  BOOLEAN                     Ret;
-
-  MmioWrite32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_LANENUM, PhyMask);
-  MmioWrite32 (PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_WRITEDATA, PhyData);
-  MmioWrite32 (
-    PcieDbiBase + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL,
-    PhyAddr | BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_READ_WRITE_FLAG
-    );
-
-  Ret = PciHostBridgeLibPhyWaitForDone (PcieDbiBase);
-
-  return Ret;
-}
-
-STATIC
-BOOLEAN
-PciHostBridgeLibSetupPhy (
-  IN  UINTN   PcieIdx,
-  IN  UINT32  PhyMask
-  )
-{
-  EFI_PHYSICAL_ADDRESS  PcieDbiBase;
-  UINT32  PhyData;
-  UINT32  OldGenCtl;
-
-  PcieDbiBase = mPcieDbiBases[PcieIdx];
-
-  // Enable access to PHY registers and DBI2 mode
-  OldGenCtl = MmioRead32 (BM1000_PCIE_GPR_GEN (PcieIdx));
-  MmioOr32 (
-    BM1000_PCIE_GPR_GEN (PcieIdx),
-    BM1000_PCIE_GPR_GEN_PHY_EN | BM1000_PCIE_GPR_GEN_DBI2_EN
-    );
+//
+// PHY register sequence applied by PciHostBridgeLibSetupPhy: each step reads
+// the register from lane 0, clears AndMask, sets OrMask and writes the result
+// to all the lanes of the link
+//
+typedef struct {
+  UINT32  PhyAddr;
+  UINT16  AndMask;
+  UINT16  OrMask;
+} PCIE_PHY_STEP;
 
+STATIC CONST PCIE_PHY_STEP  mPciePhySteps[] = {
   //
   // Slice RX
   //
@@ -356,136 +322,197 @@ PciHostBridgeLibSetupPhy (
   // Set RX CTLE Boost to 10.2 dB
   // Set RX CTLE Peak Value to 5 dB
   // Enable RX CDR, RX DFE, RX AGC
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL, &PhyData)) {
-    return FALSE;
-  }
-
-  PhyData |= BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_POLE_OVRRD_EN;
-
 #if 0 //vvv???
-  PhyData &= ~BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_PCS_SDS_ZERO_BITS;
-  PhyData |= 8 << BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_PCS_SDS_ZERO_SHIFT;
+  {
+    BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL,
+    (UINT16) ~BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_PCS_SDS_ZERO_BITS,
+    BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_POLE_OVRRD_EN | (8 << BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_PCS_SDS_ZERO_SHIFT)
+  },
+#else
+  { BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL, 0xFFFF, BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL_POLE_OVRRD_EN },
 #endif
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_CTLE_CTRL, PhyMask, PhyData)) {
-    return FALSE;
-  }
-
 #if 0 //vvv: Needs more testing
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL, &PhyData)) {
-    return FALSE;
-  }
-
-  PhyData |= BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_CDR_EN |
-             BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_DFE_EN |
-             BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_AGC_EN |
-             BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_LCTRL_MEN;
-
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL, PhyMask, PhyData)) {
-    return FALSE;
-  }
+  {
+    BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL,
+    0xFFFF,
+    BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_CDR_EN |
+    BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_DFE_EN |
+    BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_AGC_EN |
+    BM1000_PCIE_PHY_LANE_RX_LOOP_CTRL_LCTRL_MEN
+  },
 
   //
   // Slice TX
   //
 
   // Set TX Gain (PCS to SerDes lane TX) TX Launch Amplitude to 1000 mVppd
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, &PhyData)) {
-    return FALSE;
-  }
-
-  PhyData &= ~BM1000_PCIE_PHY_LANE_TX_CFG_3_PCS_SDS_GAIN_BITS;
-  PhyData |= 3 << BM1000_PCIE_PHY_LANE_TX_CFG_3_PCS_SDS_GAIN_SHIFT;
-
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, PhyMask, PhyData)) {
-    return FALSE;
-  }
+  {
+    BM1000_PCIE_PHY_LANE_TX_CFG_3,
+    (UINT16) ~BM1000_PCIE_PHY_LANE_TX_CFG_3_PCS_SDS_GAIN_BITS,
+    3 << BM1000_PCIE_PHY_LANE_TX_CFG_3_PCS_SDS_GAIN_SHIFT
+  },
 
   // Enable TX Boost (PCS to SerDes lane TX)
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, &PhyData)) {
-    return FALSE;
-  }
+  { BM1000_PCIE_PHY_LANE_TX_CFG_3, 0xFFFF, BM1000_PCIE_PHY_LANE_TX_CFG_3_VBOOST_EN },
+  { BM1000_PCIE_PHY_LANE_TX_CFG_1, 0xFFFF, BM1000_PCIE_PHY_LANE_TX_CFG_1_VBOOST_EN_OVRRD_EN },
 
-  PhyData |= BM1000_PCIE_PHY_LANE_TX_CFG_3_VBOOST_EN;
+  // Enable TX Boost (MAC to PCS lane TX)
+  { BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_0, 0xFFFF, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_0_VBOOST_EN_REQ_OVRRD_VAL },
+  { BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_2, 0xFFFF, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_2_VBOOST_EN_REQ_OVRRD_EN },
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, PhyMask, PhyData)) {
-    return FALSE;
-  }
+  // Disable TX Turbo (PCS to SerDes lane TX)
+  { BM1000_PCIE_PHY_LANE_TX_CFG_3, (UINT16) ~BM1000_PCIE_PHY_LANE_TX_CFG_3_TURBO_EN, 0 },
+  { BM1000_PCIE_PHY_LANE_TX_CFG_1, 0xFFFF, BM1000_PCIE_PHY_LANE_TX_CFG_1_TURBO_EN_OVRRD_EN },
+#endif
 
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_1, &PhyData)) {
-    return FALSE;
-  }
+  // Disable DFE equalization and adaptation
+  { BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_1, (UINT16) ~0x7fff, 0 },
+  { BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_2, 0xFFFF, 0x3f }
+};
 
-  PhyData |= BM1000_PCIE_PHY_LANE_TX_CFG_1_VBOOST_EN_OVRRD_EN;
+//
+// A PHY access normally completes within microseconds, give up after a second
+//
+#define PCIE_PHY_TIMEOUT_NS  1000000000ULL
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_1, PhyMask, PhyData)) {
-    return FALSE;
-  }
+/**
+  Wait for the PHY accesses started on the controllers in Pending.
 
-  // Enable TX Boost (MAC to PCS lane TX)
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_0, &PhyData)) {
-    return FALSE;
-  }
+  @param[in,out]  Pending  Bitmask of PcieIdx. Controllers are cleared as their
+                           access completes, those left set have timed out.
+  @param[out]     DoneNs   Per PcieIdx completion time of the access.
+**/
+STATIC
+VOID
+PciHostBridgeLibPhyWaitForDone (
+  IN OUT UINT32  *Pending,
+  OUT    UINT64  *DoneNs
+  )
+{
+  UINT64  Now;
+  UINT64  TimeStart;
+  UINTN   PcieIdx;
+  UINT32  Val;
 
-  PhyData |= BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_0_VBOOST_EN_REQ_OVRRD_VAL;
+  TimeStart = GetTimeInNanoSecond (GetPerformanceCounter ());
+  for (;;) {
+    Now = GetTimeInNanoSecond (GetPerformanceCounter ());
+    for (PcieIdx = 0; PcieIdx < ARRAY_SIZE (mEfiPciRootBridgeDevicePaths); ++PcieIdx) {
+      if (!(*Pending & (1 << PcieIdx))) {
+        continue;
+      }
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_0, PhyMask, PhyData)) {
-    return FALSE;
-  }
+      Val = MmioRead32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL);
+      Val &= BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_DONE |
+             BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_BUSY;
 
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_2, &PhyData)) {
-    return FALSE;
-  }
+      if (Val == BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_DONE) {
+        *Pending       &= ~(1 << PcieIdx);
+        DoneNs[PcieIdx] = Now;
+      }
+    }
 
-  PhyData |= BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_2_VBOOST_EN_REQ_OVRRD_EN;
+    if (*Pending == 0 || Now - TimeStart > PCIE_PHY_TIMEOUT_NS) {
+      return;
+    }
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_PCS_CTLIFC_CTRL_2, PhyMask, PhyData)) {
-    return FALSE;
+    MicroSecondDelay (1);
   }
+}
 
-  // Disable TX Turbo (PCS to SerDes lane TX)
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, &PhyData)) {
-    return FALSE;
-  }
+/**
+  Apply mPciePhySteps to the PHYs of several controllers at once.
 
-  PhyData &= ~BM1000_PCIE_PHY_LANE_TX_CFG_3_TURBO_EN;
+  Every step is issued to all the controllers before waiting for any of them,
+  so the PHY accesses of different controllers overlap.
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_3, PhyMask, PhyData)) {
-    return FALSE;
-  }
+  @param[in]  PcieMask  Bitmask of PcieIdx to set up.
+  @param[in]  PhyMasks  Per PcieIdx mask of the lanes to write.
 
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_1, &PhyData)) {
-    return FALSE;
-  }
+  @retval  Bitmask of PcieIdx whose PHY has been set up successfully.
+**/
+STATIC
+UINT32
+PciHostBridgeLibSetupPhy (
+  IN  UINT32         PcieMask,
+  IN  CONST UINT32  *PhyMasks
+  )
+{
+  UINT32  Active;
+  UINT64  DoneNs[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT32  OldGenCtl[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINTN   PcieIdx;
+  UINT32  Pending;
+  UINT32  PhyData;
+  UINTN   Step;
+  UINT64  TimeStart;
 
-  PhyData |= BM1000_PCIE_PHY_LANE_TX_CFG_1_TURBO_EN_OVRRD_EN;
+  TimeStart = GetTimeInNanoSecond (GetPerformanceCounter ());
 
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_TX_CFG_1, PhyMask, PhyData)) {
-    return FALSE;
+  // Enable access to PHY registers and DBI2 mode
+  for (PcieIdx = 0; PcieIdx < ARRAY_SIZE (mEfiPciRootBridgeDevicePaths); ++PcieIdx) {
+    if (PcieMask & (1 << PcieIdx)) {
+      OldGenCtl[PcieIdx] = MmioRead32 (BM1000_PCIE_GPR_GEN (PcieIdx));
+      MmioOr32 (
+        BM1000_PCIE_GPR_GEN (PcieIdx),
+        BM1000_PCIE_GPR_GEN_PHY_EN | BM1000_PCIE_GPR_GEN_DBI2_EN
+        );
+      DoneNs[PcieIdx] = TimeStart;
+    }
   }
-#endif
 
-  // Disable DFE equalization and adaptation
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_1, &PhyData)) {
-    return FALSE;
-  }
-  PhyData &= ~0x7fff;
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_1, PhyMask, PhyData)) {
-    return FALSE;
-  }
+  Active = PcieMask;
+  for (Step = 0; Step < ARRAY_SIZE (mPciePhySteps) && Active != 0; ++Step) {
+    for (PcieIdx = 0; PcieIdx < ARRAY_SIZE (mEfiPciRootBridgeDevicePaths); ++PcieIdx) {
+      if (Active & (1 << PcieIdx)) {
+        MmioWrite32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_LANENUM, 1);
+        MmioWrite32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL, mPciePhySteps[Step].PhyAddr);
+      }
+    }
 
-  if (!PciHostBridgeLibPhyRead (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_2, &PhyData)) {
-    return FALSE;
-  }
-  PhyData |= 0x3f;
-  if (!PciHostBridgeLibPhyWrite (PcieDbiBase, BM1000_PCIE_PHY_LANE_RX_AEQ_VALBBD_2, PhyMask, PhyData)) {
-    return FALSE;
+    Pending = Active;
+    PciHostBridgeLibPhyWaitForDone (&Pending, DoneNs);
+    Active &= ~Pending;
+
+    for (PcieIdx = 0; PcieIdx < ARRAY_SIZE (mEfiPciRootBridgeDevicePaths); ++PcieIdx) {
+      if (Active & (1 << PcieIdx)) {
+        PhyData  = MmioRead32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_READDATA);
+        PhyData &= mPciePhySteps[Step].AndMask;
+        PhyData |= mPciePhySteps[Step].OrMask;
+
+        MmioWrite32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_LANENUM, PhyMasks[PcieIdx]);
+        MmioWrite32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_WRITEDATA, PhyData);
+        MmioWrite32 (
+          mPcieDbiBases[PcieIdx] + BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL,
+          mPciePhySteps[Step].PhyAddr | BM1000_PCIE_BK_PHY_ACCESS_AXI2MGM_ADDRCTL_PHY_READ_WRITE_FLAG
+          );
+      }
+    }
+
+    Pending = Active;
+    PciHostBridgeLibPhyWaitForDone (&Pending, DoneNs);
+    Active &= ~Pending;
   }
 
   // Restore access to PHY registers and DBI2 mode
-  MmioWrite32 (BM1000_PCIE_GPR_GEN (PcieIdx), OldGenCtl);
+  for (PcieIdx = 0; PcieIdx < ARRAY_SIZE (mEfiPciRootBridgeDevicePaths); ++PcieIdx) {
+    if (PcieMask & (1 << PcieIdx)) {
+      MmioWrite32 (BM1000_PCIE_GPR_GEN (PcieIdx), OldGenCtl[PcieIdx]);
+      if (Active & (1 << PcieIdx)) {
+        DEBUG ((
+          EFI_D_INFO,
+          "PcieRoot(0x%x): PHY set up in %lu us\n",
+          PcieIdx,
+          (DoneNs[PcieIdx] - TimeStart) / 1000
+          ));
+      } else {
+        DEBUG ((EFI_D_ERROR, "PcieRoot(0x%x): PHY access timeout\n", PcieIdx));
+      }
+    }
+  }
 
-  return TRUE;
+  return Active;
 }
 
 STATIC
@@ -552,6 +579,227 @@ PciHostBridgeLibCfgWindow (
     );
 }
 
+STATIC
+VOID
+PciHostBridgeLibCheckCfg0Filter (
+  IN  UINTN   PcieIdx,
+  IN  UINT64  Elapsed
+  )
+{
+  EFI_STATUS  Status;
+
+  DEBUG((EFI_D_INFO,
+    "PcieRoot(0x%x): [%dms]: dev_id at 1:0.0 - %x, dev_id at 1:1.0 - %x\n",
+    PcieIdx,
+    Elapsed / 1000000,
+    MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB),
+    MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0x8000)));
+
+  if (MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB) != 0xFFFFFFFF &&
+      MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0x8000) == 0xFFFFFFFF) {
+    //
+    // Device appears to filter CFG0 requests, so the 64 KiB granule for the iATU
+    // isn't a problem. We don't have to ignore fn > 0 or shift MCFG by 0x8000.
+    //
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter+\n", PcieIdx));
+  } else if (((MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0xc) >> 16) & 0xff) == 0x1) {
+    /* Type 1 config header */
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter- (Type 1)\n", PcieIdx));
+  } else {
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter-\n", PcieIdx));
+    mPcieCfg0Quirk |= 1 << PcieIdx;
+    Status = PcdSet32S (PcdPcieCfg0Quirk, mPcieCfg0Quirk);
+    ASSERT_EFI_ERROR (Status);
+  }
+}
+
+STATIC
+VOID
+PciHostBridgeLibLoadTopology (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Size   = sizeof (mPcieTopologyPrev);
+  Status = gRT->GetVariable (
+                  PCIE_TOPOLOGY_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  NULL,
+                  &Size,
+                  &mPcieTopologyPrev
+                  );
+  if (EFI_ERROR (Status) ||
+      Size != sizeof (mPcieTopologyPrev) ||
+      mPcieTopologyPrev.Revision  != PCIE_TOPOLOGY_REVISION ||
+      mPcieTopologyPrev.PortCount != ARRAY_SIZE (mEfiPciRootBridgeDevicePaths) ||
+      !PcdGetBool (PcdPcieFastBoot)) {
+    ZeroMem (&mPcieTopologyPrev, sizeof (mPcieTopologyPrev));
+  }
+}
+
+STATIC
+VOID
+PciHostBridgeLibSaveTopology (
+  VOID
+  )
+{
+  UINTN               Iter;
+  UINTN               PcieIdx;
+  UINT32              PcieLnkSts;
+  PCIE_TOPOLOGY_PORT  *Port;
+  PCIE_TOPOLOGY_PORT  *PrevPort;
+  EFI_STATUS          Status;
+
+  mPcieTopology.Revision  = PCIE_TOPOLOGY_REVISION;
+  mPcieTopology.PortCount = ARRAY_SIZE (mEfiPciRootBridgeDevicePaths);
+
+  for (Iter = 0; Iter < mPcieRootBridgesNum; ++Iter) {
+    PcieIdx  = mPcieIdxs[Iter];
+    Port     = &mPcieTopology.Ports[PcieIdx];
+    PrevPort = &mPcieTopologyPrev.Ports[PcieIdx];
+
+    Port->Flags |= PCIE_TOPOLOGY_PORT_VALID;
+    if (PciHostBridgeLibGetLink (PcieIdx)) {
+      PcieLnkSts = MmioRead32 (
+                     mPcieDbiBases[PcieIdx] +
+                     BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG
+                     );
+      Port->Flags   |= PCIE_TOPOLOGY_PORT_LINK_UP;
+      Port->Speed    = (PcieLnkSts & BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_BITS) >>
+                         BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_SHIFT;
+      Port->Width    = (PcieLnkSts & BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_BITS) >>
+                         BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_SHIFT;
+      Port->DeviceId = MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB);
+      if (mPcieCfg0Quirk & (1 << PcieIdx)) {
+        Port->Flags |= PCIE_TOPOLOGY_PORT_CFG0_QUIRK;
+      }
+    }
+
+    if ((PrevPort->Flags & PCIE_TOPOLOGY_PORT_VALID) &&
+        (PrevPort->Flags != Port->Flags || PrevPort->DeviceId != Port->DeviceId)) {
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x): topology changed (flags %x -> %x, id %08x -> %08x)\n",
+        PcieIdx,
+        PrevPort->Flags,
+        Port->Flags,
+        PrevPort->DeviceId,
+        Port->DeviceId
+        ));
+    }
+  }
+
+  if (CompareMem (&mPcieTopology, &mPcieTopologyPrev, sizeof (mPcieTopology)) == 0) {
+    return;
+  }
+
+  Status = gRT->SetVariable (
+                  PCIE_TOPOLOGY_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                  sizeof (mPcieTopology),
+                  &mPcieTopology
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: unable to save PCIe topology, Status: %r\n", __func__, Status));
+  }
+}
+
+//
+// Publish the link training statistics of this boot for PcieLinkReport
+//
+STATIC
+VOID
+PciHostBridgeLibSaveLinkStats (
+  VOID
+  )
+{
+  UINTN                 Iter;
+  UINTN                 PcieIdx;
+  PCIE_LINK_STATS_PORT  *Port;
+  EFI_STATUS            Status;
+
+  mPcieLinkStats.Revision  = PCIE_LINK_STATS_REVISION;
+  mPcieLinkStats.PortCount = mPcieTopology.PortCount;
+
+  for (Iter = 0; Iter < mPcieRootBridgesNum; ++Iter) {
+    PcieIdx = mPcieIdxs[Iter];
+    Port    = &mPcieLinkStats.Ports[PcieIdx];
+    Port->DbiBase = mPcieDbiBases[PcieIdx];
+    Port->Flags   = mPcieTopology.Ports[PcieIdx].Flags;
+    Port->Speed   = mPcieTopology.Ports[PcieIdx].Speed;
+    Port->Width   = mPcieTopology.Ports[PcieIdx].Width;
+  }
+
+  Status = gRT->SetVariable (
+                  PCIE_LINK_STATS_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                  sizeof (mPcieLinkStats),
+                  &mPcieLinkStats
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: unable to save PCIe link statistics, Status: %r\n", __func__, Status));
+  }
+}
+
+/**
+  Program the 8.0 GT/s lane equalization presets of a root port. Must be
+  called with DBI_RO_WR_EN set.
+
+  @param[in]  PcieIdx  Controller index.
+  @param[in]  Presets  Per lane values in Lane Equalization Control register
+                       format (see "eq-presets-8gts").
+  @param[in]  Num      Number of entries in Presets.
+**/
+STATIC
+VOID
+PciHostBridgeLibSetEqPresets (
+  IN  UINTN          PcieIdx,
+  IN  CONST UINT16  *Presets,
+  IN  UINTN          Num
+  )
+{
+  UINTN   CapOff;
+  UINT32  Hdr;
+  UINTN   Lane;
+  UINTN   MaxWidth;
+
+  // Look for the Secondary PCI Express extended capability
+  for (CapOff = 0x100; CapOff != 0; CapOff = (Hdr >> 20) & 0xFFC) {
+    Hdr = MmioRead32 (mPcieDbiBases[PcieIdx] + CapOff);
+    if (Hdr == 0 || Hdr == MAX_UINT32) {
+      CapOff = 0;
+      break;
+    }
+
+    if ((Hdr & 0xFFFF) == BM1000_PCIE_SPCIE_CAP_ID) {
+      break;
+    }
+  }
+
+  if (CapOff == 0) {
+    DEBUG ((EFI_D_ERROR, "PcieRoot(0x%x): no Secondary PCIe capability, EQ presets ignored\n", PcieIdx));
+    return;
+  }
+
+  MaxWidth = (MmioRead32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_PF0_PCIE_CAP_LINK_CAPABILITIES_REG) &
+              BM1000_PCIE_PF0_PCIE_CAP_LINK_CAPABILITIES_REG_MAX_WIDTH_BITS) >>
+              BM1000_PCIE_PF0_PCIE_CAP_LINK_CAPABILITIES_REG_MAX_WIDTH_SHIFT;
+  Num = MIN (Num, MaxWidth);
+
+  for (Lane = 0; Lane < Num; ++Lane) {
+    MmioWrite16 (
+      mPcieDbiBases[PcieIdx] + CapOff + BM1000_PCIE_SPCIE_CAP_LANE_EQ_CTRL_OFF + Lane * sizeof (UINT16),
+      Presets[Lane]
+      );
+  }
+
+  DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Gen3 EQ presets set on %u lanes (lane 0: 0x%04x)\n", PcieIdx, Num, Presets[0]));
+}
+
 STATIC
 VOID
 EFIAPI
@@ -561,11 +809,25 @@ PciHostBridgeLinkRetrain (
   UINTN                 PcieIdx, Iter;
   UINT64                TimeStart;
   UINT32                DevCapSpeed, TargetSpeed, Reg, CapOff;
+  UINT32                TargetSpeeds[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT32                PhyMasks[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT32                PhyPcieMask;
+  UINTN                 Attempt;
+  UINTN                 Delay;
+  PCI_GEN1_LINKS_DATA   Gen1Links;
+  EFI_STATUS            Status;
   EFI_PHYSICAL_ADDRESS  PcieCfgBase;
 
   DEBUG((EFI_D_INFO, "LinkRetrain called\n"));
+
+  //
+  // Work out the target speed of every link first, so that the PHYs of all
+  // the links going to Gen3 are set up in one batch
+  //
+  PhyPcieMask = 0;
   for (Iter = 0; Iter < mPcieRootBridgesNum; Iter++) {
     PcieIdx = mPcieIdxs[Iter];
+    TargetSpeeds[PcieIdx] = 0;
 
     if (!PciHostBridgeLibGetLink(PcieIdx))
       continue;
@@ -595,12 +857,25 @@ PciHostBridgeLinkRetrain (
         continue;
       }
 
+      TargetSpeeds[PcieIdx] = TargetSpeed;
       if (TargetSpeed >= 3) {
         Reg = MmioRead32(mPcieDbiBases[PcieIdx] + BM1000_PCIE_PF0_PCIE_CAP_LINK_CAPABILITIES_REG);
         Reg = (Reg >> 4) & 0x3f; /* link width capability */
-        PciHostBridgeLibSetupPhy (PcieIdx, (1 << Reg) - 1);
+        PhyMasks[PcieIdx] = (1 << Reg) - 1;
+        PhyPcieMask |= 1 << PcieIdx;
       }
+    }
+  }
+
+  if (PhyPcieMask != 0) {
+    PciHostBridgeLibSetupPhy (PhyPcieMask, PhyMasks);
+  }
 
+  for (Iter = 0; Iter < mPcieRootBridgesNum; Iter++) {
+    PcieIdx = mPcieIdxs[Iter];
+    TargetSpeed = TargetSpeeds[PcieIdx];
+
+    if (TargetSpeed != 0) {
       MmioAndThenOr32 (
          mPcieDbiBases[PcieIdx] +
          BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG,
@@ -613,6 +888,7 @@ PciHostBridgeLinkRetrain (
         BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
         );
       DEBUG((EFI_D_INFO, "PcieRoot(0x%x): Retraining link to Gen%d\n", PcieIdx, TargetSpeed));
+      ++mPcieLinkStats.Ports[PcieIdx].Retrains;
       TimeStart = GetTimeInNanoSecond (GetPerformanceCounter());
       while (((Reg = MmioRead32 (BM1000_PCIE_GPR_STS (PcieIdx))) & 0xff) != 0xd1) {
         if (Reg & 0x1000 /*0x3000*/) {
@@ -620,14 +896,14 @@ PciHostBridgeLinkRetrain (
           MmioAnd32 (BM1000_PCIE_GPR_GEN (PcieIdx), ~BM1000_PCIE_GPR_GEN_LTSSM_EN);
           goto failedretrain;
         }
-        if (GetTimeInNanoSecond (GetPerformanceCounter()) - TimeStart > 1000000000) {
+        if (GetTimeInNanoSecond (GetPerformanceCounter()) - TimeStart > PCIE_RETRAIN_TIMEOUT_NS) {
           DEBUG((EFI_D_ERROR, "Timeout! (LinkStatus %08x-%08x)\n",
                 MmioRead32(mPcieDbiBases[PcieIdx] +
                 BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG),
                 MmioRead32 (BM1000_PCIE_GPR_STS (PcieIdx))));
           goto failedretrain;
         }
-        gBS->Stall(10000);
+        gBS->Stall(PCIE_RETRAIN_POLL_US);
       }
       Reg = MmioRead32 (
               mPcieDbiBases[PcieIdx] +
@@ -640,40 +916,80 @@ PciHostBridgeLinkRetrain (
             Reg));
       Reg = (Reg >> 16) & 0xf;
 
-      if (Reg < TargetSpeed) {
-        gBS->Stall(200000);
+      //
+      // Some links need a few goes to reach the target speed: retry with an
+      // exponentially growing delay, up to PCIE_RETRAIN_ATTEMPTS times
+      //
+      for (Attempt = 1, Delay = PCIE_RETRAIN_DELAY_MIN_US;
+           Reg < TargetSpeed && Attempt <= PCIE_RETRAIN_ATTEMPTS;
+           ++Attempt, Delay = MIN (Delay * 2, PCIE_RETRAIN_DELAY_MAX_US)) {
+        gBS->Stall(Delay);
         MmioOr32 (
           mPcieDbiBases[PcieIdx] +
           BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG,
           BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
           );
-        DEBUG((EFI_D_INFO, "PcieRoot(0x%x): Retraining link to Gen%d\n", PcieIdx, TargetSpeed));
+        DEBUG((EFI_D_INFO, "PcieRoot(0x%x): Retraining link to Gen%d (attempt %u)\n", PcieIdx, TargetSpeed, Attempt));
+        ++mPcieLinkStats.Ports[PcieIdx].Retrains;
         TimeStart = GetTimeInNanoSecond (GetPerformanceCounter());
         while (MmioRead32(mPcieDbiBases[PcieIdx] +
                BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG) &
                  0x8000000) {
-          if (GetTimeInNanoSecond (GetPerformanceCounter()) - TimeStart > 1000000000) {
+          if (GetTimeInNanoSecond (GetPerformanceCounter()) - TimeStart > PCIE_RETRAIN_TIMEOUT_NS) {
             DEBUG((EFI_D_ERROR, "Timeout! (LinkStatus %08x)\n",
                   MmioRead32(mPcieDbiBases[PcieIdx] +
                   BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG)));
             goto failedretrain;
           }
-          gBS->Stall(10000);
+          gBS->Stall(PCIE_RETRAIN_POLL_US);
         }
         Reg = MmioRead32 (
                 mPcieDbiBases[PcieIdx] +
                 BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG
                 );
         Reg = (Reg >> 16) & 0xf;
-        DEBUG((EFI_D_INFO, "PcieRoot(0x%x)[%03ums]: retrained(2) to Gen%u\n",
+        DEBUG((EFI_D_INFO, "PcieRoot(0x%x)[%03ums]: retrained(%u) to Gen%u\n",
               PcieIdx,
               (GetTimeInNanoSecond (GetPerformanceCounter()) - TimeStart) / 1000000,
+              Attempt + 1,
               Reg));
       }
     }
 failedretrain:
     continue;
   }
+
+  //
+  // Let the OS know about the links left at 2.5 GT/s although both ends
+  // can go faster: a riser or cable is likely at fault
+  //
+  ZeroMem (&Gen1Links, sizeof (Gen1Links));
+  for (Iter = 0; Iter < mPcieRootBridgesNum; Iter++) {
+    PcieIdx = mPcieIdxs[Iter];
+    if (TargetSpeeds[PcieIdx] <= 1 || !PciHostBridgeLibGetLink (PcieIdx)) {
+      continue;
+    }
+
+    Reg = MmioRead32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG);
+    if (((Reg >> 16) & 0xf) == 1) {
+      DEBUG ((EFI_D_WARN, "PcieRoot(0x%x): link stuck at Gen1, Gen%u expected\n", PcieIdx, TargetSpeeds[PcieIdx]));
+      Gen1Links.Mask |= 1 << PcieIdx;
+      Gen1Links.TargetSpeed[PcieIdx] = TargetSpeeds[PcieIdx];
+    }
+  }
+
+  if (Gen1Links.Mask != 0) {
+    Status = gRT->SetVariable (
+                    PCI_GEN1_LINKS_VARIABLE_NAME,
+                    &gPciConfigGuid,
+                    EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                    sizeof (Gen1Links),
+                    &Gen1Links
+                    );
+    if (EFI_ERROR (Status)) {
+      DEBUG ((EFI_D_ERROR, "Can't set %s var (%r)\n", PCI_GEN1_LINKS_VARIABLE_NAME, Status));
+    }
+  }
 }
 
 STATIC
@@ -745,6 +1061,65 @@ PciHostBridgeLibExitBootServices (
   gBS->FreePool (HandleBuffer);
 }
 
+STATIC
+VOID
+EFIAPI
+PciHostBridgeLibReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+  PciSegmentLibTraceDump ();
+}
+
+/**
+  Read the link of every root bridge and publish the ones that are up in
+  PcdPcieLinkMask, from which AcpiPlatformDxe builds _STA and MCFG.
+**/
+STATIC
+VOID
+PciHostBridgeLibSetLinkMask (
+  VOID
+  )
+{
+  UINTN  Iter;
+  UINTN  PcieIdx;
+
+  mPcieLinkMask = 0;
+  for (Iter = 0; Iter < mPcieRootBridgesNum; ++Iter) {
+    PcieIdx = mPcieIdxs[Iter];
+    mPcieSegments[PcieIdx].LinkUp = PciHostBridgeLibGetLink (PcieIdx);
+    if (mPcieSegments[PcieIdx].LinkUp) {
+      mPcieLinkMask |= 1U << PcieIdx;
+    }
+  }
+
+  PcdSet32S (PcdPcieLinkMask, mPcieLinkMask);
+}
+
+STATIC
+VOID
+EFIAPI
+PciHostBridgeLibEnumerationComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  VOID        *Interface;
+  EFI_STATUS   Status;
+
+  Status = gBS->LocateProtocol (&gEfiPciEnumerationCompleteProtocolGuid, NULL, &Interface);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+
+  // Take in the links that have come up while the buses were enumerated
+  PciHostBridgeLibSetLinkMask ();
+}
+
 EFI_STATUS
 EFIAPI
 PciHostBridgeLibConstructor (
@@ -770,11 +1145,21 @@ PciHostBridgeLibConstructor (
   PCI_CONFIG_VARSTORE_DATA PciConfig;
   UINT8                SegmentMask = 0;
   UINTN                 Size;
+  PCIE_LINK_STATE       LinkState[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT64                TimeStart[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  BOOLEAN               Pending;
+  UINT64                TrainingStart;
+  BOOLEAN               LinkFast[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT32                PhyMasks[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINT16                PcieEqPresets[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)][PCIE_EQ_PRESETS_MAX];
+  UINTN                 PcieEqPresetsNum[ARRAY_SIZE (mEfiPciRootBridgeDevicePaths)];
+  UINTN                 Lane;
 
   Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
   ASSERT_EFI_ERROR (Status);
 
   Size = sizeof(PCI_CONFIG_VARSTORE_DATA);
+  ZeroMem(&PciConfig, sizeof(PCI_CONFIG_VARSTORE_DATA));
   Status = gRT->GetVariable (
                   L"PciConfig",
                   &gPciConfigGuid,
@@ -877,8 +1262,9 @@ PciHostBridgeLibConstructor (
         PropSize > 0 && (PropSize % (sizeof (UINT32) + 3 * sizeof (UINT64))) == 0) {
       UINTN  Entry;
 
-      mPcieIoMins[PcieIdx]  = MAX_UINT64;
-      mPcieMemMins[PcieIdx] = MAX_UINT64;
+      mPcieIoMins[PcieIdx]    = MAX_UINT64;
+      mPcieMemMins[PcieIdx]   = MAX_UINT64;
+      mPciePMemSizes[PcieIdx] = 0;
 
       for (Entry = 0; Entry < PropSize / (sizeof (UINT32) + 3 * sizeof (UINT64)); ++Entry) {
         UINTN                 Flags;
@@ -891,14 +1277,26 @@ PciHostBridgeLibConstructor (
         CpuBase = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) ((EFI_PHYSICAL_ADDRESS) Prop + sizeof (UINT32) + 1 * sizeof (UINT64))));
         Size    = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) ((EFI_PHYSICAL_ADDRESS) Prop + sizeof (UINT32) + 2 * sizeof (UINT64))));
 
-        if (Flags & RANGES_FLAG_IO) {
+        //
+        // Mask the space code rather than testing single bits: a 64-bit
+        // memory range (0b11) would otherwise be taken for an I/O one.
+        // Behind the root port a window above 4 GiB can only be prefetchable.
+        //
+        if ((Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_IO) {
           mPcieIoMins[PcieIdx]  = PciBase;
           mPcieIoBases[PcieIdx] = CpuBase;
           mPcieIoSizes[PcieIdx] = Size;
-        } else if (Flags & RANGES_FLAG_MEM) {
-          mPcieMemMins[PcieIdx]  = PciBase;
-          mPcieMemBases[PcieIdx] = CpuBase;
-          mPcieMemSizes[PcieIdx] = Size;
+        } else if ((Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_MEM ||
+                   (Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_MEM64) {
+          if (PciBase + Size - 1 <= MAX_UINT32) {
+            mPcieMemMins[PcieIdx]  = PciBase;
+            mPcieMemBases[PcieIdx] = CpuBase;
+            mPcieMemSizes[PcieIdx] = Size;
+          } else if (mPciePMemSizes[PcieIdx] < Size) {
+            mPciePMemMins[PcieIdx]  = PciBase;
+            mPciePMemBases[PcieIdx] = CpuBase;
+            mPciePMemSizes[PcieIdx] = Size;
+          }
         }
 
         Prop = &(((CONST UINT32 *) Prop)[7]);
@@ -924,6 +1322,28 @@ PciHostBridgeLibConstructor (
       mPcieMaxLinkSpeed[PcieIdx] = 3;
     }
 
+    //
+    // 8.0 GT/s equalization presets: the PciConfig setting applies one
+    // transmitter preset to all lanes, "eq-presets-8gts" gives one per lane
+    //
+    if (PciConfig.Gen3Preset[PcieIdx]) {
+      for (Lane = 0; Lane < PCIE_EQ_PRESETS_MAX; ++Lane) {
+        PcieEqPresets[PcieIdx][Lane] = ((PciConfig.Gen3Preset[PcieIdx] - 1) << 8) |
+                                        (PciConfig.Gen3Preset[PcieIdx] - 1);
+      }
+
+      PcieEqPresetsNum[PcieIdx] = PCIE_EQ_PRESETS_MAX;
+    } else if (FdtClient->GetNodeProperty (FdtClient, Node, "eq-presets-8gts", &Prop, &PropSize)
+                 == EFI_SUCCESS &&
+                 PropSize >= sizeof (UINT16)) {
+      PcieEqPresetsNum[PcieIdx] = MIN (PropSize / sizeof (UINT16), PCIE_EQ_PRESETS_MAX);
+      for (Lane = 0; Lane < PcieEqPresetsNum[PcieIdx]; ++Lane) {
+        PcieEqPresets[PcieIdx][Lane] = SwapBytes16 (ReadUnaligned16 ((CONST UINT16 *) Prop + Lane));
+      }
+    } else {
+      PcieEqPresetsNum[PcieIdx] = 0;
+    }
+
     if (FdtClient->GetNodeProperty (FdtClient, Node, "reset-gpios", &Prop, &PropSize) == EFI_SUCCESS &&
         PropSize == 12) {
       PciePerstGpios[PcieIdx]    = SwapBytes32 (((CONST UINT32 *) Prop)[1]);
@@ -951,6 +1371,8 @@ PciHostBridgeLibConstructor (
     return EFI_SUCCESS;
   }
 
+  PciHostBridgeLibLoadTopology ();
+
   //
   // Disable MSI translations (they are disabled after reset).
   // This allows PCIe devices to target GICD_NS_SETSPI,
@@ -1003,12 +1425,17 @@ PciHostBridgeLibConstructor (
     GpioDirSet (BM1000_GPIO32_BASE, Pcie2PrsntGpio);
   }
 
-  // Initialise PCIe RCs
+  //
+  // Initialise PCIe RCs and start link training on all of them
+  //
   for (Iter = 0; Iter < mPcieRootBridgesNum; ++Iter, ++lPcieRootBridge) {
     UINT32   ResetMask;
-    BOOLEAN  ComponentExists = FALSE;
     UINTN    PciePortLinkCapableLanesVal;
-    UINT64   TimeStart;
+    UINT32   TargetSpeed;
+    UINT32   Reg;
+    UINTN    RegionIdx;
+    UINT64   Mapped;
+    UINT64   Chunk;
 
     PcieIdx = mPcieIdxs[Iter];
 
@@ -1036,6 +1463,11 @@ PciHostBridgeLibConstructor (
     lPcieRootBridge->PMemAbove4G.Limit = 0;
     lPcieRootBridge->DevicePath        = (EFI_DEVICE_PATH_PROTOCOL *) &mEfiPciRootBridgeDevicePaths[PcieIdx];
 
+    mPcieSegments[PcieIdx].DbiBase = mPcieDbiBases[PcieIdx];
+    mPcieSegments[PcieIdx].CfgBase = mPcieCfgBases[PcieIdx];
+    mPcieSegments[PcieIdx].BusMax  = lPcieRootBridge->Bus.Limit;
+    mPcieSegments[PcieIdx].LinkUp  = FALSE;
+
     // Assert PERST pin
     if (PciePerstGpios[PcieIdx] >= 0 &&
         PciePerstGpios[PcieIdx] <= 31 &&
@@ -1134,6 +1566,10 @@ PciHostBridgeLibConstructor (
        0
        );
 
+    if (PcieEqPresetsNum[PcieIdx] > 0) {
+      PciHostBridgeLibSetEqPresets (PcieIdx, PcieEqPresets[PcieIdx], PcieEqPresetsNum[PcieIdx]);
+    }
+
     // Disable writing read-only registers using DBI
     MmioAnd32 (
        mPcieDbiBases[PcieIdx] +
@@ -1216,12 +1652,71 @@ PciHostBridgeLibConstructor (
       0
       );
 
-    // Force PCIE_CAP_TARGET_LINK_SPEED to 2.5 GT/s
+    //
+    // Regions 4+: 64-bit prefetchable MEM. A region cannot cross a 4 GiB
+    // boundary, so the window takes as many of the spare regions as it needs.
+    //
+    Mapped = 0;
+    for (RegionIdx = 4;
+         RegionIdx < BM1000_PCIE_IATU_REGIONS (PcieIdx) && Mapped < mPciePMemSizes[PcieIdx];
+         ++RegionIdx) {
+      Chunk = MIN (
+                mPciePMemSizes[PcieIdx] - Mapped,
+                SIZE_4GB - ((mPciePMemBases[PcieIdx] + Mapped) & (SIZE_4GB - 1))
+                );
+      PciHostBridgeLibCfgWindow (
+        mPcieDbiBases[PcieIdx],
+        RegionIdx,
+        mPciePMemBases[PcieIdx] + Mapped,
+        mPciePMemMins[PcieIdx] + Mapped,
+        Chunk,
+        BM1000_PCIE_PF0_PORT_LOGIC_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_MEM,
+        0
+        );
+      Mapped += Chunk;
+    }
+
+    if (Mapped < mPciePMemSizes[PcieIdx]) {
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x): no iATU regions left, 64-bit window truncated to 0x%llx bytes\n",
+        PcieIdx,
+        Mapped
+        ));
+    }
+
+    if (Mapped > 0) {
+      lPcieRootBridge->AllocationAttributes    = EFI_PCI_HOST_BRIDGE_MEM64_DECODE;
+      lPcieRootBridge->PMemAbove4G.Base        = mPciePMemMins[PcieIdx];
+      lPcieRootBridge->PMemAbove4G.Limit       = mPciePMemMins[PcieIdx] + Mapped - 1;
+      lPcieRootBridge->PMemAbove4G.Translation = mPciePMemMins[PcieIdx] - mPciePMemBases[PcieIdx];
+    }
+
+    //
+    // Force PCIE_CAP_TARGET_LINK_SPEED to 2.5 GT/s and let PciHostBridgeLinkRetrain
+    // raise it, unless the link reached a higher speed on the previous boot
+    //
+    TargetSpeed = 1;
+    if ((mPcieTopologyPrev.Ports[PcieIdx].Flags & PCIE_TOPOLOGY_PORT_LINK_UP) &&
+        mPcieTopologyPrev.Ports[PcieIdx].Speed > 1 &&
+        mPcieTopologyPrev.Ports[PcieIdx].Speed <= mPcieMaxLinkSpeed[PcieIdx]) {
+      TargetSpeed = mPcieTopologyPrev.Ports[PcieIdx].Speed;
+      if (TargetSpeed >= 3) {
+        Reg = MmioRead32 (mPcieDbiBases[PcieIdx] + BM1000_PCIE_PF0_PCIE_CAP_LINK_CAPABILITIES_REG);
+        Reg = (Reg >> 4) & 0x3f; /* link width capability */
+        PhyMasks[PcieIdx] = (1 << Reg) - 1;
+        PciHostBridgeLibSetupPhy (1 << PcieIdx, PhyMasks);
+      }
+
+      DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): training at Gen%u as on the previous boot\n", PcieIdx, TargetSpeed));
+    }
+
+    LinkFast[PcieIdx] = TargetSpeed > 1;
     MmioAndThenOr32 (
        mPcieDbiBases[PcieIdx] +
        BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG,
       ~BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG_TRGT_LNK_SPEED_BITS,
-       1
+       TargetSpeed
       );
 
     // Configure Preset Request Vector
@@ -1257,31 +1752,56 @@ PciHostBridgeLibConstructor (
       BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
       );
 
-    // Wait for link
-    TimeStart = GetTimeInNanoSecond (GetPerformanceCounter ());
-    for (;;) {
-      CONST UINT32  PcieGprSts = MmioRead32 (BM1000_PCIE_GPR_STS (PcieIdx));
-      UINT64        PerformanceCounter = GetPerformanceCounter ();
+    LinkState[PcieIdx] = PcieLinkStateDetect;
+    TimeStart[PcieIdx] = GetTimeInNanoSecond (GetPerformanceCounter ());
+  }
+
+  //
+  // All LTSSMs are running now, wait for the links together so that
+  // empty slots cost one detect timeout in total rather than one each
+  //
+  TrainingStart = GetTimeInNanoSecond (GetPerformanceCounter ());
+  do {
+    Pending = FALSE;
+
+    for (Iter = 0; Iter < mPcieRootBridgesNum; ++Iter) {
+      UINT32  PcieGprSts;
+      UINT64  Elapsed;
 
-      if (!ComponentExists) {
+      PcieIdx = mPcieIdxs[Iter];
+      if (LinkState[PcieIdx] == PcieLinkStateDone) {
+        continue;
+      }
+
+      PcieGprSts = MmioRead32 (BM1000_PCIE_GPR_STS (PcieIdx));
+      Elapsed    = GetTimeInNanoSecond (GetPerformanceCounter ()) - TimeStart[PcieIdx];
+
+      if (LinkState[PcieIdx] == PcieLinkStateDetect) {
         if ((PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK) > 0x01) {
-          ComponentExists = TRUE;
+          LinkState[PcieIdx] = PcieLinkStateTraining;
+          mPcieTopology.Ports[PcieIdx].Flags |= PCIE_TOPOLOGY_PORT_PRESENT;
+          mPcieLinkStats.Ports[PcieIdx].DetectUs = Elapsed / 1000;
           DEBUG ((
             EFI_D_INFO,
             "PcieRoot(0x%x)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link partner detected\n",
             PcieIdx,
-            (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
+            Elapsed / 1000000,
             PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK,
             PcieGprSts & BM1000_PCIE_GPR_STS_SMLH_LINKUP ? '+' : '-',
             PcieGprSts & BM1000_PCIE_GPR_STS_RDLH_LINKUP ? '+' : '-'
             ));
-        } else if (GetTimeInNanoSecond (PerformanceCounter) - TimeStart > 50000000) {
-          // According to PCI Express Base Specification device must enter LTSSM detect state within 20 ms of reset
-          break;
+        } else if (Elapsed > PCIE_LINK_DETECT_TIMEOUT_NS) {
+          //
+          // According to PCI Express Base Specification device must enter LTSSM detect state within 20 ms of reset.
+          // A port that was empty on the previous boot gets the full window too, a card inserted since then may
+          // take all of it.
+          //
+          LinkState[PcieIdx] = PcieLinkStateDone;
+          continue;
         }
       }
 
-      if (ComponentExists) {
+      if (LinkState[PcieIdx] == PcieLinkStateTraining) {
         if (((PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK) ==
                            BM1000_PCIE_GPR_STS_LTSSM_STATE_L0) &&
              (PcieGprSts & BM1000_PCIE_GPR_STS_SMLH_LINKUP) &&
@@ -1307,9 +1827,9 @@ PciHostBridgeLibConstructor (
 
           DEBUG ((
             EFI_D_INFO,
-            "PcieRoot(0x%x)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link %a GT/s, x%u",
+            "PcieRoot(0x%x)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link %a GT/s, x%u\n",
             PcieIdx,
-            (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
+            Elapsed / 1000000,
             PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK,
             PcieGprSts & BM1000_PCIE_GPR_STS_SMLH_LINKUP ? '+' : '-',
             PcieGprSts & BM1000_PCIE_GPR_STS_RDLH_LINKUP ? '+' : '-',
@@ -1318,53 +1838,38 @@ PciHostBridgeLibConstructor (
               BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_SHIFT
             ));
 #endif
-          // Wait until device starts responding to cfg requests
-          while (MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB) == 0) {
-            PerformanceCounter = GetPerformanceCounter ();
-            MmioWrite32(mPcieCfgBases[PcieIdx] + SIZE_1MB, 0xffffffff);
-            gBS->Stall (1000);
-            if (((GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000) > 1000) {
-              break;
-            }
-          }
-          DEBUG((EFI_D_INFO,
-            "PcieRoot(0x%x): [%dms]: dev_id at 1:0.0 - %x, dev_id at 1:1.0 - %x\n",
-            PcieIdx,
-            (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
-            MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB),
-            MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0x8000)));
-
-          if (MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB) != 0xFFFFFFFF &&
-              MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0x8000) == 0xFFFFFFFF) {
-            //
-            // Device appears to filter CFG0 requests, so the 64 KiB granule for the iATU
-            // isn't a problem. We don't have to ignore fn > 0 or shift MCFG by 0x8000.
-            //
-#if !defined(MDEPKG_NDEBUG)
-            DEBUG ((EFI_D_INFO, ", Cfg0Filter+\n"));
-#endif
-          } else if (((MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB + 0xc) >> 16) & 0xff) == 0x1) {
-            /* Type 1 config header */
-#if !defined(MDEPKG_NDEBUG)
-            DEBUG ((EFI_D_INFO, ", Cfg0Filter- (Type 1)\n"));
-#endif
-          } else {
-#if !defined(MDEPKG_NDEBUG)
-            DEBUG ((EFI_D_INFO, ", Cfg0Filter-\n"));
-#endif
-            mPcieCfg0Quirk |= 1 << PcieIdx;
-            Status = PcdSet32S (PcdPcieCfg0Quirk, mPcieCfg0Quirk);
-            ASSERT_EFI_ERROR (Status);
-          }
-
-          break;
-        } else if (GetTimeInNanoSecond (PerformanceCounter) - TimeStart > 100000000) {
+          LinkState[PcieIdx] = PcieLinkStateCfgWait;
+          mPcieLinkStats.Ports[PcieIdx].LinkUpUs = Elapsed / 1000;
+        } else if (Elapsed > PCIE_LINK_UP_TIMEOUT_NS && LinkFast[PcieIdx]) {
+          //
+          // The remembered speed did not work out (different device or
+          // marginal link), fall back to the full training from 2.5 GT/s
+          //
+          DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): no link at the remembered speed, retraining\n", PcieIdx));
+          LinkFast[PcieIdx] = FALSE;
+          ++mPcieLinkStats.Ports[PcieIdx].Retrains;
+          MmioAnd32 (BM1000_PCIE_GPR_GEN (PcieIdx), ~BM1000_PCIE_GPR_GEN_LTSSM_EN);
+          MmioAndThenOr32 (
+             mPcieDbiBases[PcieIdx] +
+             BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG,
+            ~BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL2_LINK_STATUS2_REG_TRGT_LNK_SPEED_BITS,
+             1
+            );
+          MmioOr32 (BM1000_PCIE_GPR_GEN (PcieIdx), BM1000_PCIE_GPR_GEN_LTSSM_EN);
+          MmioOr32 (
+            mPcieDbiBases[PcieIdx] +
+            BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG,
+            BM1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
+            );
+          LinkState[PcieIdx] = PcieLinkStateDetect;
+          TimeStart[PcieIdx] = GetTimeInNanoSecond (GetPerformanceCounter ());
+        } else if (Elapsed > PCIE_LINK_UP_TIMEOUT_NS) {
           // Wait up to 100 ms for link up
           DEBUG ((
             EFI_D_INFO,
             "PcieRoot(0x%x)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link is inactive\n",
             PcieIdx,
-            (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
+            Elapsed / 1000000,
             PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK,
             PcieGprSts & BM1000_PCIE_GPR_STS_SMLH_LINKUP ? '+' : '-',
             PcieGprSts & BM1000_PCIE_GPR_STS_RDLH_LINKUP ? '+' : '-'
@@ -1375,14 +1880,15 @@ PciHostBridgeLibConstructor (
           // but does not reach L0. Disabling LTSSM helps to prevent these hangups.
           //
           MmioAnd32 (BM1000_PCIE_GPR_GEN (PcieIdx), ~BM1000_PCIE_GPR_GEN_LTSSM_EN);
-          break;
+          LinkState[PcieIdx] = PcieLinkStateDone;
+          continue;
         } else if ((PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK) == 0x03 ||
                    (PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK) == 0x05) {
           DEBUG ((
             EFI_D_INFO,
             "PcieRoot(0x%x)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: %a\n",
             PcieIdx,
-            (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
+            Elapsed / 1000000,
             PcieGprSts & BM1000_PCIE_GPR_STS_LTSSM_STATE_MASK,
             PcieGprSts & BM1000_PCIE_GPR_STS_SMLH_LINKUP ? '+' : '-',
             PcieGprSts & BM1000_PCIE_GPR_STS_RDLH_LINKUP ? '+' : '-',
@@ -1391,6 +1897,7 @@ PciHostBridgeLibConstructor (
             ));
 
           MmioAnd32 (BM1000_PCIE_GPR_GEN (PcieIdx), ~BM1000_PCIE_GPR_GEN_LTSSM_EN);
+          ++mPcieLinkStats.Ports[PcieIdx].Retrains;
 
           // Assert PERST pin
           if (PciePerstGpios[PcieIdx] >= 0 &&
@@ -1428,8 +1935,29 @@ PciHostBridgeLibConstructor (
           }
         }
       }
+
+      if (LinkState[PcieIdx] == PcieLinkStateCfgWait) {
+        // Wait until device starts responding to cfg requests
+        if (MmioRead32 (mPcieCfgBases[PcieIdx] + SIZE_1MB) == 0 &&
+            Elapsed <= PCIE_LINK_CFG_TIMEOUT_NS) {
+          MmioWrite32 (mPcieCfgBases[PcieIdx] + SIZE_1MB, 0xffffffff);
+        } else {
+          PciHostBridgeLibCheckCfg0Filter (PcieIdx, Elapsed);
+          LinkState[PcieIdx] = PcieLinkStateDone;
+          mPcieLinkStats.Ports[PcieIdx].CfgWaitUs = Elapsed / 1000 - mPcieLinkStats.Ports[PcieIdx].LinkUpUs;
+          continue;
+        }
+      }
+
+      Pending = TRUE;
     }
-  }
+
+    if (Pending) {
+      gBS->Stall (PCIE_LINK_POLL_US);
+    }
+  } while (Pending);
+
+  mPcieLinkStats.TrainingUs = (GetTimeInNanoSecond (GetPerformanceCounter ()) - TrainingStart) / 1000;
 
   if (PcdGet32 (PcdAcpiPcieMode) == ACPI_PCIE_ECAM) {
     Status = gBS->CreateEvent (
@@ -1444,9 +1972,46 @@ PciHostBridgeLibConstructor (
     }
   }
 
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    Status = gBS->CreateEventEx (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    PciHostBridgeLibReadyToBoot,
+                    NULL,
+                    &gEfiEventReadyToBootGuid,
+                    &Event
+                    );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   Status = PciConfigInstallHii(SegmentMask);
 
   PciHostBridgeLinkRetrain();
+  PciHostBridgeLibSetLinkMask ();
+
+  //
+  // The mask is published again once enumeration is complete, at TPL_NOTIFY
+  // so that it is up to date before the TPL_CALLBACK notify of
+  // AcpiPlatformDxe builds the tables from it
+  //
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  PciHostBridgeLibEnumerationComplete,
+                  NULL,
+                  &Event
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->RegisterProtocolNotify (
+                  &gEfiPciEnumerationCompleteProtocolGuid,
+                  Event,
+                  &mPcieRegistration
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  PciHostBridgeLibSaveTopology ();
+  PciHostBridgeLibSaveLinkStats ();
 
   return EFI_SUCCESS;
 }
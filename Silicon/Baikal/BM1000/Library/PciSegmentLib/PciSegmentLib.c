@@ -6,9 +6,14 @@
 #include <Base.h>
 #include <Library/ArmLib.h>
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/IoLib.h>
+#include <Library/PcdLib.h>
 #include <Library/PciSegmentLib.h>
+#include <Library/TimerLib.h>
+
+#include <PcieSegment.h>
 
 typedef enum {
   PciCfgWidthUint8,
@@ -17,6 +22,37 @@ typedef enum {
   PciCfgWidthMax
 } PCI_CFG_WIDTH;
 
+//
+// Config access profile (PcdPciCfgTrace). Accesses are accounted per
+// segment/bus/device/function, latencies are in performance counter ticks
+// and include the address decode. Buffer accesses are counted once, under
+// PciCfgWidthMax. A read that returns all ones is counted as absent even
+// when the link is up, as that is how a missing function answers.
+//
+#define PCI_CFG_TRACE_MAX_DEVICES  256
+#define PCI_CFG_TRACE_KEY(Address) \
+  ((UINT32)((((Address) >> 32) & 0xFFFF) << 16) | (UINT32)(((Address) >> 12) & 0xFFFF))
+
+typedef struct {
+  UINT32  Key;
+  UINT32  Reserved;
+  UINT64  Count;
+  UINT64  Absent;
+  UINT64  Ticks;
+} PCI_CFG_TRACE_DEVICE;
+
+typedef struct {
+  UINT64                Count[PciCfgWidthMax + 1];
+  UINT64                Absent;     // Accesses that found no link or no function
+  UINT64                Ticks;
+  UINT64                Dropped;    // Accesses with no free device slot
+  UINTN                 DeviceCount;
+  UINTN                 DeviceLast;
+  PCI_CFG_TRACE_DEVICE  Devices[PCI_CFG_TRACE_MAX_DEVICES];
+} PCI_CFG_TRACE;
+
+STATIC PCI_CFG_TRACE  mPciCfgTrace;
+
 /**
   Assert the validity of a PCI Segment address.
   A valid PCI Segment address should not contain 1's in bits 28..31 and 48..63
@@ -26,11 +62,52 @@ typedef enum {
 #define ASSERT_INVALID_PCI_SEGMENT_ADDRESS(A,M) \
   ASSERT (((A) & (0xFFFF0000F0000000ULL | (M))) == 0)
 
+//
+// Every config access beyond the root port checks the link of its segment,
+// as a cycle to a link that has dropped may stall. The LTSSM is read at most
+// this often per segment and the cached state is used in between.
+//
+#define PCI_SEGMENT_LINK_CHECK_US  1000
+
+STATIC UINT64  mPciSegmentLinkCheckTicks;
+
 BOOLEAN
 PciHostBridgeLibGetLink (
   IN  CONST UINTN  PcieIdx
   );
 
+extern PCIE_SEGMENT_DESC  mPcieSegments[];
+
+/**
+  Ask the hardware for the link state of a segment unless that was done
+  less than PCI_SEGMENT_LINK_CHECK_US ago.
+  @param  Segment The segment to check.
+  @return The link state of the segment.
+**/
+STATIC
+BOOLEAN
+PciSegmentLibCheckLink (
+  IN  UINTN  Segment
+  )
+{
+  PCIE_SEGMENT_DESC  *CONST  Desc = &mPcieSegments[Segment];
+  CONST UINT64               Now  = GetPerformanceCounter ();
+
+  if (mPciSegmentLinkCheckTicks == 0) {
+    mPciSegmentLinkCheckTicks = DivU64x32 (
+                                  MultU64x32 (GetPerformanceCounterProperties (NULL, NULL), PCI_SEGMENT_LINK_CHECK_US),
+                                  1000000
+                                  );
+  }
+
+  if (Now - Desc->LinkChecked >= mPciSegmentLinkCheckTicks) {
+    Desc->LinkChecked = Now;
+    Desc->LinkUp      = PciHostBridgeLibGetLink (Segment);
+  }
+
+  return Desc->LinkUp;
+}
+
 STATIC
 UINT64
 PciSegmentLibGetConfigBase (
@@ -41,30 +118,187 @@ PciSegmentLibGetConfigBase (
   CONST UINTN  Bus      = (PciSegLibAddr >> 20) & 0xFF;
   CONST UINTN  Device   = (PciSegLibAddr >> 15) & 0x1F;
   CONST UINTN  Function = (PciSegLibAddr >> 12) & 0x7;
-  extern EFI_PHYSICAL_ADDRESS  mPcieCfgBases[];
-  extern EFI_PHYSICAL_ADDRESS  mPcieDbiBases[];
+  PCIE_SEGMENT_DESC  *CONST  Desc = &mPcieSegments[Segment];
+
+  // The controllers disabled in the FDT have no segment
+  if (Desc->DbiBase == 0) {
+    return MAX_UINT64;
+  }
 
   if (Bus == 0) {
     if (Device == 0) { // DBI access
-      return mPcieDbiBases[Segment];
+      return Desc->DbiBase;
     } else { // Must not access beyond RCB:0.0
       return MAX_UINT64;
     }
-  } else if (Bus == 1) {
-    if (Device == 0) {
-      if (PciHostBridgeLibGetLink (Segment)) {
-        return mPcieCfgBases[Segment] + (Bus << 20) + (Device << 15) + (Function << 12);
-      } else {
-        return MAX_UINT64;
+  }
+
+  if (Bus > Desc->BusMax || (Bus == 1 && Device != 0)) {
+    return MAX_UINT64;
+  }
+
+  //
+  // The link may have come up since PciHostBridgeLib trained it, or may have
+  // dropped since the last access
+  //
+  if (!PciSegmentLibCheckLink (Segment)) {
+    return MAX_UINT64;
+  }
+
+  return Desc->CfgBase + (Bus << 20) + (Device << 15) + (Function << 12);
+}
+
+/**
+  Recheck the link of a segment after a config read returned all ones,
+  which is what a dropped link looks like, so that further accesses are not
+  issued to it.
+  @param  Address The address of the config read.
+**/
+STATIC
+VOID
+PciSegmentLibRefreshLink (
+  IN  UINT64  Address
+  )
+{
+  if (((Address >> 20) & 0xFF) != 0) {
+    PciSegmentLibCheckLink ((Address >> 32) & 0xFFFF);
+  }
+}
+
+/**
+  Account one config access in the profile.
+  @param  Address The address of the access.
+  @param  Width   The width of the access, PciCfgWidthMax for a buffer.
+  @param  Start   The performance counter when the access started.
+  @param  Absent  TRUE if the access did not reach a function.
+**/
+STATIC
+VOID
+PciSegmentLibTrace (
+  IN  UINT64         Address,
+  IN  PCI_CFG_WIDTH  Width,
+  IN  UINT64         Start,
+  IN  BOOLEAN        Absent
+  )
+{
+  CONST UINT32           Key   = PCI_CFG_TRACE_KEY (Address);
+  CONST UINT64           Ticks = GetPerformanceCounter () - Start;
+  PCI_CFG_TRACE_DEVICE  *Device;
+  UINTN                  Idx;
+
+  mPciCfgTrace.Count[Width]++;
+  mPciCfgTrace.Ticks += Ticks;
+  if (Absent) {
+    mPciCfgTrace.Absent++;
+  }
+
+  // Enumeration and drivers tend to hit the same function many times in a row
+  Idx = mPciCfgTrace.DeviceLast;
+  if (Idx >= mPciCfgTrace.DeviceCount || mPciCfgTrace.Devices[Idx].Key != Key) {
+    for (Idx = 0; Idx < mPciCfgTrace.DeviceCount; ++Idx) {
+      if (mPciCfgTrace.Devices[Idx].Key == Key) {
+        break;
       }
-    } else {
-      return MAX_UINT64;
     }
-  } else {
-    if (PciHostBridgeLibGetLink (Segment)) {
-      return mPcieCfgBases[Segment] + (Bus << 20) + (Device << 15) + (Function << 12);
-    } else {
-      return MAX_UINT64;
+
+    if (Idx == mPciCfgTrace.DeviceCount) {
+      if (Idx == PCI_CFG_TRACE_MAX_DEVICES) {
+        mPciCfgTrace.Dropped++;
+        return;
+      }
+
+      mPciCfgTrace.Devices[Idx].Key = Key;
+      ++mPciCfgTrace.DeviceCount;
+    }
+
+    mPciCfgTrace.DeviceLast = Idx;
+  }
+
+  Device = &mPciCfgTrace.Devices[Idx];
+  Device->Count++;
+  Device->Ticks += Ticks;
+  if (Absent) {
+    Device->Absent++;
+  }
+}
+
+/**
+  Print the config access profile to the debug log, one line per device
+  sorted by segment, bus and device, with a subtotal for every segment.
+**/
+VOID
+PciSegmentLibTraceDump (
+  VOID
+  )
+{
+  PCI_CFG_TRACE_DEVICE  Tmp;
+  UINTN                 Idx;
+  UINTN                 Jdx;
+  UINT64                SegCount;
+  UINT64                SegAbsent;
+  UINT64                SegTicks;
+  PCI_CFG_TRACE_DEVICE  *Device;
+
+  if (!FeaturePcdGet (PcdPciCfgTrace)) {
+    return;
+  }
+
+  for (Idx = 1; Idx < mPciCfgTrace.DeviceCount; ++Idx) {
+    Tmp = mPciCfgTrace.Devices[Idx];
+    for (Jdx = Idx; Jdx > 0 && mPciCfgTrace.Devices[Jdx - 1].Key > Tmp.Key; --Jdx) {
+      mPciCfgTrace.Devices[Jdx] = mPciCfgTrace.Devices[Jdx - 1];
+    }
+
+    mPciCfgTrace.Devices[Jdx] = Tmp;
+  }
+
+  DEBUG ((
+    EFI_D_INFO,
+    "PciCfgTrace: %lu accesses (8-bit %lu, 16-bit %lu, 32-bit %lu, buffer %lu), %lu us, %lu absent, %lu unaccounted\n",
+    mPciCfgTrace.Count[PciCfgWidthUint8] + mPciCfgTrace.Count[PciCfgWidthUint16] +
+    mPciCfgTrace.Count[PciCfgWidthUint32] + mPciCfgTrace.Count[PciCfgWidthMax],
+    mPciCfgTrace.Count[PciCfgWidthUint8],
+    mPciCfgTrace.Count[PciCfgWidthUint16],
+    mPciCfgTrace.Count[PciCfgWidthUint32],
+    mPciCfgTrace.Count[PciCfgWidthMax],
+    GetTimeInNanoSecond (mPciCfgTrace.Ticks) / 1000,
+    mPciCfgTrace.Absent,
+    mPciCfgTrace.Dropped
+    ));
+
+  SegCount  = 0;
+  SegAbsent = 0;
+  SegTicks  = 0;
+  for (Idx = 0; Idx < mPciCfgTrace.DeviceCount; ++Idx) {
+    Device = &mPciCfgTrace.Devices[Idx];
+    DEBUG ((
+      EFI_D_INFO,
+      "PciCfgTrace:   %04x:%02x:%02x.%x  %8lu accesses  %8lu us  %8lu absent\n",
+      Device->Key >> 16,
+      (Device->Key >> 8) & 0xFF,
+      (Device->Key >> 3) & 0x1F,
+      Device->Key & 0x7,
+      Device->Count,
+      GetTimeInNanoSecond (Device->Ticks) / 1000,
+      Device->Absent
+      ));
+
+    SegCount  += Device->Count;
+    SegAbsent += Device->Absent;
+    SegTicks  += Device->Ticks;
+    if (Idx + 1 == mPciCfgTrace.DeviceCount ||
+        (mPciCfgTrace.Devices[Idx + 1].Key >> 16) != (Device->Key >> 16)) {
+      DEBUG ((
+        EFI_D_INFO,
+        "PciCfgTrace: %04x           %8lu accesses  %8lu us  %8lu absent\n",
+        Device->Key >> 16,
+        SegCount,
+        GetTimeInNanoSecond (SegTicks) / 1000,
+        SegAbsent
+        ));
+      SegCount  = 0;
+      SegAbsent = 0;
+      SegTicks  = 0;
     }
   }
 }
@@ -83,24 +317,47 @@ PciSegmentLibReadWorker (
   IN  PCI_CFG_WIDTH               Width
   )
 {
-  CONST UINT64  Base = PciSegmentLibGetConfigBase (Address);
+  CONST UINT64  Start = FeaturePcdGet (PcdPciCfgTrace) ? GetPerformanceCounter () : 0;
+  CONST UINT64  Base  = PciSegmentLibGetConfigBase (Address);
+  UINT32        Value;
+  BOOLEAN       Absent;
 
   if (Base == MAX_UINT64) {
+    if (FeaturePcdGet (PcdPciCfgTrace)) {
+      PciSegmentLibTrace (Address, Width, Start, TRUE);
+    }
+
     return MAX_UINT32;
   }
 
   switch (Width) {
   case PciCfgWidthUint8:
-    return MmioRead8 (Base + (Address & 0xFFF));
+    Value  = MmioRead8 (Base + (Address & 0xFFF));
+    Absent = Value == MAX_UINT8;
+    break;
   case PciCfgWidthUint16:
-    return MmioRead16 (Base + (Address & 0xFFF));
+    Value  = MmioRead16 (Base + (Address & 0xFFF));
+    Absent = Value == MAX_UINT16;
+    break;
   case PciCfgWidthUint32:
-    return MmioRead32 (Base + (Address & 0xFFF));
+    Value  = MmioRead32 (Base + (Address & 0xFFF));
+    Absent = Value == MAX_UINT32;
+    break;
   default:
     ASSERT (FALSE);
+    Value  = 0;
+    Absent = FALSE;
+  }
+
+  if (Absent) {
+    PciSegmentLibRefreshLink (Address);
+  }
+
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    PciSegmentLibTrace (Address, Width, Start, Absent);
   }
 
-  return 0;
+  return Value;
 }
 
 /**
@@ -119,9 +376,14 @@ PciSegmentLibWriteWorker (
   IN  UINT32                      Data
   )
 {
-  CONST UINT64  Base = PciSegmentLibGetConfigBase (Address);
+  CONST UINT64  Start = FeaturePcdGet (PcdPciCfgTrace) ? GetPerformanceCounter () : 0;
+  CONST UINT64  Base  = PciSegmentLibGetConfigBase (Address);
 
   if (Base == MAX_UINT64) {
+    if (FeaturePcdGet (PcdPciCfgTrace)) {
+      PciSegmentLibTrace (Address, Width, Start, TRUE);
+    }
+
     return MAX_UINT32;
   }
 
@@ -139,6 +401,10 @@ PciSegmentLibWriteWorker (
     ASSERT (FALSE);
   }
 
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    PciSegmentLibTrace (Address, Width, Start, FALSE);
+  }
+
   return Data;
 }
 
@@ -1073,6 +1339,9 @@ PciSegmentReadBuffer (
   )
 {
   UINTN                             ReturnValue;
+  UINT64                            Start;
+  UINT64                            Base;
+  UINT64                            Reg;
 
   ASSERT_INVALID_PCI_SEGMENT_ADDRESS (StartAddress, 0);
   ASSERT (((StartAddress & 0xFFF) + Size) <= 0x1000);
@@ -1088,22 +1357,39 @@ PciSegmentReadBuffer (
   //
   ReturnValue = Size;
 
-  if ((StartAddress & BIT0) != 0) {
+  //
+  // The range lies within one function: decode it once and access the
+  // registers directly
+  //
+  Start = FeaturePcdGet (PcdPciCfgTrace) ? GetPerformanceCounter () : 0;
+  Base  = PciSegmentLibGetConfigBase (StartAddress);
+  if (Base == MAX_UINT64) {
+    SetMem (Buffer, Size, 0xFF);
+    if (FeaturePcdGet (PcdPciCfgTrace)) {
+      PciSegmentLibTrace (StartAddress, PciCfgWidthMax, Start, TRUE);
+    }
+
+    return ReturnValue;
+  }
+
+  Reg = Base + (StartAddress & 0xFFF);
+
+  if ((Reg & BIT0) != 0) {
     //
     // Read a byte if StartAddress is byte aligned
     //
-    *(volatile UINT8 *)Buffer = PciSegmentRead8 (StartAddress);
-    StartAddress += sizeof (UINT8);
+    *(volatile UINT8 *)Buffer = MmioRead8 (Reg);
+    Reg += sizeof (UINT8);
     Size -= sizeof (UINT8);
     Buffer = (UINT8*)Buffer + 1;
   }
 
-  if (Size >= sizeof (UINT16) && (StartAddress & BIT1) != 0) {
+  if (Size >= sizeof (UINT16) && (Reg & BIT1) != 0) {
     //
     // Read a word if StartAddress is word aligned
     //
-    WriteUnaligned16 (Buffer, PciSegmentRead16 (StartAddress));
-    StartAddress += sizeof (UINT16);
+    WriteUnaligned16 (Buffer, MmioRead16 (Reg));
+    Reg += sizeof (UINT16);
     Size -= sizeof (UINT16);
     Buffer = (UINT16*)Buffer + 1;
   }
@@ -1112,8 +1398,8 @@ PciSegmentReadBuffer (
     //
     // Read as many double words as possible
     //
-    WriteUnaligned32 (Buffer, PciSegmentRead32 (StartAddress));
-    StartAddress += sizeof (UINT32);
+    WriteUnaligned32 (Buffer, MmioRead32 (Reg));
+    Reg += sizeof (UINT32);
     Size -= sizeof (UINT32);
     Buffer = (UINT32*)Buffer + 1;
   }
@@ -1122,8 +1408,8 @@ PciSegmentReadBuffer (
     //
     // Read the last remaining word if exist
     //
-    WriteUnaligned16 (Buffer, PciSegmentRead16 (StartAddress));
-    StartAddress += sizeof (UINT16);
+    WriteUnaligned16 (Buffer, MmioRead16 (Reg));
+    Reg += sizeof (UINT16);
     Size -= sizeof (UINT16);
     Buffer = (UINT16*)Buffer + 1;
   }
@@ -1132,7 +1418,11 @@ PciSegmentReadBuffer (
     //
     // Read the last remaining byte if exist
     //
-    *(volatile UINT8 *)Buffer = PciSegmentRead8 (StartAddress);
+    *(volatile UINT8 *)Buffer = MmioRead8 (Reg);
+  }
+
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    PciSegmentLibTrace (StartAddress, PciCfgWidthMax, Start, FALSE);
   }
 
   return ReturnValue;
@@ -1167,6 +1457,9 @@ PciSegmentWriteBuffer (
   )
 {
   UINTN                             ReturnValue;
+  UINT64                            Start;
+  UINT64                            Base;
+  UINT64                            Reg;
 
   ASSERT_INVALID_PCI_SEGMENT_ADDRESS (StartAddress, 0);
   ASSERT (((StartAddress & 0xFFF) + Size) <= 0x1000);
@@ -1182,22 +1475,38 @@ PciSegmentWriteBuffer (
   //
   ReturnValue = Size;
 
-  if ((StartAddress & BIT0) != 0) {
+  //
+  // The range lies within one function: decode it once and access the
+  // registers directly
+  //
+  Start = FeaturePcdGet (PcdPciCfgTrace) ? GetPerformanceCounter () : 0;
+  Base  = PciSegmentLibGetConfigBase (StartAddress);
+  if (Base == MAX_UINT64) {
+    if (FeaturePcdGet (PcdPciCfgTrace)) {
+      PciSegmentLibTrace (StartAddress, PciCfgWidthMax, Start, TRUE);
+    }
+
+    return ReturnValue;
+  }
+
+  Reg = Base + (StartAddress & 0xFFF);
+
+  if ((Reg & BIT0) != 0) {
     //
     // Write a byte if StartAddress is byte aligned
     //
-    PciSegmentWrite8 (StartAddress, *(UINT8*)Buffer);
-    StartAddress += sizeof (UINT8);
+    MmioWrite8 (Reg, *(UINT8*)Buffer);
+    Reg += sizeof (UINT8);
     Size -= sizeof (UINT8);
     Buffer = (UINT8*)Buffer + 1;
   }
 
-  if (Size >= sizeof (UINT16) && (StartAddress & BIT1) != 0) {
+  if (Size >= sizeof (UINT16) && (Reg & BIT1) != 0) {
     //
     // Write a word if StartAddress is word aligned
     //
-    PciSegmentWrite16 (StartAddress, ReadUnaligned16 (Buffer));
-    StartAddress += sizeof (UINT16);
+    MmioWrite16 (Reg, ReadUnaligned16 (Buffer));
+    Reg += sizeof (UINT16);
     Size -= sizeof (UINT16);
     Buffer = (UINT16*)Buffer + 1;
   }
@@ -1206,8 +1515,8 @@ PciSegmentWriteBuffer (
     //
     // Write as many double words as possible
     //
-    PciSegmentWrite32 (StartAddress, ReadUnaligned32 (Buffer));
-    StartAddress += sizeof (UINT32);
+    MmioWrite32 (Reg, ReadUnaligned32 (Buffer));
+    Reg += sizeof (UINT32);
     Size -= sizeof (UINT32);
     Buffer = (UINT32*)Buffer + 1;
   }
@@ -1216,8 +1525,8 @@ PciSegmentWriteBuffer (
     //
     // Write the last remaining word if exist
     //
-    PciSegmentWrite16 (StartAddress, ReadUnaligned16 (Buffer));
-    StartAddress += sizeof (UINT16);
+    MmioWrite16 (Reg, ReadUnaligned16 (Buffer));
+    Reg += sizeof (UINT16);
     Size -= sizeof (UINT16);
     Buffer = (UINT16*)Buffer + 1;
   }
@@ -1226,7 +1535,11 @@ PciSegmentWriteBuffer (
     //
     // Write the last remaining byte if exist
     //
-    PciSegmentWrite8 (StartAddress, *(UINT8*)Buffer);
+    MmioWrite8 (Reg, *(UINT8*)Buffer);
+  }
+
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    PciSegmentLibTrace (StartAddress, PciCfgWidthMax, Start, FALSE);
   }
 
   return ReturnValue;
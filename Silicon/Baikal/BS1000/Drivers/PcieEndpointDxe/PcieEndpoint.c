@@ -51,7 +51,6 @@ STATIC CONST EFI_PHYSICAL_ADDRESS  mPcieDbiBaseList[] = {
   BS1000_PCIE4_P3_DBI_BASE
 };
 
-#if !defined(MDEPKG_NDEBUG)
 STATIC CONST UINTN  mPcieDbiSizeList[] = {
   BS1000_PCIE0_P0_DBI_SIZE,
   BS1000_PCIE0_P1_DBI_SIZE,
@@ -68,18 +67,15 @@ STATIC CONST UINTN  mPcieDbiSizeList[] = {
   BS1000_PCIE4_P2_DBI_SIZE,
   BS1000_PCIE4_P3_DBI_SIZE
 };
-#endif
 
 STATIC_ASSERT (
   ARRAY_SIZE (mPcieApbBaseList) == ARRAY_SIZE (mPcieDbiBaseList),
   "ARRAY_SIZE (mPcieApbBaseList) != ARRAY_SIZE (mPcieDbiBaseList)"
   );
-#if !defined(MDEPKG_NDEBUG)
 STATIC_ASSERT (
   ARRAY_SIZE (mPcieDbiSizeList) == ARRAY_SIZE (mPcieDbiBaseList),
   "ARRAY_SIZE (mPcieDbiSizeList) != ARRAY_SIZE (mPcieDbiBaseList)"
   );
-#endif
 
 EFI_STATUS
 EFIAPI
@@ -96,9 +92,8 @@ PcieEndpointEntryPoint (
   ASSERT_EFI_ERROR (Status);
 
   while (TRUE) {
-    INTN         ApbRegIdx = -1, DbiRegIdx = -1;
-    CONST VOID  *Prop;
-    UINT32       PropSize;
+    CONST FDT_CLIENT_REG  *ApbReg;
+    CONST FDT_CLIENT_REG  *DbiReg;
 
     Status = FdtClient->FindNextCompatibleNode (FdtClient, "baikal,bs1000-pcie-ep", Node, &Node);
     if (EFI_ERROR (Status)) {
@@ -109,50 +104,17 @@ PcieEndpointEntryPoint (
       continue;
     }
 
-    if (FdtClient->GetNodeProperty (FdtClient, Node, "reg-names", &Prop, &PropSize) == EFI_SUCCESS &&
-        PropSize > 0) {
-      UINTN         RegIdx;
-      CONST CHAR8  *StrPtr = Prop;
-
-      for (RegIdx = 0; PropSize > 0; ++RegIdx) {
-        CONST UINTN  StrSize = AsciiStrSize (StrPtr);
-
-        ASSERT (StrSize <= PropSize);
-
-        if (AsciiStrCmp (StrPtr, "dbi") == 0) {
-          DbiRegIdx = RegIdx;
-        } else if (AsciiStrCmp (StrPtr, "apb") == 0) {
-          ApbRegIdx = RegIdx;
-        }
-
-        PropSize -= StrSize;
-        StrPtr   += StrSize;
-      }
-
-      if (ApbRegIdx == -1 || DbiRegIdx == -1) {
-        continue;
-      }
-    } else {
-      continue;
-    }
-
-    if (FdtClient->GetNodeProperty (FdtClient, Node, "reg", &Prop, &PropSize) == EFI_SUCCESS &&
-        PropSize >= 48 && (PropSize % 16) == 0) {
-      CONST EFI_PHYSICAL_ADDRESS  ApbBase = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) Prop + ApbRegIdx * 2));
-      CONST EFI_PHYSICAL_ADDRESS  DbiBase = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) Prop + DbiRegIdx * 2));
-#if !defined(MDEPKG_NDEBUG)
-      CONST UINTN                 ApbSize = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) Prop + ApbRegIdx * 2 + 1));
-      CONST UINTN                 DbiSize = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) Prop + DbiRegIdx * 2 + 1));
-#endif
-      UINTN  ListIdx;
+    if (FdtClient->GetNodeRegByName (FdtClient, Node, "apb", &ApbReg) == EFI_SUCCESS &&
+        FdtClient->GetNodeRegByName (FdtClient, Node, "dbi", &DbiReg) == EFI_SUCCESS) {
+      CONST EFI_PHYSICAL_ADDRESS  ApbBase = ApbReg->Address;
+      CONST EFI_PHYSICAL_ADDRESS  DbiBase = DbiReg->Address;
+      UINTN                       ListIdx;
 
       for (ListIdx = 0; ListIdx < ARRAY_SIZE (mPcieDbiBaseList); ++ListIdx) {
         if (PLATFORM_ADDR_IN_CHIP(DbiBase) == mPcieDbiBaseList[ListIdx]) {
           ASSERT (PLATFORM_ADDR_IN_CHIP(ApbBase) == mPcieApbBaseList[ListIdx]);
-#if !defined(MDEPKG_NDEBUG)
-          ASSERT (ApbSize == 0x100);
-          ASSERT (DbiSize == mPcieDbiSizeList[ListIdx]);
-#endif
+          ASSERT (ApbReg->Size == 0x100);
+          ASSERT (DbiReg->Size == mPcieDbiSizeList[ListIdx]);
           MmioOr32 (
             ApbBase +
             BS1000_PCIE_APB_PE_GEN_CTRL3,
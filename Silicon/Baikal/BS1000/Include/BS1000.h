@@ -227,10 +227,29 @@
 #define BS1000_PCIE1_P1_MMIO_BASE       0x7C000000000
 #define BS1000_PCIE1_P1_MMIO_SIZE       SIZE_256GB
 
+// Default 64-bit prefetchable window: the part of an RC MMIO region above the CFG/IO/MEM32 windows
+#define BS1000_PCIE_PMEM64_OFFSET       SIZE_8GB
+
 #define BS1000_CORE_COUNT               48
 #define BS1000_CLUSTER_COUNT            12
 #define BS1000_CORE_COUNT_PER_CLUSTER   4
 
+// Cache hierarchy of one chip (CacheInfoLib.h), in SMBIOS Type 7 handle order
+#define BS1000_CACHE_L1I                0
+#define BS1000_CACHE_L1D                1
+#define BS1000_CACHE_L2                 2
+#define BS1000_CACHE_L3                 3
+#define BS1000_CACHE_L4                 4
+#define BS1000_CACHE_COUNT              5
+
+#define BS1000_CACHE_INFO  {                                                                  \
+  CACHE_INFO_DEFAULT (1, CACHE_INFO_TYPE_INSTRUCTION, CACHE_INFO_SCOPE_CORE,    SIZE_64KB,  4), \
+  CACHE_INFO_DEFAULT (1, CACHE_INFO_TYPE_DATA,        CACHE_INFO_SCOPE_CORE,    SIZE_64KB, 16), \
+  CACHE_INFO_DEFAULT (2, CACHE_INFO_TYPE_UNIFIED,     CACHE_INFO_SCOPE_CORE,    SIZE_512KB, 8), \
+  CACHE_INFO_DEFAULT (3, CACHE_INFO_TYPE_UNIFIED,     CACHE_INFO_SCOPE_CLUSTER, SIZE_2MB,  16), \
+  CACHE_INFO_DEFAULT (4, CACHE_INFO_TYPE_UNIFIED,     CACHE_INFO_SCOPE_PACKAGE, SIZE_32MB, 16)  \
+}
+
 #define BS1000_GIC_ITS_COUNT            16
 
 #define BS1000_DIMM_COUNT               12
@@ -4,18 +4,25 @@
 **/
 
 #include <Library/ArmLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/GpioLib.h>
 #include <Library/IoLib.h>
 #include <Library/MemoryAllocationLib.h>
+#include <Library/PcdLib.h>
 #include <Library/PciHostBridgeLib.h>
 #include <Library/TimerLib.h>
 #include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiRuntimeServicesTableLib.h>
+#include <Guid/EventGroup.h>
+#include <Guid/PcieTopology.h>
 #include <Protocol/FdtClient.h>
+#include <Protocol/PciEnumerationComplete.h>
 #include <Protocol/PciHostBridgeResourceAllocation.h>
 
 #include <BS1000.h>
+#include <PcieSegment.h>
 
 #define BS1000_PCIE_APB_PE_GEN_CTRL3                   0x58
 #define BS1000_PCIE_APB_PE_GEN_CTRL3_LTSSM_EN          BIT0
@@ -61,6 +68,7 @@
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_IO            2
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_CFG0          4
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_CFG1          5
+#define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_INCREASE_SIZE      BIT13
 
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_2_OFF_OUTBOUND_0                    0x300004
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_2_OFF_OUTBOUND_0_CFG_SHIFT_MODE     BIT28
@@ -71,6 +79,7 @@
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_LIMIT_ADDR_OFF_OUTBOUND_0                       0x300010
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_LWR_TARGET_ADDR_OFF_OUTBOUND_0                  0x300014
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_UPPER_TARGET_ADDR_OFF_OUTBOUND_0                0x300018
+#define BS1000_PCIE_PF0_ATU_CAP_IATU_UPPER_LIMIT_ADDR_OFF_OUTBOUND_0                 0x300020
 #define BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_SIZE                                     0x200
 
 #define BS1000_PCIE_CAP_PM_OFF          0x40
@@ -78,8 +87,31 @@
 #define BS1000_PCIE_CAP_PCIE_OFF        0x70
 #define BS1000_PCIE_CAP_MSIX_OFF        0xB0
 
-#define RANGES_FLAG_IO   0x01000000
-#define RANGES_FLAG_MEM  0x02000000
+#define RANGES_FLAG_SPACE_MASK  0x03000000
+#define RANGES_FLAG_IO          0x01000000
+#define RANGES_FLAG_MEM         0x02000000
+#define RANGES_FLAG_MEM64       0x03000000
+#define RANGES_FLAG_PREFETCH    0x40000000
+
+#define PCIE_LINK_DETECT_TIMEOUT_NS  50000000ULL
+#define PCIE_LINK_UP_TIMEOUT_NS      500000000ULL
+#define PCIE_LINK_CFG_TIMEOUT_NS     1000000000ULL
+#define PCIE_LINK_POLL_US            100
+
+typedef enum {
+  PcieLinkStateDetect,
+  PcieLinkStateTraining,
+  PcieLinkStateCfgWait,
+  PcieLinkStateDone
+} PCIE_LINK_STATE;
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  PerstGpioBase;
+  UINTN                 PerstGpio;
+  UINTN                 PerstGpioPolarity;
+  PCIE_LINK_STATE       State;
+  UINT64                TimeStart;
+} PCIE_LINK;
 
 #pragma pack(1)
 typedef struct {
@@ -213,10 +245,25 @@ STATIC_ASSERT (
 STATIC EFI_PHYSICAL_ADDRESS  *mPcieApbBases;
 EFI_PHYSICAL_ADDRESS         *mPcieDbiBases;
 EFI_PHYSICAL_ADDRESS         *mPcieCfgBases;
+PCIE_SEGMENT_DESC            *mPcieSegments;
 STATIC PCI_ROOT_BRIDGE       *mPcieRootBridges;
 STATIC UINTN                 *mPcieSegIds;
+STATIC PCIE_LINK             *mPcieLinks;
 STATIC UINTN                  mPcieRootBridgesNum;
 STATIC UINTN                  mPcieCfg0Quirk;
+STATIC PCIE_PMEM64_WINDOW     mPciePMem64Windows[PCIE_TOPOLOGY_MAX_PORTS];
+STATIC UINT32                 mPcieLinkMask;
+STATIC VOID                  *mPcieRegistration;
+STATIC PCIE_TOPOLOGY          mPcieTopologyPrev;
+STATIC PCIE_TOPOLOGY          mPcieTopology;
+STATIC PCIE_LINK_STATS        mPcieLinkStats;
+
+BOOLEAN PciHostBridgeLibGetLink (UINTN  PcieIdx);
+
+STATIC_ASSERT (
+  ARRAY_SIZE (mPcieDbiBaseList) * PLATFORM_CHIP_COUNT <= PCIE_TOPOLOGY_MAX_PORTS,
+  "ARRAY_SIZE (mPcieDbiBaseList) * PLATFORM_CHIP_COUNT > PCIE_TOPOLOGY_MAX_PORTS"
+  );
 
 STATIC
 VOID
@@ -230,10 +277,11 @@ PciHostBridgeLibCfgWindow (
   IN CONST UINTN                 EnableFlags
   )
 {
-  ASSERT (RegionIdx <= 3);
+  UINTN  Ctrl1;
+
+  ASSERT (RegionIdx <= 5);
   ASSERT (Type <= 0x1F);
   ASSERT (Size >= SIZE_64KB);
-  ASSERT (Size <= SIZE_4GB);
 
   // The addresses must be aligned to 64 KiB
   ASSERT ((CpuBase & (SIZE_64KB - 1)) == 0);
@@ -270,6 +318,19 @@ PciHostBridgeLibCfgWindow (
     (UINT32)(CpuBase + Size - 1)
     );
 
+  //
+  // Regions that cross a 4 GiB boundary need the upper limit register
+  //
+  Ctrl1 = Type;
+  if (((CpuBase + Size - 1) >> 32) != (CpuBase >> 32)) {
+    MmioWrite32 (
+      PcieDbiBase + BS1000_PCIE_PF0_ATU_CAP_IATU_UPPER_LIMIT_ADDR_OFF_OUTBOUND_0 +
+        RegionIdx * BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_SIZE,
+      (UINT32)((CpuBase + Size - 1) >> 32)
+      );
+    Ctrl1 |= BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_INCREASE_SIZE;
+  }
+
   MmioWrite32 (
     PcieDbiBase + BS1000_PCIE_PF0_ATU_CAP_IATU_LWR_TARGET_ADDR_OFF_OUTBOUND_0 +
       RegionIdx * BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_SIZE,
@@ -285,7 +346,7 @@ PciHostBridgeLibCfgWindow (
   MmioWrite32 (
     PcieDbiBase + BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0 +
       RegionIdx * BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_SIZE,
-    Type
+    Ctrl1
     );
 
   MmioWrite32 (
@@ -295,181 +356,6 @@ PciHostBridgeLibCfgWindow (
     );
 }
 
-STATIC
-VOID
-PciHostBridgeLibRootBridgeLinkUp (
-  IN CONST UINTN  PcieIdx,
-  IN EFI_PHYSICAL_ADDRESS PerstGpioBase,
-  IN INTN                 PerstGpio,
-  IN INTN                 PerstGpioPolarity
-  )
-{
-  BOOLEAN  ComponentExists = FALSE;
-  UINT64   TimeStart;
-
-  if (PerstGpioBase) {
-    if (PerstGpioPolarity) {
-      GpioOutRst (PerstGpioBase, PerstGpio);
-    } else {
-      GpioOutSet (PerstGpioBase, PerstGpio);
-    }
-    GpioDirSet (PerstGpioBase, PerstGpio);
-
-    gBS->Stall (1000);
-
-    if (PerstGpioPolarity) {
-      GpioOutSet (PerstGpioBase, PerstGpio);
-    } else {
-      GpioOutRst (PerstGpioBase, PerstGpio);
-    }
-    GpioDirSet (PerstGpioBase, PerstGpio);
-  }
-
-  MmioOr32 (
-    mPcieApbBases[PcieIdx] +
-    BS1000_PCIE_APB_PE_GEN_CTRL3,
-    BS1000_PCIE_APB_PE_GEN_CTRL3_LTSSM_EN
-    );
-
-  MmioOr32 (
-    mPcieDbiBases[PcieIdx] +
-    BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG,
-    BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
-    );
-
-  // Wait for link
-  TimeStart = GetTimeInNanoSecond (GetPerformanceCounter ());
-  for (;;) {
-    CONST UINT32  PcieApbPeLinkDbg2 = MmioRead32 (mPcieApbBases[PcieIdx] + BS1000_PCIE_APB_PE_LINK_DBG2);
-    UINT64        PerformanceCounter = GetPerformanceCounter ();
-
-    if (!ComponentExists) {
-      if ((PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK) > 0x1) {
-        ComponentExists = TRUE;
-        DEBUG ((
-          EFI_D_INFO,
-          "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link partner detected\n",
-          PcieIdx,
-          mPcieDbiBases[PcieIdx],
-          (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-'
-          ));
-      } else if (GetTimeInNanoSecond (PerformanceCounter) - TimeStart > 50000000) {
-        // According to PCI Express Base Specification device must enter LTSSM detect state within 20 ms of reset
-        break;
-      }
-    }
-
-    if (ComponentExists) {
-      if (((PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK) ==
-                                BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_L0) &&
-           (PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP) &&
-           (PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP)) {
-#if !defined(MDEPKG_NDEBUG)
-        CONST UINT32  PcieLnkStat = MmioRead32 (
-                                      mPcieDbiBases[PcieIdx] +
-                                      BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG
-                                      );
-        CONST CHAR8  *LinkSpeedString;
-        CONST UINTN   LinkSpeedVector = (PcieLnkStat &
-                                          BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_BITS) >>
-                                          BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_SHIFT;
-        if (LinkSpeedVector == 1) {
-          LinkSpeedString = "2.5";
-        } else if (LinkSpeedVector == 2) {
-          LinkSpeedString = "5.0";
-        } else if (LinkSpeedVector == 3) {
-          LinkSpeedString = "8.0";
-        } else if (LinkSpeedVector == 4) {
-          LinkSpeedString = "16.0";
-        } else {
-          LinkSpeedString = "???";
-        }
-
-        DEBUG ((
-          EFI_D_INFO,
-          "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link %a GT/s, x%u",
-          PcieIdx,
-          mPcieDbiBases[PcieIdx],
-          (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-',
-          LinkSpeedString,
-          (PcieLnkStat & BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_BITS) >>
-            BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_SHIFT
-          ));
-#endif
-        // Wait until device starts responding to cfg requests
-        while (MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)) == 0) {
-          PerformanceCounter = GetPerformanceCounter ();
-          MmioWrite32(mPcieCfgBases[PcieIdx] + (1 << 20), 0xffffffff);
-          gBS->Stall (1000);
-          if (((GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000) > 1000) {
-            break;
-          }
-        }
-
-        if (MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)) != 0xFFFFFFFF &&
-            MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0x8000) == 0xFFFFFFFF) {
-          //
-          // Device appears to filter CFG0 requests, so the 64 KiB granule for the iATU
-          // isn't a problem. We don't have to ignore fn > 0 or shift MCFG by 0x8000.
-          //
-#if !defined(MDEPKG_NDEBUG)
-          DEBUG ((EFI_D_INFO, ", Cfg0Filter+\n"));
-#endif
-	} else if (((MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0xc) >> 16) & 0xff) == 0x1) {
-#if !defined(MDEPKG_NDEBUG)
-          DEBUG ((EFI_D_INFO, ", Cfg0Filter- (Type 1)\n"));
-#endif
-        } else {
-#if !defined(MDEPKG_NDEBUG)
-          DEBUG ((EFI_D_INFO, ", Cfg0Filter-\n"));
-#endif
-          mPcieCfg0Quirk |= 1 << mPcieSegIds[PcieIdx];
-        }
-#if !defined(MDEPKG_NDEBUG)
-        DEBUG((EFI_D_INFO,
-          "PcieRoot(0x%x): [%dms]: dev_id at 1:0.0 - %x, dev_id at 1:1.0 - %x\n",
-          PcieIdx,
-          (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
-          MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)),
-          MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0x8000)));
-#endif
-
-        break;
-      } else if (GetTimeInNanoSecond (PerformanceCounter) - TimeStart > 500000000) {
-        // Wait up to 500 ms for link up
-        DEBUG ((
-          EFI_D_INFO,
-          "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link is inactive\n",
-          PcieIdx,
-          mPcieDbiBases[PcieIdx],
-          (GetTimeInNanoSecond (PerformanceCounter) - TimeStart) / 1000000,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
-          PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-'
-          ));
-
-        //
-        // System hangups have been observed when PCIe partner enters detect state
-        // but L0 state or data link are not reached. Disabling LTSSM helps to prevent these hangups.
-        //
-        MmioAnd32 (
-           mPcieApbBases[PcieIdx] +
-           BS1000_PCIE_APB_PE_GEN_CTRL3,
-          ~BS1000_PCIE_APB_PE_GEN_CTRL3_LTSSM_EN
-          );
-
-        break;
-      }
-    }
-  }
-}
-
 STATIC
 VOID
 PciHostBridgeLibRootBrigeInit (
@@ -478,7 +364,9 @@ PciHostBridgeLibRootBrigeInit (
   IN CONST UINTN                 NumLanes,
   IN CONST UINTN                 CfgSize,
   IN CONST EFI_PHYSICAL_ADDRESS  MemBase,
-  IN CONST EFI_PHYSICAL_ADDRESS  IoBase
+  IN CONST EFI_PHYSICAL_ADDRESS  IoBase,
+  IN CONST EFI_PHYSICAL_ADDRESS  MemAbove4GBase,
+  IN CONST EFI_PHYSICAL_ADDRESS  PMemAbove4GBase
   )
 {
   PCI_ROOT_BRIDGE  *lPcieRootBridge = &mPcieRootBridges[PcieIdx];
@@ -653,6 +541,469 @@ PciHostBridgeLibRootBrigeInit (
       0
       );
   }
+
+  // Region 4: 64-bit prefetchable MEM
+  if (lPcieRootBridge->PMemAbove4G.Limit >= lPcieRootBridge->PMemAbove4G.Base) {
+    PciHostBridgeLibCfgWindow (
+      mPcieDbiBases[PcieIdx],
+      4,
+      PMemAbove4GBase,
+      lPcieRootBridge->PMemAbove4G.Base,
+      lPcieRootBridge->PMemAbove4G.Limit - lPcieRootBridge->PMemAbove4G.Base + 1,
+      BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_MEM,
+      0
+      );
+  }
+
+  // Region 5: 64-bit MEM
+  if (lPcieRootBridge->MemAbove4G.Limit >= lPcieRootBridge->MemAbove4G.Base) {
+    PciHostBridgeLibCfgWindow (
+      mPcieDbiBases[PcieIdx],
+      5,
+      MemAbove4GBase,
+      lPcieRootBridge->MemAbove4G.Base,
+      lPcieRootBridge->MemAbove4G.Limit - lPcieRootBridge->MemAbove4G.Base + 1,
+      BS1000_PCIE_PF0_ATU_CAP_IATU_REGION_CTRL_1_OFF_OUTBOUND_0_TYPE_MEM,
+      0
+      );
+  }
+}
+
+STATIC
+VOID
+PciHostBridgeLibRootBridgePerst (
+  IN CONST UINTN    PcieIdx,
+  IN CONST BOOLEAN  Assert
+  )
+{
+  CONST PCIE_LINK  *Link = &mPcieLinks[PcieIdx];
+
+  if (Link->PerstGpioBase == 0) {
+    return;
+  }
+
+  if (Assert == (Link->PerstGpioPolarity != 0)) {
+    GpioOutRst (Link->PerstGpioBase, Link->PerstGpio);
+  } else {
+    GpioOutSet (Link->PerstGpioBase, Link->PerstGpio);
+  }
+
+  GpioDirSet (Link->PerstGpioBase, Link->PerstGpio);
+}
+
+STATIC
+VOID
+PciHostBridgeLibRootBridgeLinkStart (
+  IN CONST UINTN  PcieIdx
+  )
+{
+  PciHostBridgeLibRootBridgePerst (PcieIdx, FALSE);
+
+  MmioOr32 (
+    mPcieApbBases[PcieIdx] +
+    BS1000_PCIE_APB_PE_GEN_CTRL3,
+    BS1000_PCIE_APB_PE_GEN_CTRL3_LTSSM_EN
+    );
+
+  MmioOr32 (
+    mPcieDbiBases[PcieIdx] +
+    BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG,
+    BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_RETRAIN_LINK
+    );
+
+  mPcieLinks[PcieIdx].State     = PcieLinkStateDetect;
+  mPcieLinks[PcieIdx].TimeStart = GetTimeInNanoSecond (GetPerformanceCounter ());
+}
+
+STATIC
+VOID
+PciHostBridgeLibCheckCfg0Filter (
+  IN CONST UINTN   PcieIdx,
+  IN CONST UINT64  Elapsed
+  )
+{
+  if (MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)) != 0xFFFFFFFF &&
+      MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0x8000) == 0xFFFFFFFF) {
+    //
+    // Device appears to filter CFG0 requests, so the 64 KiB granule for the iATU
+    // isn't a problem. We don't have to ignore fn > 0 or shift MCFG by 0x8000.
+    //
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter+\n", PcieIdx));
+  } else if (((MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0xc) >> 16) & 0xff) == 0x1) {
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter- (Type 1)\n", PcieIdx));
+  } else {
+    DEBUG ((EFI_D_INFO, "PcieRoot(0x%x): Cfg0Filter-\n", PcieIdx));
+    mPcieCfg0Quirk |= 1U << mPcieSegIds[PcieIdx];
+  }
+
+  DEBUG((EFI_D_INFO,
+    "PcieRoot(0x%x): [%dms]: dev_id at 1:0.0 - %x, dev_id at 1:1.0 - %x\n",
+    PcieIdx,
+    Elapsed / 1000000,
+    MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)),
+    MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20) + 0x8000)));
+}
+
+//
+// Returns TRUE while the link still needs polling
+//
+STATIC
+BOOLEAN
+PciHostBridgeLibRootBridgeLinkPoll (
+  IN CONST UINTN  PcieIdx
+  )
+{
+  PCIE_LINK     *Link = &mPcieLinks[PcieIdx];
+  CONST UINT32  PcieApbPeLinkDbg2 = MmioRead32 (mPcieApbBases[PcieIdx] + BS1000_PCIE_APB_PE_LINK_DBG2);
+  CONST UINT64  Elapsed = GetTimeInNanoSecond (GetPerformanceCounter ()) - Link->TimeStart;
+
+  if (Link->State == PcieLinkStateDetect) {
+    if ((PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK) > 0x1) {
+      Link->State = PcieLinkStateTraining;
+      mPcieTopology.Ports[mPcieSegIds[PcieIdx]].Flags |= PCIE_TOPOLOGY_PORT_PRESENT;
+      mPcieLinkStats.Ports[mPcieSegIds[PcieIdx]].DetectUs = Elapsed / 1000;
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link partner detected\n",
+        PcieIdx,
+        mPcieDbiBases[PcieIdx],
+        Elapsed / 1000000,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-'
+        ));
+    } else if (Elapsed > PCIE_LINK_DETECT_TIMEOUT_NS) {
+      //
+      // According to PCI Express Base Specification device must enter LTSSM detect state within 20 ms of reset.
+      // A port that was empty on the previous boot gets the full window too, a card inserted since then may
+      // take all of it.
+      //
+      Link->State = PcieLinkStateDone;
+      return FALSE;
+    }
+  }
+
+  if (Link->State == PcieLinkStateTraining) {
+    if (((PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK) ==
+                              BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_L0) &&
+         (PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP) &&
+         (PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP)) {
+#if !defined(MDEPKG_NDEBUG)
+      CONST UINT32  PcieLnkStat = MmioRead32 (
+                                    mPcieDbiBases[PcieIdx] +
+                                    BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG
+                                    );
+      CONST CHAR8  *LinkSpeedString;
+      CONST UINTN   LinkSpeedVector = (PcieLnkStat &
+                                        BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_BITS) >>
+                                        BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_SHIFT;
+      if (LinkSpeedVector == 1) {
+        LinkSpeedString = "2.5";
+      } else if (LinkSpeedVector == 2) {
+        LinkSpeedString = "5.0";
+      } else if (LinkSpeedVector == 3) {
+        LinkSpeedString = "8.0";
+      } else if (LinkSpeedVector == 4) {
+        LinkSpeedString = "16.0";
+      } else {
+        LinkSpeedString = "???";
+      }
+
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link %a GT/s, x%u\n",
+        PcieIdx,
+        mPcieDbiBases[PcieIdx],
+        Elapsed / 1000000,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-',
+        LinkSpeedString,
+        (PcieLnkStat & BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_BITS) >>
+          BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_SHIFT
+        ));
+#endif
+      Link->State = PcieLinkStateCfgWait;
+      mPcieLinkStats.Ports[mPcieSegIds[PcieIdx]].LinkUpUs = Elapsed / 1000;
+    } else if (Elapsed > PCIE_LINK_UP_TIMEOUT_NS) {
+      // Wait up to 500 ms for link up
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x|0x%llx)[%03ums: LTSSM:0x%02x SMLH%c RDLH%c]: link is inactive\n",
+        PcieIdx,
+        mPcieDbiBases[PcieIdx],
+        Elapsed / 1000000,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_LTSSM_STATE_MASK,
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_SMLH_LINKUP ? '+' : '-',
+        PcieApbPeLinkDbg2 & BS1000_PCIE_APB_PE_LINK_DBG2_RDLH_LINKUP ? '+' : '-'
+        ));
+
+      //
+      // System hangups have been observed when PCIe partner enters detect state
+      // but L0 state or data link are not reached. Disabling LTSSM helps to prevent these hangups.
+      //
+      MmioAnd32 (
+         mPcieApbBases[PcieIdx] +
+         BS1000_PCIE_APB_PE_GEN_CTRL3,
+        ~BS1000_PCIE_APB_PE_GEN_CTRL3_LTSSM_EN
+        );
+
+      Link->State = PcieLinkStateDone;
+      return FALSE;
+    }
+  }
+
+  if (Link->State == PcieLinkStateCfgWait) {
+    // Wait until device starts responding to cfg requests
+    if (MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20)) == 0 &&
+        Elapsed <= PCIE_LINK_CFG_TIMEOUT_NS) {
+      MmioWrite32 (mPcieCfgBases[PcieIdx] + (1 << 20), 0xffffffff);
+    } else {
+      PciHostBridgeLibCheckCfg0Filter (PcieIdx, Elapsed);
+      Link->State = PcieLinkStateDone;
+      mPcieLinkStats.Ports[mPcieSegIds[PcieIdx]].CfgWaitUs = Elapsed / 1000 -
+                                                             mPcieLinkStats.Ports[mPcieSegIds[PcieIdx]].LinkUpUs;
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+STATIC
+VOID
+PciHostBridgeLibLoadTopology (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Size;
+
+  Size   = sizeof (mPcieTopologyPrev);
+  Status = gRT->GetVariable (
+                  PCIE_TOPOLOGY_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  NULL,
+                  &Size,
+                  &mPcieTopologyPrev
+                  );
+  if (EFI_ERROR (Status) ||
+      Size != sizeof (mPcieTopologyPrev) ||
+      mPcieTopologyPrev.Revision  != PCIE_TOPOLOGY_REVISION ||
+      mPcieTopologyPrev.PortCount != ARRAY_SIZE (mPcieDbiBaseList) * PLATFORM_CHIP_COUNT ||
+      !PcdGetBool (PcdPcieFastBoot)) {
+    ZeroMem (&mPcieTopologyPrev, sizeof (mPcieTopologyPrev));
+  }
+}
+
+STATIC
+VOID
+PciHostBridgeLibSaveTopology (
+  VOID
+  )
+{
+  UINTN               PcieIdx;
+  UINT32              PcieLnkSts;
+  PCIE_TOPOLOGY_PORT  *Port;
+  PCIE_TOPOLOGY_PORT  *PrevPort;
+  EFI_STATUS          Status;
+
+  mPcieTopology.Revision  = PCIE_TOPOLOGY_REVISION;
+  mPcieTopology.PortCount = ARRAY_SIZE (mPcieDbiBaseList) * PLATFORM_CHIP_COUNT;
+
+  for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+    Port     = &mPcieTopology.Ports[mPcieSegIds[PcieIdx]];
+    PrevPort = &mPcieTopologyPrev.Ports[mPcieSegIds[PcieIdx]];
+
+    Port->Flags |= PCIE_TOPOLOGY_PORT_VALID;
+    if (PciHostBridgeLibGetLink (PcieIdx)) {
+      PcieLnkSts = MmioRead32 (
+                     mPcieDbiBases[PcieIdx] +
+                     BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG
+                     );
+      Port->Flags   |= PCIE_TOPOLOGY_PORT_LINK_UP;
+      Port->Speed    = (PcieLnkSts & BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_BITS) >>
+                         BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_LINK_SPEED_SHIFT;
+      Port->Width    = (PcieLnkSts & BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_BITS) >>
+                         BS1000_PCIE_PF0_PCIE_CAP_LINK_CONTROL_LINK_STATUS_REG_NEGO_LINK_WIDTH_SHIFT;
+      Port->DeviceId = MmioRead32 (mPcieCfgBases[PcieIdx] + (1 << 20));
+      if (mPcieCfg0Quirk & (1U << mPcieSegIds[PcieIdx])) {
+        Port->Flags |= PCIE_TOPOLOGY_PORT_CFG0_QUIRK;
+      }
+    }
+
+    if ((PrevPort->Flags & PCIE_TOPOLOGY_PORT_VALID) &&
+        (PrevPort->Flags != Port->Flags || PrevPort->DeviceId != Port->DeviceId)) {
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x|0x%llx): topology changed (flags %x -> %x, id %08x -> %08x)\n",
+        PcieIdx,
+        mPcieDbiBases[PcieIdx],
+        PrevPort->Flags,
+        Port->Flags,
+        PrevPort->DeviceId,
+        Port->DeviceId
+        ));
+    }
+  }
+
+  if (CompareMem (&mPcieTopology, &mPcieTopologyPrev, sizeof (mPcieTopology)) == 0) {
+    return;
+  }
+
+  Status = gRT->SetVariable (
+                  PCIE_TOPOLOGY_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                  sizeof (mPcieTopology),
+                  &mPcieTopology
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: unable to save PCIe topology, Status: %r\n", __func__, Status));
+  }
+}
+
+//
+// Publish the link training statistics of this boot for PcieLinkReport
+//
+STATIC
+VOID
+PciHostBridgeLibSaveLinkStats (
+  VOID
+  )
+{
+  UINTN                 PcieIdx;
+  PCIE_LINK_STATS_PORT  *Port;
+  EFI_STATUS            Status;
+
+  mPcieLinkStats.Revision  = PCIE_LINK_STATS_REVISION;
+  mPcieLinkStats.PortCount = mPcieTopology.PortCount;
+
+  for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+    Port = &mPcieLinkStats.Ports[mPcieSegIds[PcieIdx]];
+    Port->DbiBase = mPcieDbiBases[PcieIdx];
+    Port->Flags   = mPcieTopology.Ports[mPcieSegIds[PcieIdx]].Flags;
+    Port->Speed   = mPcieTopology.Ports[mPcieSegIds[PcieIdx]].Speed;
+    Port->Width   = mPcieTopology.Ports[mPcieSegIds[PcieIdx]].Width;
+  }
+
+  Status = gRT->SetVariable (
+                  PCIE_LINK_STATS_VARIABLE_NAME,
+                  &gBaikalPcieTopologyGuid,
+                  EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                  sizeof (mPcieLinkStats),
+                  &mPcieLinkStats
+                  );
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "%a: unable to save PCIe link statistics, Status: %r\n", __func__, Status));
+  }
+}
+
+STATIC
+VOID
+PciHostBridgeLibRootBridgesLinkUp (
+  VOID
+  )
+{
+  UINTN    PcieIdx;
+  BOOLEAN  PerstAsserted = FALSE;
+  BOOLEAN  Pending;
+  UINT64   TrainingStart;
+
+  //
+  // Hold every port in reset for 1 ms, then start all LTSSMs and wait for
+  // the links together: empty slots cost one detect timeout in total
+  // rather than one each
+  //
+  for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+    if (mPcieLinks[PcieIdx].PerstGpioBase) {
+      PciHostBridgeLibRootBridgePerst (PcieIdx, TRUE);
+      PerstAsserted = TRUE;
+    }
+  }
+
+  if (PerstAsserted) {
+    gBS->Stall (1000);
+  }
+
+  for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+    PciHostBridgeLibRootBridgeLinkStart (PcieIdx);
+  }
+
+  TrainingStart = GetTimeInNanoSecond (GetPerformanceCounter ());
+  do {
+    Pending = FALSE;
+
+    for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+      if (mPcieLinks[PcieIdx].State != PcieLinkStateDone &&
+          PciHostBridgeLibRootBridgeLinkPoll (PcieIdx)) {
+        Pending = TRUE;
+      }
+    }
+
+    if (Pending) {
+      gBS->Stall (PCIE_LINK_POLL_US);
+    }
+  } while (Pending);
+
+  mPcieLinkStats.TrainingUs = (GetTimeInNanoSecond (GetPerformanceCounter ()) - TrainingStart) / 1000;
+}
+
+STATIC
+VOID
+EFIAPI
+PciHostBridgeLibReadyToBoot (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  gBS->CloseEvent (Event);
+  PciSegmentLibTraceDump ();
+}
+
+/**
+  Read the link of every root bridge and publish the ones that are up in
+  PcdPcieLinkMask, from which AcpiPlatformDxe builds _STA and MCFG.
+**/
+STATIC
+VOID
+PciHostBridgeLibSetLinkMask (
+  VOID
+  )
+{
+  UINTN  PcieIdx;
+
+  mPcieLinkMask = 0;
+  for (PcieIdx = 0; PcieIdx < mPcieRootBridgesNum; ++PcieIdx) {
+    mPcieSegments[PcieIdx].LinkUp = PciHostBridgeLibGetLink (PcieIdx);
+    if (mPcieSegments[PcieIdx].LinkUp) {
+      mPcieLinkMask |= 1U << mPcieSegIds[PcieIdx];
+    }
+  }
+
+  PcdSet32S (PcdPcieLinkMask, mPcieLinkMask);
+}
+
+STATIC
+VOID
+EFIAPI
+PciHostBridgeLibEnumerationComplete (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  VOID        *Interface;
+  EFI_STATUS   Status;
+
+  Status = gBS->LocateProtocol (&gEfiPciEnumerationCompleteProtocolGuid, NULL, &Interface);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gBS->CloseEvent (Event);
+
+  // Take in the links that have come up while the buses were enumerated
+  PciHostBridgeLibSetLinkMask ();
 }
 
 EFI_STATUS
@@ -664,11 +1015,15 @@ PciHostBridgeLibConstructor (
 {
   FDT_CLIENT_PROTOCOL  *FdtClient;
   INT32                 Node = 0;
+  EFI_EVENT             Event;
+  UINTN                 Size;
   EFI_STATUS            Status;
 
   Status = gBS->LocateProtocol (&gFdtClientProtocolGuid, NULL, (VOID **) &FdtClient);
   ASSERT_EFI_ERROR (Status);
 
+  PciHostBridgeLibLoadTopology ();
+
   // Acquire PCIe RC related data from FDT and initialize RC's
   while (TRUE) {
     EFI_PHYSICAL_ADDRESS              ApbBase;
@@ -686,6 +1041,11 @@ PciHostBridgeLibConstructor (
     EFI_PHYSICAL_ADDRESS              MemAbove4GBase;
     EFI_PHYSICAL_ADDRESS              MemAbove4GMin;
     UINTN                             MemAbove4GSize;
+    EFI_PHYSICAL_ADDRESS              PMemAbove4GBase;
+    EFI_PHYSICAL_ADDRESS              PMemAbove4GMin;
+    UINTN                             PMemAbove4GSize;
+    EFI_PHYSICAL_ADDRESS              MmioBase;
+    UINTN                             MmioSize;
     INTN                              ApbRegIdx = -1, CfgRegIdx = -1, DbiRegIdx = -1;
     CONST VOID                       *Prop;
     UINT32                            PropSize;
@@ -759,6 +1119,8 @@ PciHostBridgeLibConstructor (
           ASSERT (CfgSize <= mPcieMmioSizeList[ListIdx]);
           ASSERT ((CfgSize & (SIZE_1MB - 1)) == 0);
           SegId = ListIdx + PLATFORM_ADDR_CHIP(DbiBase) * ARRAY_SIZE (mPcieDbiBaseList);
+          MmioBase = PLATFORM_ADDR_OUT_CHIP(PLATFORM_ADDR_CHIP(DbiBase), mPcieMmioBaseList[ListIdx]);
+          MmioSize = mPcieMmioSizeList[ListIdx];
           break;
         }
       }
@@ -770,9 +1132,10 @@ PciHostBridgeLibConstructor (
         PropSize > 0 && (PropSize % (sizeof (UINT32) + 3 * sizeof (UINT64))) == 0) {
       UINTN  Entry;
 
-      IoSize         = 0;
-      MemSize        = 0;
-      MemAbove4GSize = 0;
+      IoSize          = 0;
+      MemSize         = 0;
+      MemAbove4GSize  = 0;
+      PMemAbove4GSize = 0;
 
       for (Entry = 0; Entry < PropSize / (sizeof (UINT32) + 3 * sizeof (UINT64)); ++Entry) {
         UINTN                 Flags;
@@ -785,20 +1148,31 @@ PciHostBridgeLibConstructor (
         CpuBase = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) ((EFI_PHYSICAL_ADDRESS) Prop + sizeof (UINT32) + 1 * sizeof (UINT64))));
         Size    = SwapBytes64 (ReadUnaligned64 ((CONST UINT64 *) ((EFI_PHYSICAL_ADDRESS) Prop + sizeof (UINT32) + 2 * sizeof (UINT64))));
 
-        if (Flags & RANGES_FLAG_IO) {
+        //
+        // Mask the space code rather than testing single bits: a 64-bit
+        // memory range (0b11) would otherwise be taken for an I/O one
+        //
+        if ((Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_IO) {
           if (IoSize < Size) {
             IoMin  = PciBase;
             IoBase = CpuBase;
             IoSize = Size;
           }
-        } else if (Flags & RANGES_FLAG_MEM) {
-          if (PciBase <= MAX_UINT32) {
+        } else if ((Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_MEM ||
+                   (Flags & RANGES_FLAG_SPACE_MASK) == RANGES_FLAG_MEM64) {
+          if (PciBase + Size - 1 <= MAX_UINT32) {
             if (MemSize < Size) {
               MemMin  = PciBase;
               MemBase = CpuBase;
               MemSize = Size;
             }
-          } else if (PciBase == CpuBase) {
+          } else if (Flags & RANGES_FLAG_PREFETCH) {
+            if (PMemAbove4GSize < Size) {
+              PMemAbove4GMin  = PciBase;
+              PMemAbove4GBase = CpuBase;
+              PMemAbove4GSize = Size;
+            }
+          } else {
             if (MemAbove4GSize < Size) {
               MemAbove4GMin  = PciBase;
               MemAbove4GBase = CpuBase;
@@ -809,6 +1183,18 @@ PciHostBridgeLibConstructor (
 
         Prop = &(((CONST UINT32 *) Prop)[7]);
       }
+
+      //
+      // Without a 64-bit prefetchable range in the device tree give the
+      // RC the rest of its MMIO region above the 32-bit windows, mapped 1:1.
+      // AcpiPlatformDxe reports the window in _CRS from PcdPciePMem64Windows
+      // like one given by the device tree.
+      //
+      if (PMemAbove4GSize == 0 && MemAbove4GSize == 0 && PcdGetBool (PcdPciePMem64Window)) {
+        PMemAbove4GMin  = MmioBase + BS1000_PCIE_PMEM64_OFFSET;
+        PMemAbove4GBase = PMemAbove4GMin;
+        PMemAbove4GSize = MmioSize - BS1000_PCIE_PMEM64_OFFSET;
+      }
     } else {
       continue;
     }
@@ -873,12 +1259,24 @@ PciHostBridgeLibConstructor (
                       mPcieCfgBases
                       );
     ASSERT (mPcieCfgBases != NULL);
+    mPcieSegments = ReallocatePool (
+                      mPcieRootBridgesNum       * sizeof (PCIE_SEGMENT_DESC),
+                      (mPcieRootBridgesNum + 1) * sizeof (PCIE_SEGMENT_DESC),
+                      mPcieSegments
+                      );
+    ASSERT (mPcieSegments != NULL);
     mPcieSegIds = ReallocatePool (
                       mPcieRootBridgesNum       * sizeof (UINTN),
                       (mPcieRootBridgesNum + 1) * sizeof (UINTN),
                       mPcieSegIds
                       );
     ASSERT (mPcieSegIds != NULL);
+    mPcieLinks = ReallocatePool (
+                   mPcieRootBridgesNum       * sizeof (PCIE_LINK),
+                   (mPcieRootBridgesNum + 1) * sizeof (PCIE_LINK),
+                   mPcieLinks
+                   );
+    ASSERT (mPcieLinks != NULL);
     DevicePath = AllocateCopyPool (
                    sizeof (mEfiPciRootBridgeDevicePathTemplate),
                    &mEfiPciRootBridgeDevicePathTemplate
@@ -892,7 +1290,9 @@ PciHostBridgeLibConstructor (
     mPcieRootBridges[mPcieRootBridgesNum].DmaAbove4G = TRUE;
     mPcieRootBridges[mPcieRootBridgesNum].NoExtendedConfigSpace = FALSE;
     mPcieRootBridges[mPcieRootBridgesNum].ResourceAssigned      = FALSE;
-    mPcieRootBridges[mPcieRootBridgesNum].AllocationAttributes  = EFI_PCI_HOST_BRIDGE_COMBINE_MEM_PMEM;
+    mPcieRootBridges[mPcieRootBridgesNum].AllocationAttributes  = PMemAbove4GSize > 0 ?
+                                                                  EFI_PCI_HOST_BRIDGE_MEM64_DECODE :
+                                                                  EFI_PCI_HOST_BRIDGE_COMBINE_MEM_PMEM;
 
     mPcieRootBridges[mPcieRootBridgesNum].Bus.Base           = 0;
     mPcieRootBridges[mPcieRootBridgesNum].Bus.Limit          = CfgSize / SIZE_1MB - 1;
@@ -917,8 +1317,9 @@ PciHostBridgeLibConstructor (
 
     if (MemAbove4GSize > 0) {
       mPcieRootBridges[mPcieRootBridgesNum].AllocationAttributes  |= EFI_PCI_HOST_BRIDGE_MEM64_DECODE;
-      mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Base  = MemAbove4GBase;
-      mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Limit = MemAbove4GBase + MemAbove4GSize - 1;
+      mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Base  = MemAbove4GMin;
+      mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Limit = MemAbove4GMin + MemAbove4GSize - 1;
+      mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Translation = MemAbove4GMin - MemAbove4GBase;
     } else {
       mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Base  = MAX_UINT64;
       mPcieRootBridges[mPcieRootBridgesNum].MemAbove4G.Limit = 0;
@@ -926,22 +1327,101 @@ PciHostBridgeLibConstructor (
 
     mPcieRootBridges[mPcieRootBridgesNum].PMem.Base          = MAX_UINT64;
     mPcieRootBridges[mPcieRootBridgesNum].PMem.Limit         = 0;
-    mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Base   = MAX_UINT64;
-    mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Limit  = 0;
+    if (PMemAbove4GSize > 0) {
+      mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Base        = PMemAbove4GMin;
+      mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Limit       = PMemAbove4GMin + PMemAbove4GSize - 1;
+      mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Translation = PMemAbove4GMin - PMemAbove4GBase;
+
+      ASSERT (SegId < ARRAY_SIZE (mPciePMem64Windows));
+      mPciePMem64Windows[SegId].Base        = PMemAbove4GMin;
+      mPciePMem64Windows[SegId].Size        = PMemAbove4GSize;
+      mPciePMem64Windows[SegId].Translation = PMemAbove4GBase - PMemAbove4GMin;
+
+      DEBUG ((
+        EFI_D_INFO,
+        "PcieRoot(0x%x|0x%llx): 64-bit prefetchable window 0x%llx-0x%llx\n",
+        mPcieRootBridgesNum,
+        DbiBase,
+        PMemAbove4GMin,
+        PMemAbove4GMin + PMemAbove4GSize - 1
+        ));
+    } else {
+      mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Base   = MAX_UINT64;
+      mPcieRootBridges[mPcieRootBridgesNum].PMemAbove4G.Limit  = 0;
+    }
+
     mPcieRootBridges[mPcieRootBridgesNum].DevicePath         = (EFI_DEVICE_PATH_PROTOCOL *) DevicePath;
 
     mPcieApbBases[mPcieRootBridgesNum] = ApbBase;
     mPcieDbiBases[mPcieRootBridgesNum] = DbiBase;
     mPcieCfgBases[mPcieRootBridgesNum] = CfgBase;
+    mPcieSegments[mPcieRootBridgesNum].DbiBase     = DbiBase;
+    mPcieSegments[mPcieRootBridgesNum].CfgBase     = CfgBase;
+    mPcieSegments[mPcieRootBridgesNum].BusMax      = CfgSize / SIZE_1MB - 1;
+    mPcieSegments[mPcieRootBridgesNum].LinkUp      = FALSE;
+    mPcieSegments[mPcieRootBridgesNum].LinkChecked = 0;
     mPcieSegIds[mPcieRootBridgesNum] = SegId;
-
-    PciHostBridgeLibRootBrigeInit (mPcieRootBridgesNum, MaxSpeed, NumLanes, CfgSize, MemBase, IoBase);
-    PciHostBridgeLibRootBridgeLinkUp (mPcieRootBridgesNum, PerstGpioBase, PerstGpio, PerstGpioPolarity);
+    mPcieLinks[mPcieRootBridgesNum].PerstGpioBase     = PerstGpioBase;
+    mPcieLinks[mPcieRootBridgesNum].PerstGpio         = PerstGpio;
+    mPcieLinks[mPcieRootBridgesNum].PerstGpioPolarity = PerstGpioPolarity;
+    mPcieLinks[mPcieRootBridgesNum].State             = PcieLinkStateDone;
+
+    PciHostBridgeLibRootBrigeInit (
+      mPcieRootBridgesNum,
+      MaxSpeed,
+      NumLanes,
+      CfgSize,
+      MemBase,
+      IoBase,
+      MemAbove4GBase,
+      PMemAbove4GBase
+      );
 
     ++mPcieRootBridgesNum;
   }
 
+  PciHostBridgeLibRootBridgesLinkUp ();
+  PciHostBridgeLibSetLinkMask ();
+
+  //
+  // The mask is published again once enumeration is complete, at TPL_NOTIFY
+  // so that it is up to date before the TPL_CALLBACK notify of
+  // AcpiPlatformDxe builds the tables from it
+  //
+  Status = gBS->CreateEvent (
+                  EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  PciHostBridgeLibEnumerationComplete,
+                  NULL,
+                  &Event
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  Status = gBS->RegisterProtocolNotify (
+                  &gEfiPciEnumerationCompleteProtocolGuid,
+                  Event,
+                  &mPcieRegistration
+                  );
+  ASSERT_EFI_ERROR (Status);
+
+  PciHostBridgeLibSaveTopology ();
+  PciHostBridgeLibSaveLinkStats ();
+
+  if (FeaturePcdGet (PcdPciCfgTrace)) {
+    Status = gBS->CreateEventEx (
+                    EVT_NOTIFY_SIGNAL,
+                    TPL_CALLBACK,
+                    PciHostBridgeLibReadyToBoot,
+                    NULL,
+                    &gEfiEventReadyToBootGuid,
+                    &Event
+                    );
+    ASSERT_EFI_ERROR (Status);
+  }
+
   PcdSet32S (PcdPcieCfg0Quirk, mPcieCfg0Quirk);
+  Size = ARRAY_SIZE (mPcieDbiBaseList) * PLATFORM_CHIP_COUNT * sizeof (PCIE_PMEM64_WINDOW);
+  PcdSetPtrS (PcdPciePMem64Windows, &Size, mPciePMem64Windows);
 
   return EFI_SUCCESS;
 }
@@ -962,6 +1442,15 @@ PciHostBridgeLibDestructor (
   if (mPcieCfgBases != NULL) {
     FreePool (mPcieCfgBases);
   }
+  if (mPcieSegments != NULL) {
+    FreePool (mPcieSegments);
+  }
+  if (mPcieSegIds != NULL) {
+    FreePool (mPcieSegIds);
+  }
+  if (mPcieLinks != NULL) {
+    FreePool (mPcieLinks);
+  }
 
   return EFI_SUCCESS;
 }
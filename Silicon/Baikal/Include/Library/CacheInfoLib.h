@@ -0,0 +1,104 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef CACHE_INFO_LIB_H_
+#define CACHE_INFO_LIB_H_
+
+#include <IndustryStandard/Acpi.h>
+
+#define CACHE_INFO_TYPE_UNIFIED         0
+#define CACHE_INFO_TYPE_DATA            1
+#define CACHE_INFO_TYPE_INSTRUCTION     2
+
+// The topology level that owns one instance of the cache
+#define CACHE_INFO_SCOPE_CORE           0
+#define CACHE_INFO_SCOPE_CLUSTER        1
+#define CACHE_INFO_SCOPE_PACKAGE        2
+
+#define CACHE_INFO_WRITE_THROUGH        BIT0
+#define CACHE_INFO_WRITE_BACK           BIT1
+#define CACHE_INFO_READ_ALLOCATE        BIT2
+#define CACHE_INFO_WRITE_ALLOCATE       BIT3
+
+//
+// Geometry of one cache as seen by one core. The silicon headers provide a
+// table of these with the values from the SoC documentation, CacheInfoProbe
+// replaces the entries of the levels that CLIDR_EL1 describes with what the
+// core itself reports. Entries keep their order, so the table index can be
+// used to derive handles and identifiers that do not change between boots.
+//
+typedef struct {
+  UINT8    Level;
+  UINT8    Type;
+  UINT8    Scope;
+  UINT8    Policy;
+  BOOLEAN  Probed;
+  UINT32   Size;
+  UINT32   NumberOfSets;
+  UINT32   Associativity;
+  UINT32   LineSize;
+} CACHE_INFO;
+
+#define CACHE_INFO_DEFAULT(Level, Type, Scope, Size, Associativity)  { \
+  Level,                                                              \
+  Type,                                                               \
+  Scope,                                                              \
+  (Type) == CACHE_INFO_TYPE_INSTRUCTION ?                             \
+    CACHE_INFO_WRITE_BACK | CACHE_INFO_READ_ALLOCATE :                \
+    CACHE_INFO_WRITE_BACK | CACHE_INFO_READ_ALLOCATE |                \
+    CACHE_INFO_WRITE_ALLOCATE,                                        \
+  FALSE,                                                              \
+  Size,                                                               \
+  (Size) / ((Associativity) * 64),                                    \
+  Associativity,                                                      \
+  64                                                                  \
+}
+
+//
+// Cache identifier as used by the PPTT Cache ID field. It only depends on
+// the chip, the position of the cache in the silicon table and the instance
+// number within its scope, so it stays the same whatever the probe finds.
+//
+#define CACHE_INFO_ID(Chip, Index, Instance)  \
+  (((UINT32) (Chip) << 24) | ((UINT32) ((Index) + 1) << 16) | (UINT32) (Instance))
+
+/**
+  Refine a cache table with the values reported by CLIDR_EL1 and CCSIDR_EL1
+  of the calling core.
+
+  Entries of the levels that the core does not describe (e.g. system level
+  caches of the interconnect) are left as they are.
+
+  @param[in, out]  Caches  Table initialised with the silicon defaults.
+  @param[in]       Count   Number of entries in Caches.
+
+  @return  Number of entries updated from the system registers.
+**/
+UINTN
+EFIAPI
+CacheInfoProbe (
+  IN OUT  CACHE_INFO  *Caches,
+  IN      UINTN        Count
+  );
+
+/**
+  Fill a PPTT cache type structure from a cache table entry.
+
+  @param[out]  Node              The PPTT cache structure.
+  @param[in]   Cache             The cache.
+  @param[in]   NextLevelOfCache  Offset of the next level cache structure in
+                                 the PPTT, 0 if there is none.
+  @param[in]   CacheId           Cache ID, see CACHE_INFO_ID.
+**/
+VOID
+EFIAPI
+CacheInfoToPpttCache (
+  OUT  EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *Node,
+  IN   CONST CACHE_INFO                   *Cache,
+  IN   UINT32                              NextLevelOfCache,
+  IN   UINT32                              CacheId
+  );
+
+#endif // CACHE_INFO_LIB_H_
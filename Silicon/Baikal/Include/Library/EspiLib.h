@@ -61,6 +61,21 @@
 #define SPI_FLASH_SR_WIP  BIT0 // Write In Progress
 #define SPI_FLASH_SR_WEL  BIT1 // Write Enable Latch
 
+// Erase plan: head subsectors, middle sectors, tail subsectors (or one bulk erase)
+#define ESPI_ERASE_PLAN_MAX_RUNS  3
+
+typedef struct {
+  UINT8  Cmd;      // CMD_FLASH_SSE, CMD_FLASH_SE or CMD_FLASH_BE
+  UINTN  Adr;      // Address of the first unit
+  UINTN  UnitSize; // SPI_SUBSECTOR, SPI_SECTOR or the whole chip
+  UINTN  Count;    // Number of units
+} ESPI_ERASE_RUN;
+
+typedef struct {
+  UINTN           RunCount;
+  ESPI_ERASE_RUN  Runs[ESPI_ERASE_PLAN_MAX_RUNS];
+} ESPI_ERASE_PLAN;
+
 //
 // Bus functions
 //
@@ -136,4 +151,55 @@ EspiErase (
   IN UINTN   Size
   );
 
+//
+// Non-blocking functions: start an operation and return without waiting
+// for the Write In Progress bit to clear, poll it with EspiBusy.
+//
+INTN
+EspiEraseStart (
+  IN UINTN   Base,
+  IN UINTN   Line,
+  IN UINTN   Cmd,
+  IN UINTN   Adr
+  );
+
+INTN
+EspiWriteStart (
+  IN UINTN   Base,
+  IN UINTN   Line,
+  IN UINTN   Adr,
+  IN VOID   *Data,
+  IN UINTN   Size
+  );
+
+INTN
+EspiBusy (
+  IN UINTN   Base,
+  IN UINTN   Line
+  );
+
+/**
+  Cover [Adr, Adr + Size) with the largest aligned erase units.
+
+  The range must be subsector aligned. 64 KiB sectors are used wherever
+  the range covers a whole aligned sector, 4 KiB subsectors are used at
+  the unaligned edges and a single bulk erase is planned when the range
+  is the whole chip.
+
+  @param[in]   Adr       Start address of the range.
+  @param[in]   Size      Size of the range.
+  @param[in]   ChipSize  Size of the chip, or 0 if unknown (no bulk erase).
+  @param[out]  Plan      Erase plan.
+
+  @retval  0   Plan is valid.
+  @retval  -1  Range is not subsector aligned or Plan is NULL.
+**/
+INTN
+EspiErasePlan (
+  IN  UINTN             Adr,
+  IN  UINTN             Size,
+  IN  UINTN             ChipSize,
+  OUT ESPI_ERASE_PLAN  *Plan
+  );
+
 #endif // ESPI_LIB_H_
@@ -0,0 +1,34 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#ifndef PCIE_SEGMENT_H_
+#define PCIE_SEGMENT_H_
+
+//
+// Per segment descriptor shared by PciHostBridgeLib, which fills it in as
+// the root complexes are brought up, and PciSegmentLib, which decodes every
+// config access against it. LinkUp is a cached copy of the link state: it
+// is refreshed by PciHostBridgeLib after link training and by PciSegmentLib
+// on config accesses, at a bounded rate. A segment that has
+// no controller behind it is left with a zero DbiBase.
+//
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  DbiBase;
+  EFI_PHYSICAL_ADDRESS  CfgBase;
+  UINT8                 BusMax;
+  BOOLEAN               LinkUp;
+  UINT64                LinkChecked;  // Performance counter of the last PciSegmentLib recheck
+} PCIE_SEGMENT_DESC;
+
+/**
+  Print the config access profile collected by PciSegmentLib when it is
+  built with PcdPciCfgTrace, do nothing otherwise.
+**/
+VOID
+PciSegmentLibTraceDump (
+  VOID
+  );
+
+#endif // PCIE_SEGMENT_H_
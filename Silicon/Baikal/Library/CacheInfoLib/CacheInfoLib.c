@@ -0,0 +1,210 @@
+/** @file
+  Copyright (c) 2026, Baikal Electronics, JSC. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+**/
+
+#include <Library/ArmLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/CacheInfoLib.h>
+#include <Library/DebugLib.h>
+
+#define CLIDR_MAX_LEVEL           7
+#define CLIDR_CTYPE(Clidr, Level) (((Clidr) >> (3 * ((Level) - 1))) & 0x7)
+#define CLIDR_CTYPE_NONE          0
+#define CLIDR_CTYPE_INSTRUCTION   1
+#define CLIDR_CTYPE_DATA          2
+#define CLIDR_CTYPE_SEPARATE      3
+#define CLIDR_CTYPE_UNIFIED       4
+
+#define CSSELR(Level, InD)        ((((Level) - 1) << 1) | (InD))
+
+STATIC
+BOOLEAN
+CacheInfoLevelHasType (
+  IN  UINT32  Clidr,
+  IN  UINT8   Level,
+  IN  UINT8   Type
+  )
+{
+  switch (CLIDR_CTYPE (Clidr, Level)) {
+  case CLIDR_CTYPE_INSTRUCTION:
+    return Type == CACHE_INFO_TYPE_INSTRUCTION;
+  case CLIDR_CTYPE_DATA:
+    return Type == CACHE_INFO_TYPE_DATA;
+  case CLIDR_CTYPE_SEPARATE:
+    return Type == CACHE_INFO_TYPE_INSTRUCTION || Type == CACHE_INFO_TYPE_DATA;
+  case CLIDR_CTYPE_UNIFIED:
+    return Type == CACHE_INFO_TYPE_UNIFIED;
+  default:
+    return FALSE;
+  }
+}
+
+STATIC
+VOID
+CacheInfoDecode (
+  IN OUT  CACHE_INFO  *Cache,
+  IN      BOOLEAN      Ccidx
+  )
+{
+  UINT64  Ccsidr;
+  UINT8   Policy;
+
+  Ccsidr = ReadCCSIDR (CSSELR (Cache->Level, Cache->Type == CACHE_INFO_TYPE_INSTRUCTION));
+
+  Cache->LineSize = 1U << ((Ccsidr & 0x7) + 4);
+  if (Ccidx) {
+    Cache->Associativity = ((Ccsidr >> 3) & 0x1FFFFF) + 1;
+    Cache->NumberOfSets  = ((Ccsidr >> 32) & 0xFFFFFF) + 1;
+  } else {
+    Cache->Associativity = ((Ccsidr >> 3) & 0x3FF) + 1;
+    Cache->NumberOfSets  = ((Ccsidr >> 13) & 0x7FFF) + 1;
+
+    // WT/WB/RA/WA are only defined in the 32-bit format and read as zero
+    // on cores that do not implement them, keep the silicon defaults then
+    Policy = (Ccsidr >> 28) & 0xF;
+    if (Policy != 0) {
+      Cache->Policy = 0;
+      if (Policy & BIT3) {
+        Cache->Policy |= CACHE_INFO_WRITE_THROUGH;
+      }
+
+      if (Policy & BIT2) {
+        Cache->Policy |= CACHE_INFO_WRITE_BACK;
+      }
+
+      if (Policy & BIT1) {
+        Cache->Policy |= CACHE_INFO_READ_ALLOCATE;
+      }
+
+      if (Policy & BIT0) {
+        Cache->Policy |= CACHE_INFO_WRITE_ALLOCATE;
+      }
+    }
+  }
+
+  Cache->Size   = Cache->LineSize * Cache->Associativity * Cache->NumberOfSets;
+  Cache->Probed = TRUE;
+}
+
+UINTN
+EFIAPI
+CacheInfoProbe (
+  IN OUT  CACHE_INFO  *Caches,
+  IN      UINTN        Count
+  )
+{
+  BOOLEAN  Ccidx;
+  UINT32   Clidr;
+  UINTN    Idx;
+  UINT8    Level;
+  UINTN    Probed;
+
+  Ccidx  = ArmHasCcidx ();
+  Clidr  = ReadCLIDR ();
+  Probed = 0;
+
+  for (Idx = 0; Idx < Count; ++Idx) {
+    if (Caches[Idx].Level == 0 || Caches[Idx].Level > CLIDR_MAX_LEVEL ||
+        !CacheInfoLevelHasType (Clidr, Caches[Idx].Level, Caches[Idx].Type)) {
+      continue;
+    }
+
+    CacheInfoDecode (&Caches[Idx], Ccidx);
+    ++Probed;
+
+    DEBUG ((
+      EFI_D_INFO,
+      "%a: L%u%a %u KiB, %u-way, %u sets, %u-byte lines\n",
+      __func__,
+      Caches[Idx].Level,
+      Caches[Idx].Type == CACHE_INFO_TYPE_INSTRUCTION ? "I" :
+        Caches[Idx].Type == CACHE_INFO_TYPE_DATA ? "D" : "",
+      Caches[Idx].Size / 1024,
+      Caches[Idx].Associativity,
+      Caches[Idx].NumberOfSets,
+      Caches[Idx].LineSize
+      ));
+  }
+
+  // Report levels the core describes but the silicon table does not
+  for (Level = 1; Level <= CLIDR_MAX_LEVEL; ++Level) {
+    if (CLIDR_CTYPE (Clidr, Level) == CLIDR_CTYPE_NONE) {
+      break;
+    }
+
+    for (Idx = 0; Idx < Count; ++Idx) {
+      if (Caches[Idx].Level == Level && Caches[Idx].Probed) {
+        break;
+      }
+    }
+
+    if (Idx == Count) {
+      DEBUG ((
+        EFI_D_WARN,
+        "%a: L%u (Ctype %u) is not described by the platform\n",
+        __func__,
+        Level,
+        CLIDR_CTYPE (Clidr, Level)
+        ));
+    }
+  }
+
+  return Probed;
+}
+
+VOID
+EFIAPI
+CacheInfoToPpttCache (
+  OUT  EFI_ACPI_6_4_PPTT_STRUCTURE_CACHE  *Node,
+  IN   CONST CACHE_INFO                   *Cache,
+  IN   UINT32                              NextLevelOfCache,
+  IN   UINT32                              CacheId
+  )
+{
+  ZeroMem (Node, sizeof (*Node));
+  Node->Type   = EFI_ACPI_6_4_PPTT_TYPE_CACHE;
+  Node->Length = sizeof (*Node);
+
+  Node->Flags.SizePropertyValid   = EFI_ACPI_6_4_PPTT_CACHE_SIZE_VALID;
+  Node->Flags.NumberOfSetsValid   = EFI_ACPI_6_4_PPTT_NUMBER_OF_SETS_VALID;
+  Node->Flags.AssociativityValid  = EFI_ACPI_6_4_PPTT_ASSOCIATIVITY_VALID;
+  Node->Flags.AllocationTypeValid = EFI_ACPI_6_4_PPTT_ALLOCATION_TYPE_VALID;
+  Node->Flags.CacheTypeValid      = EFI_ACPI_6_4_PPTT_CACHE_TYPE_VALID;
+  Node->Flags.WritePolicyValid    = EFI_ACPI_6_4_PPTT_WRITE_POLICY_VALID;
+  Node->Flags.LineSizeValid       = EFI_ACPI_6_4_PPTT_LINE_SIZE_VALID;
+  Node->Flags.CacheIdValid        = EFI_ACPI_6_4_PPTT_CACHE_ID_VALID;
+
+  Node->NextLevelOfCache = NextLevelOfCache;
+  Node->Size             = Cache->Size;
+  Node->NumberOfSets     = Cache->NumberOfSets;
+  if (Cache->Associativity <= MAX_UINT8) {
+    Node->Associativity = (UINT8) Cache->Associativity;
+  } else {
+    Node->Flags.AssociativityValid = EFI_ACPI_6_4_PPTT_ASSOCIATIVITY_INVALID;
+  }
+
+  if ((Cache->Policy & CACHE_INFO_READ_ALLOCATE) &&
+      (Cache->Policy & CACHE_INFO_WRITE_ALLOCATE)) {
+    Node->Attributes.AllocationType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ_WRITE;
+  } else if (Cache->Policy & CACHE_INFO_WRITE_ALLOCATE) {
+    Node->Attributes.AllocationType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_WRITE;
+  } else {
+    Node->Attributes.AllocationType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_ALLOCATION_READ;
+  }
+
+  if (Cache->Type == CACHE_INFO_TYPE_INSTRUCTION) {
+    Node->Attributes.CacheType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_INSTRUCTION;
+  } else if (Cache->Type == CACHE_INFO_TYPE_DATA) {
+    Node->Attributes.CacheType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_DATA;
+  } else {
+    Node->Attributes.CacheType = EFI_ACPI_6_4_CACHE_ATTRIBUTES_CACHE_TYPE_UNIFIED;
+  }
+
+  Node->Attributes.WritePolicy = (Cache->Policy & CACHE_INFO_WRITE_BACK) ?
+                                 EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_BACK :
+                                 EFI_ACPI_6_4_CACHE_ATTRIBUTES_WRITE_POLICY_WRITE_THROUGH;
+
+  Node->LineSize = (UINT16) Cache->LineSize;
+  Node->CacheId  = CacheId;
+}
@@ -18,6 +18,17 @@
 #define MMAVLSP_CMU0_CLKCHCTL_ESPI  (0x20000000 + 0x20 + 5 * 0x10)
 #define ESPI_FIFO_LEN  256
 
+// Refill the Tx FIFO once it drains to a quarter; the Rx FIFO
+// is drained as soon as it holds data.
+#define ESPI_FIFO_TX_THRESHOLD  (ESPI_FIFO_LEN / 4)
+#define ESPI_FIFO_RX_THRESHOLD  (ESPI_FIFO_LEN * 3 / 4)
+
+// Maximum time without FIFO progress
+#define ESPI_FIFO_TIMEOUT_US  100000
+
+// Status register polling interval
+#define ESPI_WAIT_POLL_US  5
+
 #define ESPI_CR1(Base)       *(volatile UINT32 *)((Base) + 0x00) // Control 1
 #define ESPI_CR2(Base)       *(volatile UINT32 *)((Base) + 0x04) // Control 2
 #define ESPI_TX_FIFO(Base)   *(volatile UINT32 *)((Base) + 0x0C) // Tx FIFO
@@ -94,6 +105,12 @@ typedef union {
   } Bits;
 } ESPI_IRQ_T;
 
+// Worst-case completion times (ms)
+#define ESPI_TIMEOUT_PP   1000
+#define ESPI_TIMEOUT_SSE  1000
+#define ESPI_TIMEOUT_SE   3000
+#define ESPI_TIMEOUT_BE   (400 * 1000)
+
 STATIC UINTN  AdrMode;
 
 //
@@ -170,63 +187,112 @@ EspiRxEnable (
   ESPI_CR2 (Base) = Cr2.Val;
 }
 
+typedef struct {
+  CONST UINT8  *Tx;  // NULL: send 0xFF
+  UINT8        *Rx;  // NULL: discard
+  UINTN         Len;
+} ESPI_SEGMENT;
+
+//
+// Streams all segments through the FIFOs as one continuous transfer:
+// the Tx FIFO is topped up whenever it drains below the almost empty
+// threshold and the Rx FIFO is emptied whenever data is available, so
+// command, address and data phases follow each other without gaps.
+// The number of bytes in flight never exceeds the Rx FIFO depth.
+//
 STATIC
 INTN
 EspiTxRx (
-  IN UINTN  Base,
-  IN VOID   *Tx_,
-  IN VOID   *Rx_,
-  IN UINTN  Len
+  IN UINTN               Base,
+  IN CONST ESPI_SEGMENT  *Segments,
+  IN UINTN               SegmentCount
   )
 {
-  UINT32      Cnt;
-  UINT32      Cnt0;
+  UINT64      ActivityTimestamp;
+  UINT32      Avail;
   UINT8       Data;
   UINT32      Free;
-  UINT8       *Tx = Tx_;
-  UINT8       *Rx = Rx_;
-  INTN        Timeout;
+  UINTN       RxIdx = 0;
+  UINTN       RxOff = 0;
+  UINTN       RxLeft = 0;
+  UINTN       TxIdx = 0;
+  UINTN       TxOff = 0;
+  UINTN       TxLeft;
+  UINTN       InFlight = 0;
+  UINTN       Index;
   ESPI_IRQ_T  Status;
 
+  for (Index = 0; Index < SegmentCount; ++Index) {
+    RxLeft += Segments[Index].Len;
+  }
+
+  TxLeft = RxLeft;
   ESPI_ISR (Base) = ESPI_ISR_CLEAR_ALL;
+  ActivityTimestamp = GetPerformanceCounter ();
+
+  while (RxLeft) {
+    if (TxLeft && ESPI_TX_FBCAR (Base) <= ESPI_FIFO_TX_THRESHOLD) {
+      Free = MIN (ESPI_FIFO_LEN - ESPI_TX_FBCAR (Base), ESPI_FIFO_LEN - InFlight);
+      Free = MIN (Free, TxLeft);
+      TxLeft   -= Free;
+      InFlight += Free;
+      while (Free) {
+        while (TxOff == Segments[TxIdx].Len) {
+          ++TxIdx;
+          TxOff = 0;
+        }
 
-  while (Len) {
-    Free = ESPI_FIFO_LEN - ESPI_TX_FBCAR (Base);
-    Cnt0 = MIN (Free, Len);
+        if (Segments[TxIdx].Tx != NULL) {
+          Data = Segments[TxIdx].Tx[TxOff];
+        } else {
+          Data = 0xFF;
+        }
 
-    Cnt = Cnt0;
-    while (Cnt) {
-      if (Tx) {
-        Data = *Tx++;
-      } else {
-        Data = 0xFF;
+        ESPI_TX_FIFO (Base) = Data;
+        ++TxOff;
+        --Free;
       }
 
-      ESPI_TX_FIFO (Base) = Data;
-      Cnt--;
+      EspiTxEnable (Base);
     }
 
-    EspiTxEnable (Base);
+    Avail = ESPI_RX_FBCAR (Base);
+    if (Avail) {
+      Avail     = MIN (Avail, RxLeft);
+      RxLeft   -= Avail;
+      InFlight -= Avail;
+      while (Avail) {
+        while (RxOff == Segments[RxIdx].Len) {
+          ++RxIdx;
+          RxOff = 0;
+        }
 
-    Timeout = 100;
-    Cnt = Cnt0;
-    while (Cnt) {
-      if (ESPI_RX_FBCAR (Base)) {
         Data = ESPI_RX_FIFO (Base);
-        if (Rx) {
-          *Rx++ = Data;
+        if (Segments[RxIdx].Rx != NULL) {
+          Segments[RxIdx].Rx[RxOff] = Data;
         }
 
-        Cnt--;
-      } else {
-        gBS->Stall (1000); // 1ms
-        if (Timeout-- == 0) {
-          return -1;
-        }
+        ++RxOff;
+        --Avail;
       }
-    }
 
-    Len -= Cnt0;
+      ActivityTimestamp = GetPerformanceCounter ();
+    } else if (GetTimeInNanoSecond (GetPerformanceCounter () - ActivityTimestamp) >
+               ESPI_FIFO_TIMEOUT_US * 1000ULL) {
+      DEBUG ((
+        EFI_D_ERROR,
+        "%a: timeout, %lu bytes left, %lu in flight\n",
+        __func__,
+        RxLeft,
+        InFlight
+        ));
+      return -1;
+    } else {
+      // Nothing received yet: the bytes in flight are still being clocked
+      // out. The Rx FIFO is drained whenever it holds any data and the Tx
+      // FIFO is topped up once it drains to ESPI_FIFO_TX_THRESHOLD.
+      MicroSecondDelay (1);
+    }
   }
 
   Status.Val = ESPI_ISR (Base);
@@ -277,8 +343,8 @@ EspiInit (
   ESPI_CR2 (Base) = Cr2.Val;
 
   // Threshold
-  ESPI_TX_FAETR (Base) = ESPI_FIFO_LEN / 2;
-  ESPI_RX_FAFTR (Base) = ESPI_FIFO_LEN / 2;
+  ESPI_TX_FAETR (Base) = ESPI_FIFO_TX_THRESHOLD;
+  ESPI_RX_FAFTR (Base) = ESPI_FIFO_RX_THRESHOLD;
 
   // Full duplex
   EspiRxEnable (Base);
@@ -300,27 +366,23 @@ EspiTransfer (
   IN UINTN   RxLen
   )
 {
-  INTN  Err;
+  INTN          Err;
+  ESPI_SEGMENT  Segments[3];
+
+  Segments[0].Tx  = Cmd;
+  Segments[0].Rx  = NULL;
+  Segments[0].Len = CmdLen;
+  Segments[1].Tx  = Tx;
+  Segments[1].Rx  = NULL;
+  Segments[1].Len = TxLen;
+  Segments[2].Tx  = NULL;
+  Segments[2].Rx  = Rx;
+  Segments[2].Len = RxLen;
 
   EspiSelect (Base, Line, 0);
-
-  Err = EspiTxRx (Base, Cmd, NULL, CmdLen);
-  if (Err) {
-    return Err;
-  }
-
-  Err = EspiTxRx (Base, Tx, NULL, TxLen);
-  if (Err) {
-    return Err;
-  }
-
-  Err = EspiTxRx (Base, NULL, Rx, RxLen);
-  if (Err) {
-    return Err;
-  }
-
+  Err = EspiTxRx (Base, Segments, ARRAY_SIZE (Segments));
   EspiSelect (Base, Line, 1);
-  return 0;
+  return Err;
 }
 
 //
@@ -460,27 +522,31 @@ STATIC
 INTN
 EspiWait (
   IN UINTN  Base,
-  IN UINTN  Line
+  IN UINTN  Line,
+  IN INTN   Timeout
   )
 {
-  INTN   Err;
-  INTN   Timeout;
-  UINT8  Status;
+  INTN    Err;
+  UINT8   Status;
+  UINT64  TimeStart;
 
-  Timeout = 1000;
-  do {
+  TimeStart = GetPerformanceCounter ();
+  for (;;) {
     Err = EspiExec (Base, Line, CMD_FLASH_RDSR, 0, &Status, 1);
     if (Err) {
       return Err;
     }
 
-    gBS->Stall (1000);
-    if (Timeout-- == 0) {
+    if (!(Status & SPI_FLASH_SR_WIP)) {
+      return 0;
+    }
+
+    if (GetTimeInNanoSecond (GetPerformanceCounter () - TimeStart) > Timeout * 1000000ULL) {
       return -1;
     }
-  } while (Status & SPI_FLASH_SR_WIP);
 
-  return 0;
+    MicroSecondDelay (ESPI_WAIT_POLL_US);
+  }
 }
 
 INTN
@@ -595,7 +661,7 @@ EspiWrite (
       return Err;
     }
 
-    Err = EspiWait (Base, Line);
+    Err = EspiWait (Base, Line, ESPI_TIMEOUT_PP);
     if (Err) {
       return Err;
     }
@@ -608,6 +674,72 @@ EspiWrite (
   return 0;
 }
 
+INTN
+EspiErasePlan (
+  IN  UINTN             Adr,
+  IN  UINTN             Size,
+  IN  UINTN             ChipSize,
+  OUT ESPI_ERASE_PLAN  *Plan
+  )
+{
+  UINTN  End;
+  UINTN  SectorStart;
+  UINTN  SectorEnd;
+
+  if (Plan == NULL || Adr % SPI_SUBSECTOR || Size % SPI_SUBSECTOR) {
+    return -1;
+  }
+
+  Plan->RunCount = 0;
+  if (Size == 0) {
+    return 0;
+  }
+
+  if (ChipSize != 0 && Adr == 0 && Size == ChipSize) {
+    Plan->Runs[0].Cmd      = CMD_FLASH_BE;
+    Plan->Runs[0].Adr      = 0;
+    Plan->Runs[0].UnitSize = ChipSize;
+    Plan->Runs[0].Count    = 1;
+    Plan->RunCount = 1;
+    return 0;
+  }
+
+  End         = Adr + Size;
+  SectorStart = ALIGN_VALUE (Adr, SPI_SECTOR);
+  SectorEnd   = End & ~((UINTN)SPI_SECTOR - 1);
+
+  if (SectorStart >= SectorEnd) {
+    // No whole sector inside the range
+    SectorStart = SectorEnd = End;
+  }
+
+  if (SectorStart > Adr) {
+    Plan->Runs[Plan->RunCount].Cmd      = CMD_FLASH_SSE;
+    Plan->Runs[Plan->RunCount].Adr      = Adr;
+    Plan->Runs[Plan->RunCount].UnitSize = SPI_SUBSECTOR;
+    Plan->Runs[Plan->RunCount].Count    = (SectorStart - Adr) / SPI_SUBSECTOR;
+    ++Plan->RunCount;
+  }
+
+  if (SectorEnd > SectorStart) {
+    Plan->Runs[Plan->RunCount].Cmd      = CMD_FLASH_SE;
+    Plan->Runs[Plan->RunCount].Adr      = SectorStart;
+    Plan->Runs[Plan->RunCount].UnitSize = SPI_SECTOR;
+    Plan->Runs[Plan->RunCount].Count    = (SectorEnd - SectorStart) / SPI_SECTOR;
+    ++Plan->RunCount;
+  }
+
+  if (End > SectorEnd) {
+    Plan->Runs[Plan->RunCount].Cmd      = CMD_FLASH_SSE;
+    Plan->Runs[Plan->RunCount].Adr      = SectorEnd;
+    Plan->Runs[Plan->RunCount].UnitSize = SPI_SUBSECTOR;
+    Plan->Runs[Plan->RunCount].Count    = (End - SectorEnd) / SPI_SUBSECTOR;
+    ++Plan->RunCount;
+  }
+
+  return 0;
+}
+
 INTN
 EspiErase (
   IN UINTN  Base,
@@ -616,35 +748,129 @@ EspiErase (
   IN UINTN  Size
   )
 {
-  INTN  Err;
+  INTN             Err;
+  UINTN            Index;
+  ESPI_ERASE_PLAN  Plan;
+  ESPI_ERASE_RUN  *Run;
+  UINTN            Unit;
+  INTN             Timeout;
+
+  //
+  // The chip size is not probed, only the default geometry of EspiInfo is
+  // known. A bulk erase on a larger part would wipe it past the range, so
+  // whole-chip ranges are erased by sectors too.
+  //
+  Err = EspiErasePlan (Addr, Size, 0, &Plan);
+  if (Err) {
+    return Err;
+  }
 
-  if (Size % SPI_SUBSECTOR) {
-    return -1;
+  for (Index = 0; Index < Plan.RunCount; ++Index) {
+    Run = &Plan.Runs[Index];
+    DEBUG ((
+      EFI_D_VERBOSE,
+      "%a: 0x%lx x %lu @ 0x%08lx (cmd 0x%02x)\n",
+      __func__,
+      Run->UnitSize,
+      Run->Count,
+      Run->Adr,
+      Run->Cmd
+      ));
   }
 
-  while (Size) {
-    Err = EspiWren (Base, Line);
-    if (Err) {
-      return Err;
+  for (Index = 0; Index < Plan.RunCount; ++Index) {
+    Run = &Plan.Runs[Index];
+    if (Run->Cmd == CMD_FLASH_BE) {
+      Timeout = ESPI_TIMEOUT_BE;
+    } else if (Run->Cmd == CMD_FLASH_SE) {
+      Timeout = ESPI_TIMEOUT_SE;
+    } else {
+      Timeout = ESPI_TIMEOUT_SSE;
     }
 
-    Err = EspiExec (Base, Line, CMD_FLASH_SSE, Addr, 0, 0);
-    if (Err) {
-      return Err;
-    }
+    for (Unit = 0; Unit < Run->Count; ++Unit) {
+      Err = EspiWren (Base, Line);
+      if (Err) {
+        return Err;
+      }
 
-    Err = EspiWait (Base, Line);
-    if (Err) {
-      return Err;
-    }
+      Err = EspiExec (Base, Line, Run->Cmd, Run->Adr + Unit * Run->UnitSize, 0, 0);
+      if (Err) {
+        return Err;
+      }
 
-    Addr += SPI_SUBSECTOR;
-    Size -= SPI_SUBSECTOR;
+      Err = EspiWait (Base, Line, Timeout);
+      if (Err) {
+        return Err;
+      }
+    }
   }
 
   return 0;
 }
 
+INTN
+EspiEraseStart (
+  IN UINTN  Base,
+  IN UINTN  Line,
+  IN UINTN  Cmd,
+  IN UINTN  Addr
+  )
+{
+  INTN  Err;
+
+  if (Cmd != CMD_FLASH_SSE && Cmd != CMD_FLASH_SE && Cmd != CMD_FLASH_BE) {
+    return -1;
+  }
+
+  Err = EspiWren (Base, Line);
+  if (Err) {
+    return Err;
+  }
+
+  return EspiExec (Base, Line, Cmd, Addr, 0, 0);
+}
+
+INTN
+EspiWriteStart (
+  IN UINTN  Base,
+  IN UINTN  Line,
+  IN UINTN  Addr,
+  IN VOID   *Data,
+  IN UINTN  Size
+  )
+{
+  INTN  Err;
+
+  if (Size == 0 || Addr / SPI_MAX_WRITE != (Addr + Size - 1) / SPI_MAX_WRITE) {
+    return -2;
+  }
+
+  Err = EspiWren (Base, Line);
+  if (Err) {
+    return Err;
+  }
+
+  return EspiExec (Base, Line, CMD_FLASH_PP, Addr, Data, Size);
+}
+
+INTN
+EspiBusy (
+  IN UINTN  Base,
+  IN UINTN  Line
+  )
+{
+  INTN   Err;
+  UINT8  Status;
+
+  Err = EspiExec (Base, Line, CMD_FLASH_RDSR, 0, &Status, 1);
+  if (Err) {
+    return Err;
+  }
+
+  return (Status & SPI_FLASH_SR_WIP) ? 1 : 0;
+}
+
 INTN
 EspiMode3 (
   IN UINTN  Base,